@@ -0,0 +1,131 @@
+#include "AlarmScheduler.h"
+
+int AlarmScheduler::count() const {
+    return _count;
+}
+
+Alarm &AlarmScheduler::alarm(int i) {
+    return _alarms[i];
+}
+
+// false if all slots are taken, replan() afterwards
+bool AlarmScheduler::add(const Alarm &alarm) {
+    if(_count >= MAXALARMS)
+        return false;
+
+    _alarms[_count++] = alarm;
+    return true;
+}
+
+void AlarmScheduler::clear() {
+    _count = 0;
+}
+
+// the next firing at or after now over all active alarms and the snooze, deadlines already handled
+// before a backward step of the clock are skipped
+void AlarmScheduler::replan(uint32_t now) {
+    if(_done >= now && _done - now < ALARMMAXSTEP)
+        now = _done + 1;
+
+    _next = _snoozeUntil;
+    _nextIndex = -1;
+
+    for(int i = 0; i < _count; i++) {
+        uint32_t t = nextOccurrence(_alarms[i], now);
+        if(t != 0 && (_next == 0 || t < _next)) {
+            _next = t;
+            _nextIndex = i;
+        }
+    }
+}
+
+bool AlarmScheduler::due(uint32_t now) const {
+    return _next != 0 && now >= _next;
+}
+
+// call while due(), handles the oldest passed deadline: returns the index of its alarm, -1 for the end of the
+// snooze, ring is false if it is more than ALARMCATCHUP late and was counted as missed
+int AlarmScheduler::fire(uint32_t now, bool &ring) {
+    int i = _nextIndex;
+    uint32_t late = now - _next;
+
+    ring = late <= ALARMCATCHUP;
+    if(ring) {
+        _stats.fired++;
+        if(late > ALARMLATE)
+            _stats.late++;
+        if(late > _stats.maxLate)
+            _stats.maxLate = late;
+    } else
+        _stats.missed++;
+
+    if(i < 0)
+        _snoozeUntil = 0;
+    else if(_alarms[i].once)
+        _alarms[i].active = false;
+
+    _done = _next;
+    replan(_done + 1);
+    return i;
+}
+
+// the clock was set to "to" by stepMs, less than a second back leaves _next ahead of the handled ones
+void AlarmScheduler::timeStep(uint32_t to, int64_t stepMs) {
+    if(stepMs > -1000 && stepMs <= (int64_t)ALARMMAXSTEP * 1000)
+        return;         // the crossed deadlines stay due
+
+    if(stepMs < 0)
+        _stats.backSteps++;
+
+    replan(to);
+}
+
+void AlarmScheduler::snooze(uint32_t now, uint32_t seconds) {
+    _snoozeUntil = now + seconds;
+    replan(now);
+}
+
+void AlarmScheduler::cancelSnooze(uint32_t now) {
+    _snoozeUntil = 0;
+    replan(now);
+}
+
+bool AlarmScheduler::snoozed() const {
+    return _snoozeUntil != 0;
+}
+
+// local epoch seconds of the next firing, 0 if none
+uint32_t AlarmScheduler::next() const {
+    return _next;
+}
+
+// -1 if none or the snooze comes first
+int AlarmScheduler::nextIndex() const {
+    return _nextIndex;
+}
+
+// first time >= from the alarm goes off, 0 if never; a day mask of 0 counts as every day
+uint32_t AlarmScheduler::nextOccurrence(const Alarm &alarm, uint32_t from) {
+    if(!alarm.active)
+        return 0;
+
+    uint32_t timeOfDay = (alarm.time / 100) * 3600L + (alarm.time % 100) * 60;
+    uint32_t day = from / 86400L;
+
+    for(int d = 0; d < 8; d++) {
+        uint32_t t = (day + d) * 86400L + timeOfDay;
+        if(t >= from && (alarm.days == 0 || alarm.days & (1 << weekday(t))))
+            return t;
+    }
+
+    return 0;
+}
+
+const AlarmStats &AlarmScheduler::stats() const {
+    return _stats;
+}
+
+// 0 Sunday ... 6 Saturday, 1.1.1970 was a Thursday
+int AlarmScheduler::weekday(uint32_t t) {
+    return (t / 86400L + 4) % 7;
+}
@@ -0,0 +1,76 @@
+/* Alarm scheduler
+ *
+ * Up to MAXALARMS alarms, each with a time of day, a weekday mask and a one-shot flag, plus one snooze.
+ * The firing time of the next alarm is kept precomputed, so the check per tick is due(): one compare.
+ * replan() recomputes it and has to be called whenever the alarms or the time change, add() and clear()
+ * leave that to the caller, a pending snooze survives both.
+ * Times are local epoch seconds, as returned by ClockSource::now().
+ *
+ * The firing times are deadlines: an alarm is due from its time on, not only in its second, so a stalled
+ * loop rings it late instead of never. fire() walks through every deadline that has passed, one call each:
+ * up to ALARMCATCHUP seconds late the alarm still rings, older ones are counted as missed. timeStep() keeps
+ * the deadlines crossed by a forward step of the clock due and, after a backward step, does not repeat
+ * those already handled. Steps of more than ALARMMAXSTEP count as setting the clock (the first NTP time).
+ * The step is given in ms, so NTP corrections of a few ms across a second boundary are not steps back.
+ */
+
+#ifndef AlarmScheduler_h
+#define AlarmScheduler_h
+
+#include <stdint.h>
+
+#define MAXALARMS 8
+
+#ifndef ALARMCATCHUP
+#define ALARMCATCHUP 1800   // seconds an alarm still rings after its time
+#endif
+#define ALARMLATE 60        // seconds after which it counts as late
+#define ALARMMAXSTEP 86400
+#define EVERYDAY 0x7f       // bit 0 Sunday ... bit 6 Saturday
+
+struct Alarm {
+    uint16_t time = 0;      // hhmm
+    uint8_t days = EVERYDAY;
+    bool active = false;
+    bool once = false;      // switches itself off after it went off
+};
+
+struct AlarmStats {
+    uint32_t fired = 0;
+    uint32_t late = 0;
+    uint32_t missed = 0;
+    uint32_t maxLate = 0;       // seconds
+    uint32_t backSteps = 0;     // of a second or more
+};
+
+class AlarmScheduler {
+    public:
+        int count() const;
+        Alarm &alarm(int i);
+        bool add(const Alarm &alarm);
+        void clear();
+        void replan(uint32_t now);
+        bool due(uint32_t now) const;
+        int fire(uint32_t now, bool &ring);
+        void timeStep(uint32_t to, int64_t stepMs);
+        void snooze(uint32_t now, uint32_t seconds);
+        void cancelSnooze(uint32_t now);
+        bool snoozed() const;
+        uint32_t next() const;
+        int nextIndex() const;
+        const AlarmStats &stats() const;
+
+        static uint32_t nextOccurrence(const Alarm &alarm, uint32_t from);
+        static int weekday(uint32_t t);
+
+    private:
+        Alarm _alarms[MAXALARMS];
+        uint8_t _count = 0;
+        uint32_t _next = 0;
+        int8_t _nextIndex = -1;
+        uint32_t _snoozeUntil = 0;
+        uint32_t _done = 0;         // latest deadline handled
+        AlarmStats _stats;
+};
+
+#endif
@@ -1,29 +1,53 @@
 #include "BasicESP8266.h"
+#include "hal/HalEsp8266.h"
+#if FEATURE_NTP
+#include <coredecls.h>
+#include <sys/time.h>
+#include <lwip/apps/sntp.h>
+#endif
+
+#if FEATURE_HTTPOTA
+static EspFirmwareWriter firmwareWriter;
+#endif
+
+#if FEATURE_NTP
+static uint32_t ntpInterval=1800000;    // ms, asked for by the SNTP client
+#endif
+
+static const char APSNAMES[][8] PROGMEM={"ssid","pwd","adr","gateway","mask","broker","topic","port","peer"};
+#define APSCOUNT (sizeof(APSNAMES)/sizeof(APSNAMES[0]))
 
-BasicESP8266::BasicESP8266(boolean debug, int sigLed, boolean sigLowActive, bool apPwd=false, bool showWifiPwd=false)
+BasicESP8266::BasicESP8266(int sigLed, boolean sigLowActive, bool apPwd=false, bool showWifiPwd=false)
 {
   _apPwd=apPwd;
   _showWifiPwd=showWifiPwd;
-  _debug=debug;
   _sigLed=sigLed;
   _sigLowActive=sigLowActive;
-  if (_debug) Serial.begin(115200);
+#if FEATURE_LOG
+  logger.begin(Features::debug, LOG_MAXLEVEL);
+#endif
 }
 
+// the part of the boot the clock needs, startWifi() follows once the clock runs, loop() does the rest (_bootStep)
 void BasicESP8266::begin()
 {
-  delay(1000);
-  if (_debug) Serial.println("\nsigLed: "+String(_sigLed)); 
+  stallWatch.begin(_STALLBUDGET);
+  LOGI("esp", "Free heap at start: %u", ESP.getFreeHeap());
+  if (Features::debug) delay(1000);     // for the serial monitor
+  LOGD("esp", "sigLed: %d", _sigLed);
   pinMode(_sigLed,OUTPUT);
 //  if (_sigLed==1) pinMode(_sigLed,FUNCTION_3+OUTPUT);
   digitalWrite(_sigLed,_sigLowActive?HIGH:LOW);
 
 //---------------------------------------------- EEPROM ----------------------------------------------------------------------------------------
-  EEPROM.begin(ESIZE);            // EEPROM einschalten
-  if (_debug) DPRF("EEPROM-size: %u\n",EEPROM.length());
-  _apFlag=_eeGetULong(_IND_APFLAG)==1?true:false;
-  if (_debug) DPRF ("AP flag: %u\n",_apFlag);
-  _checkResets();
+  {
+    BootPhase p("eeprom");
+    EEPROM.begin(ESIZE);            // EEPROM einschalten
+    LOGD("esp", "EEPROM-size: %u", EEPROM.length());
+    _apFlag=_eeGetULong(_IND_APFLAG)==1?true:false;
+    LOGD("esp", "AP flag: %u", _apFlag);
+    _checkResets();
+  }
 
 
   FlashMode_t ideMode = ESP.getFlashChipMode();
@@ -31,64 +55,155 @@ void BasicESP8266::begin()
 
 //---------------------------------------------- SPIFFS ----------------------------------------------------------------------------------------
 
+  int fs=bootProfile.start("fs");
   if (LittleFS.begin())
   {
-    if (_debug)DPRLN ("\nSPIFFS Initialization....OK");
-    FSInfo inf;
-    LittleFS.info(inf);
-    freeSpiffs=inf.totalBytes-inf.usedBytes;
-    totalSpiffs=inf.totalBytes;
-    usedSpiffs=inf.usedBytes;
-    if (_debug)
-    {
-      DPRLN ("Total SPIFFS memory: "+String(inf.totalBytes));
-      DPRLN ("Used SPIFFS memory: "+String(inf.usedBytes));
-      DPRLN ("Free SPIFFS memory: "+String(freeSpiffs));
-      DPRLN ("SPIFFS Dir:");
-      DPRLN (_getSpiffs(false));
-    }
+    LOGI("fs", "SPIFFS Initialization....OK");
+    fileIndex.begin();
+    uint32_t total=0, used=0;
+    fileIndex.usage(total, used);
+    LOGD("fs", "Total SPIFFS memory: %u", total);
+    LOGD("fs", "Used SPIFFS memory: %u", used);
+    LOGD("fs", "Free SPIFFS memory: %u", total-used);
   }
   else
   {
-    if (_debug) DPRLN ("\nSPIFFS Initialisierung...Fehler!\nTry to format ...");
+    LOGE("fs", "SPIFFS Initialisierung...Fehler! Try to format ...");
+    signalCode(LEDCODE_FS);
     boolean fsf=LittleFS.format();
-    if (_debug) DPRLN(fsf?"\nFormatted. Reset device!\n":"\nCould not format device ...\n");
+    if (fsf) LOGE("fs", "Formatted. Reset device!");
+    else LOGE("fs", "Could not format device ...");
   }
+  bootProfile.end(fs);
   
-  if (_debug) 
+  LOGD("esp", "Chip real size: %u", realSize);
+  LOGD("esp", "Chip ide size: %u", ideSize);
+  LOGD("esp", "Chip write mode: %s", chipMode.c_str());
+
+  _mac="ESP"+WiFi.macAddress();
+  _mac.replace(":","");
   {
-    DPRF("\nChip real size: %u\n",realSize);
-    DPRF("Chip ide size: %u\n",ideSize);
-    DPRF("Chip write mode: %s\n",chipMode.c_str());
+    BootPhase p("config");
+    _setConfig();
   }
+}
+
+// one stage per call, the clock ticks between them; WiFi until it is connected or the AP is up
+void BasicESP8266::_bootStep()
+{
+  StallSection s("boot");
+  switch (_stage)
+  {
+    case BootStage::Wifi:
+      if (_pollWifi()) _stage=BootStage::Server;
+      break;
+
+    case BootStage::Server:
+    {
+      {
+        BootPhase p("server");
+        _setserver();
+      }
+      if (onNetwork)
+      {
+        BootPhase p("app");
+        onNetwork();
+      }
+      server->begin();
+      LOGI("http", "Server started");
+      _stage=BootStage::Ntp;
+      break;
+    }
 
-  _setConfig();
-  _tryWifi();
+    case BootStage::Ntp:
+    {
+#if FEATURE_NTP
+      BootPhase p("ntp");
+      ntpInterval=_updateinterval<15000?15000:_updateinterval;
+      settimeofday_cb([this](bool fromSntp)
+      {
+        if (fromSntp && !_ntpSynced) bootProfile.mark("ntp synced");
+        if (fromSntp) _ntpSynced=true;
+      });
+      configTime(0, 0, "pool.ntp.org");    // UTC, the clock applies the time zone
+#endif
+      _stage=BootStage::Ota;
+      break;
+    }
+
+    case BootStage::Ota:
+    {
+#if FEATURE_OTA
+      if (!apmode)
+      {
+        BootPhase p("ota");
+        ArduinoOTA.setHostname(_mac.c_str());
+        ArduinoOTA.onStart([this]() {LOGI("ota", "Start OTA updating %s", ArduinoOTA.getCommand() == U_FLASH? "sketch":"filesystem");signal(LED_OTA, LEDBUSY);});
+        ArduinoOTA.onEnd([]() {LOGI("ota", "End");ESP.restart();});
+        ArduinoOTA.onProgress([](unsigned int progress, unsigned int total) {LOGD("ota", "Progress: %u%%", (progress / (total / 100)));});
+        ArduinoOTA.onError([this](ota_error_t error) {LOGE("ota", "Error[%u]", error);cancelSignal(LED_OTA);signalCode(LEDCODE_OTA, 3);});
+        ArduinoOTA.begin();
+        LOGI("ota", "OTA Ready");
+      }
+#endif
+      _stage=BootStage::Files;
+      break;
+    }
 
-#ifdef ntp
-  timeClient=new NTPClient(ntpUDP, "pool.ntp.org", _tzoffset, _updateinterval);
-  timeClient->begin();
-  timeClient->update();
+    case BootStage::Files:
+#if FEATURE_LOG && LOG_MAXLEVEL>=LOG_DEBUG
+      if (logger.enabled(LOG_DEBUG))
+      {
+        BootPhase p("files");
+        fileIndex.list([](void *ctx, const char *name, uint32_t size, uint32_t mtime)
+        {
+          LOGD("fs", "%s (%u)", name, size);
+        }, nullptr);
+      }
 #endif
+      _stage=BootStage::Done;
+      bootProfile.done();
+      break;
+
+    case BootStage::Done:
+      break;
+  }
+}
 
-  if (!apmode)
+#if FEATURE_NTP
+// the SNTP client keeps the time with the fraction of the NTP reply and runs in the background,
+// this only reads it, 0 until the first reply
+uint32_t BasicESP8266::getEpochTime(uint16_t &ms)
+{
+  if (_ntpSynced) cancelSignal(LED_NTPFAIL);
+  else
   {
-    ArduinoOTA.setHostname(_mac.c_str());
-    ArduinoOTA.onStart([this]() {String type=ArduinoOTA.getCommand() == U_FLASH? "sketch":"filesystem";if (this->_debug) Serial.println("Start OTA updating " + type);});
-    ArduinoOTA.onEnd([this]() {if (this->_debug)Serial.println("\nEnd");ESP.restart();});
-    ArduinoOTA.onProgress([this](unsigned int progress, unsigned int total) {if (this->_debug) Serial.printf("Progress: %u%%\r", (progress / (total / 100)));
-    ArduinoOTA.onError([this](ota_error_t error) {if (this->_debug) Serial.printf("Error[%u]: ", error);});});
-    ArduinoOTA.begin();
-    if (_debug) Serial.println("OTA Ready");
+    if (!apmode) signal(LED_NTPFAIL, LEDFAULT);
+    return 0;
   }
 
+  timeval tv;
+  gettimeofday(&tv, nullptr);
+  ms=tv.tv_usec/1000;
+  return tv.tv_sec;
+}
+
+// off while the clock follows a peer (PeerSync), then on again the time counts only after a new reply
+void BasicESP8266::setNtpActive(bool on)
+{
+  LOGI("ntp", "SNTP %s", on?"on":"off");
+  if (on) sntp_init();
+  else
+  {
+    sntp_stop();
+    _ntpSynced=false;
+  }
 }
 
-#ifdef ntp
-uint32_t BasicESP8266::getEpochTime()
+// poll interval of the SNTP client, the RFC minimum is 15 s
+extern "C" uint32_t sntp_update_delay_MS_rfc_not_less_than_15000()
 {
-  timeClient->update();
-  return timeClient->getEpochTime();
+  return ntpInterval;
 }
 #endif
 
@@ -99,81 +214,98 @@ unsigned long BasicESP8266::getUpdateInterval()
 
 //-----------------------------------------------  SigLed functions ------------------------------------------------------------------------
 
-bool BasicESP8266::setSig(uint32_t onDur, uint32_t offDur, uint8_t sigCount)
-{ 
-  if (_sigOn>0 || _sigOff>0) return false;
-  _sigOnDur=onDur;
-  _sigOffDur=offDur;
-  _sigCount=sigCount;
-  _sigOn=millis();
-  _sigCount--;
-  return true;
+// cycles 0 plays the pattern until it is cancelled, false if the queue is full or there is no LED
+bool BasicESP8266::signal(const LedPattern &pattern, uint8_t priority, uint8_t cycles)
+{
+  if (_sigLed>16) return false;
+  bool queued=_sigSeq.play(&pattern, priority, cycles);
+  _sigUpdate();
+  return queued;
 }
 
-bool BasicESP8266::sig(int n=3)
+// blink code, see LEDCODE_*
+bool BasicESP8266::signalCode(uint8_t code, uint8_t cycles)
 {
-  return setSig(300,500,n);
+  if (_sigLed>16) return false;
+  LOGW("esp", "LED code %u", code);
+  bool queued=_sigSeq.code(code, LEDFAULT, cycles);
+  _sigUpdate();
+  return queued;
 }
 
+void BasicESP8266::cancelSignal(const LedPattern &pattern)
+{
+  _sigSeq.cancel(&pattern);
+  _sigUpdate();
+}
 
-//-----------------------------------------------  Spiff functions ------------------------------------------------------------------------
+// the Ticker callbacks run between loop() calls like the loop itself, the sequencer needs no locking
+void BasicESP8266::_sigUpdate()
+{
+  if (!_sigSeq.changed()) return;
+  _sigTicker.detach();
+  _sigStep();
+}
 
-String BasicESP8266::_getSpiffs(bool table=false)
+void BasicESP8266::_sigStep()
 {
-  String fn = "";
-  String res="";
-  if (table) res = "<table><tr style=\"background-color:lime;\"><th>Filename</th><th>Size (Bytes)</th></tr>\n";
-  Dir dir = LittleFS.openDir("/");
-  while (dir.next())
-  {
-    fn = dir.fileName();
-    if (fn.substring(0, 1) == "/") fn = fn.substring(1);
-    if (table)res += "<tr style=\"background-color:yellow;\"><td>"+fn + "</td><td>" + dir.fileSize() + "</td></tr>\n";
-    else res+=fn+" ("+dir.fileSize()+")\n";
-  }
-  if (table) res+="<tr style=\"background-color:lightBlue;\"><td>Free memory:</td><td>"+String(freeSpiffs)+"</table>\n";
-  return res;
+  bool on;
+  uint32_t ms=_sigSeq.next(on);
+  digitalWrite(_sigLed,on!=_sigLowActive?HIGH:LOW);
+  if (ms>0) _sigTicker.once_ms(ms, [this]() {_sigStep();});
 }
 
 
-bool BasicESP8266::saveFile(String fname, String finhalt)
+//-----------------------------------------------  Spiff functions ------------------------------------------------------------------------
+
+bool BasicESP8266::saveFile(const char *fname, const char *data, size_t len)
 {
-  if (fname.substring(0, 1) != "/") fname = "/" + fname;
-  File f = LittleFS.open(fname, "w+");
-  if (!f)
+  char path[32];
+  filePath(path, sizeof(path), fname);
+  if (!fileIndex.write(path, data, len))
   {
-    if (_debug) DPRLN ("File Open Error!");
+    LOGE("fs", "Write Error!");
     return false;
   }
-  else
-  {
-    if (!f.print(finhalt))
-    {
-      if (_debug) DPRLN ("Write Error!");
-      return false;
-    }
-    f.close();
-  }
   return true;
 }
 
-String BasicESP8266::loadFile(String fname)
+bool BasicESP8266::saveFile(const String &fname, const String &finhalt)
+{
+  return saveFile(fname.c_str(), finhalt.c_str(), finhalt.length());
+}
+
+int BasicESP8266::loadFile(const char *fname, char *buf, size_t len)
 {
-  String res = "-1";
-  File f = LittleFS.open("/" + fname, "r");
-  if (f != false)
+  char path[32];
+  filePath(path, sizeof(path), fname);
+  int n=fileIndex.read(path, 0, buf, len>0?len-1:0);
+  if (n<0)
   {
-    res = "";
-    while (f.available()) res += (char)f.read();
-    f.close();
+    LOGD("fs", "%s can't be loaded!", fname);
+    if (len>0) buf[0]=0;
+    return -1;
   }
-  else if (_debug) DPRLN(fname + " can't be loaded!");
-  return res;
+  if (len>0) buf[n]=0;
+  return n;
 }
 
-bool BasicESP8266::_deleteFile(String fname)
+String BasicESP8266::loadFile(const String &fname)
 {
-  return (LittleFS.remove("/"+fname)==true);
+  char path[32];
+  filePath(path, sizeof(path), fname.c_str());
+  int size=fileIndex.size(path);
+  if (size<0)
+  {
+    LOGD("fs", "%s can't be loaded!", fname.c_str());
+    return "-1";
+  }
+  String res;
+  res.reserve(size);
+  char buf[64];
+  int n;
+  while ((n=fileIndex.read(path, res.length(), buf, sizeof(buf)))>0) res.concat(buf, n);
+  return res;
 }
 
 //-----------------------------------------------  EEPROM functions ------------------------------------------------------------------------
@@ -197,71 +329,105 @@ void BasicESP8266::_eePutULong(int adr, uint32_t val) // speichert einen 32BitUW
 
 //-----------------------------------------------  general functions ------------------------------------------------------------------------
  
-String BasicESP8266::getSsid() {return _eSsid;}
-String BasicESP8266::getPwd() {return _ePwd;}
+const String &BasicESP8266::getSsid() {return _eSsid;}
+const String &BasicESP8266::getPwd() {return _ePwd;}
+const String &BasicESP8266::getBroker() {return _broker;}
+const String &BasicESP8266::getTopic() {return _devTopic;}
+uint16_t BasicESP8266::getMqttPort() {return _mqttPort;}
+const String &BasicESP8266::getMac() {return _mac;}
+const String &BasicESP8266::getPeerKey() {return _peerKey;}
 String BasicESP8266::getIp() {return _eAdr[0]>0?_eAdr.toString():"";}
 String BasicESP8266::getGateway() {return _eGateway[0]>0?_eGateway.toString():"";}
 String BasicESP8266::getNetmask() {return _eMask[0]>0?_eMask.toString():"255.255.255.0";}
-void BasicESP8266::setSsid(String ssid) {_eSsid=ssid;}
-void BasicESP8266::setPwd(String pwd) {_ePwd=pwd;}
-void BasicESP8266::setIp(String ip) {_eAdr.fromString(ip);}
-void BasicESP8266::setGateway(String gateway) {_eGateway.fromString(gateway);}
-void BasicESP8266::setNetmask(String netmask) {_eMask.fromString(netmask);}
-void BasicESP8266::setUpdateInterval(String updateinterval) {_updateinterval=updateinterval.toInt();}
-void BasicESP8266::setTZOffset(String tzoffset) {_tzoffset=tzoffset.toInt();}
-String BasicESP8266::htmlMask(String a, bool citation=true, String title="")
-{
-  if (citation)
-  {
-    a.replace("&", "&amp;");
-    a.replace("<", "&lt;");
-    a.replace(">", "&gt;");
-    a.replace("\"", "&quot;");
-  }
-  String res="<!DOCTYPE html>\n<html>\n<head>\n<meta charset='UTF-8'>\n<title>\n"+title+"\n</title>\n</head>\n<body style=\"font-family:arial,sans-serif,helvetica;\">\n";
-  res+=citation?"<pre>\n":"";
-  res+=a;
-  res+=citation?"</pre>\n":"";
-  res+="</body>\n</html>\n";
+void BasicESP8266::setSsid(const char *ssid) {_eSsid=ssid;}
+void BasicESP8266::setPwd(const char *pwd) {_ePwd=pwd;}
+void BasicESP8266::setIp(const char *ip) {_eAdr.fromString(ip);}
+void BasicESP8266::setGateway(const char *gateway) {_eGateway.fromString(gateway);}
+void BasicESP8266::setNetmask(const char *netmask) {_eMask.fromString(netmask);}
+void BasicESP8266::setUpdateInterval(const char *updateinterval) {_updateinterval=strtoul(updateinterval, nullptr, 10);}
+
+void BasicESP8266::htmlMask(TextSink &out, std::string_view a, bool citation, std::string_view title)
+{
+  htmlPage(out, a, citation, title);
+}
+
+String BasicESP8266::htmlMask(const String &a, bool citation, const String &title)
+{
+  String res;
+  res.reserve(a.length()+200);
+  StringSink out(res);
+  htmlMask(out, std::string_view(a.c_str(), a.length()), citation, std::string_view(title.c_str(), title.length()));
   return res;
 }
 
-int BasicESP8266::countInitKeys(String src)
+int BasicESP8266::countInitKeys(const char *src)
 {
-  int n=0;
-  for(int i=0;i<src.length();i++) if (src.charAt(i)=='=') n++;
-  return n;
+  return iniCountKeys(src);
 }
 
-bool BasicESP8266::isInitKey(String src, String key)
+int BasicESP8266::countInitKeys(const String &src)
 {
-   return src.indexOf(key+"=")==-1?false:true;
+  return iniCountKeys(std::string_view(src.c_str(), src.length()));
 }
 
-String BasicESP8266::getInitValue(String src, String key)
+bool BasicESP8266::isInitKey(const char *src, const char *key)
 {
-  int p=src.indexOf(key+"=");
-  if (p==-1) return "";
-  int q=src.indexOf("=",p);
-  if (q==-1) return "";
-  int r=src.indexOf("\n",p);
-  if (r==-1) r=src.length();
-  src= src.substring(q+1,r);
-  src.trim();
-  return src;
+  return iniHasKey(src, key);
 }
 
-bool BasicESP8266::saveConfig()
+bool BasicESP8266::isInitKey(const String &src, const String &key)
 {
-  String msg="";
-  msg+="ssid="+_eSsid+"\n";
-  msg+="pwd="+_ePwd+"\n";
-  msg+="adr="+getIp()+"\n";
-  msg+="gateway="+getGateway()+"\n";
-  msg+="mask="+getNetmask()+"\n";
+  return iniHasKey(std::string_view(src.c_str(), src.length()), std::string_view(key.c_str(), key.length()));
+}
 
-//  if (_debug) DPRLN (msg);
-  return saveFile("config",msg);
+size_t BasicESP8266::getInitValue(const char *src, const char *key, char *out, size_t outLen)
+{
+  return copyText(iniValue(src, key), out, outLen);
+}
+
+String BasicESP8266::getInitValue(const String &src, const String &key)
+{
+  std::string_view v=iniValue(std::string_view(src.c_str(), src.length()), std::string_view(key.c_str(), key.length()));
+  String res;
+  res.concat(v.data(), v.size());
+  return res;
+}
+
+static void printIp(TextSink &out, const IPAddress &ip)
+{
+  for (int i=0;i<4;i++)
+  {
+    if (i>0) out.print(".");
+    out.print((uint32_t)ip[i]);
+  }
+}
+
+bool BasicESP8266::saveConfig()
+{
+  char msg[CONFIGSIZE];
+  BufferSink out(msg, sizeof(msg));
+  out.print("ssid=");
+  out.print(_eSsid.c_str());
+  out.print("\npwd=");
+  out.print(_ePwd.c_str());
+  out.print("\nadr=");
+  if (_eAdr[0]>0) printIp(out, _eAdr);
+  out.print("\ngateway=");
+  if (_eGateway[0]>0) printIp(out, _eGateway);
+  out.print("\nmask=");
+  if (_eMask[0]>0) printIp(out, _eMask);
+  else out.print("255.255.255.0");
+  out.print("\nbroker=");
+  out.print(_broker.c_str());
+  out.print("\ntopic=");
+  out.print(_devTopic.c_str());
+  out.print("\nport=");
+  out.print((uint32_t)_mqttPort);
+  out.print("\npeer=");
+  out.print(_peerKey.c_str());
+  out.print("\n");
+  if (out.overflow>0) return false;
+  return saveFile("config", msg, out.view().size());
 }
 
 void BasicESP8266::setupWifi(AsyncWebServerRequest *req)
@@ -272,38 +438,62 @@ void BasicESP8266::setupWifi(AsyncWebServerRequest *req)
 
 bool BasicESP8266::_setConfig()
 {
-  if (_debug) DPRLN("loading file 'config'");
-  String fconfig=loadFile("config");
-  if (fconfig=="-1") return false;
-  if (_debug) DPRLN(fconfig);
-  _eSsid=getInitValue(fconfig,"ssid");
-  _ePwd=getInitValue(fconfig,"pwd");
-  _eAdr.fromString(getInitValue(fconfig,"adr"));
-  _eGateway.fromString(getInitValue(fconfig,"gateway"));
-  _eMask.fromString(getInitValue(fconfig,"mask"));
+  LOGD("esp", "loading file 'config'");
+  char fconfig[CONFIGSIZE];
+  char val[81];
+  int len=loadFile("config", fconfig, sizeof(fconfig));
+  if (len<0) return false;
+  LOGD("esp", "config: %d bytes", len);
+  getInitValue(fconfig, "ssid", val, sizeof(val));
+  _eSsid=val;
+  getInitValue(fconfig, "pwd", val, sizeof(val));
+  _ePwd=val;
+  getInitValue(fconfig, "adr", val, sizeof(val));
+  _eAdr.fromString(val);
+  getInitValue(fconfig, "gateway", val, sizeof(val));
+  _eGateway.fromString(val);
+  getInitValue(fconfig, "mask", val, sizeof(val));
+  _eMask.fromString(val);
+  getInitValue(fconfig, "broker", val, sizeof(val));
+  _broker=val;
+  getInitValue(fconfig, "topic", val, sizeof(val));
+  _devTopic=val;
+  if (_devTopic=="") _devTopic="espclock/"+_mac;
+  getInitValue(fconfig, "port", val, sizeof(val));
+  _mqttPort=atoi(val)>0?atoi(val):1883;
+  mqtt=_broker!="";
+  getInitValue(fconfig, "peer", val, sizeof(val));
+  _peerKey=val;
   return true;
 }
 
-bool BasicESP8266::_tryWifi()
+// does not wait for the connection, _pollWifi() does from loop()
+void BasicESP8266::startWifi()
 {
+  BootPhase p("wifi start");
   _nextAPWifiCheck=millis()+_APWifiCheckIntervall;
-  if (_eSsid!="" && _ePwd!="" && !_apFlag)
-  {
-    WiFi.mode(WIFI_STA);
-    if (_eAdr[0]>0) WiFi.config(_eAdr, _eGateway, _eGateway, _eMask);
-    WiFi.begin(_eSsid, _ePwd);
-    _tries=0;
-    if (_debug) DPRLN("\nTrying to connect\n");
-    while(WiFi.status() != WL_CONNECTED && _tries< _MaxTries)
-    {
-       _tries++;
-       if (_debug) DPR(".");
-       delay(500);
-    }
-    if (_debug) DPRLN("\nConnected\n");
+  _wifiStart=millis();
+  _connecting=_eSsid!="" && _ePwd!="" && !_apFlag;
+  if (!_connecting) return;
+  WiFi.mode(WIFI_STA);
+  if (_eAdr[0]>0) WiFi.config(_eAdr, _eGateway, _eGateway, _eMask);
+  WiFi.begin(_eSsid, _ePwd);
+  LOGI("wifi", "Trying to connect");
+  signal(LED_CONNECTING, LEDSTATE);
+}
+
+// true when connected, or when the connection did not come within _MaxTries*500 ms and the AP was started
+bool BasicESP8266::_pollWifi()
+{
+  if (_connecting)
+  {
+    if (WiFi.status()!=WL_CONNECTED && millis()-_wifiStart<_MaxTries*500U) return false;
+    _connecting=false;
+    _tries=(millis()-_wifiStart)/500;
+    cancelSignal(LED_CONNECTING);
     if (WiFi.status()== WL_CONNECTED)
     {
-      if (_debug) DPRF("\nConnected to %s\nIP-Address: %s\nHostname: %s\n",_eSsid.c_str(),WiFi.localIP().toString().c_str(),WiFi.hostname().c_str());
+      LOGI("wifi", "Connected to %s after %d tries, IP-Address: %s, Hostname: %s",_eSsid.c_str(),_tries,WiFi.localIP().toString().c_str(),WiFi.hostname().c_str());
       sIP=WiFi.localIP().toString();
       localIPAdr=WiFi.localIP();
       apmode=false;
@@ -311,28 +501,31 @@ bool BasicESP8266::_tryWifi()
       _apFlag=0;
       _eePutULong(_IND_APFLAG, (long)_apFlag);
       _tries=0;
-      _setserver();
-      sig(3);
+      bootProfile.mark("wifi connected");
+      signal(LED_CONNECTED, LEDNOTICE, 1);
       return true;
     }
   }
 
-    if (_debug) DPRLN("\nConfiguring access point");
+    BootPhase p("ap");
+    LOGI("wifi", "Configuring access point");
     WiFi.mode(WIFI_AP);
-    _mac="ESP"+WiFi.macAddress();
-    _mac.replace(":","");
-    if (_debug) DPRLN ("mac: "+_mac);
+    LOGD("wifi", "mac: %s", _mac.c_str());
     if (WiFi.softAP(_mac,_apPwd?_mac.substring(_mac.length()-8,_mac.length()):""))   // if _withPwd sets password for ap-mode (last 8 digits of mac)
     {
       apmode=true;
+      signal(LED_APMODE, LEDSTATE);
       sIP=WiFi.softAPIP().toString();
-      if (_debug) DPRLN("\nAP + server " + _mac + " at http://" + WiFi.softAPIP().toString() + " started");
+      LOGI("wifi", "AP + server %s at http://%s started", _mac.c_str(), sIP.c_str());
       _nextAPWifiCheck=millis()+_APWifiCheckIntervall;
     }
-    else if (_debug) DPRLN("\nno AP possible");
+    else
+    {
+      LOGE("wifi", "no AP possible");
+      signalCode(LEDCODE_AP);
+    }
 
-  _setserver();
-  return false;
+  return true;
 }
 
 //-----------------------------------------------------------------------------------------------------------------
@@ -340,7 +533,7 @@ bool BasicESP8266::_tryWifi()
 void BasicESP8266::_checkResets()
 {
   _resetCount = _eeGetULong(_IND_RESETCOUNT);
-  if (_debug) DPRF ("Resets within 2 s: %u\n",_resetCount);
+  LOGD("esp", "Resets within 2 s: %u", _resetCount);
   _resetCount++;
   _eePutULong(_IND_RESETCOUNT, (long)_resetCount);
   if (_resetCount >= _RESETLIMIT-1)
@@ -369,43 +562,48 @@ String BasicESP8266::getPostParams(AsyncWebServerRequest *request)
   int count=_setArgs(request);
   String msg="";
   for (int i=0;i<count;i++) msg+=_argKey[i]+"="+_argVal[i]+"\n";
-  if (_debug) DPRLN (msg);
+  LOGD("http", "%d post params", count);
   return msg;
 }
 
 void  BasicESP8266::_setup(AsyncWebServerRequest *request)
   {
-  
-   String ht=wifiHtml1+wifiHtml2+wifiHtml3;
-    ht.replace("##ssid",_eSsid);
-    ht.replace("##pwd",_showWifiPwd?_ePwd:"*****");                       // *****
-    ht.replace("##ip",_eAdr[0]>0?_eAdr.toString():"");
-    ht.replace("##gateway",_eGateway[0]>0?_eGateway.toString():"");
-    ht.replace("##netmask",_eMask[0]>0?_eMask.toString():"255.255.255.0");
-    String res=ht;
-    res=htmlMask(res,false);
-    if (_debug) Serial.println(res);
-    request->send(200, "text/html", res);
-    
-  }
-
-  String mHex(byte c)
-  {
-    char z[]="0123456789abcdef";
-    return String(z[(byte)(c/16)])+String(z[(byte)(c%16)]);
+    AsyncResponseStream *response=request->beginResponseStream("text/html");
+    PrintSink out(*response);
+    htmlBegin(out, "", false);
+    _wifiForm(out);
+    htmlEnd(out, false);
+    request->send(response);
   }
 
-  String mHex8(unsigned long c)
+void BasicESP8266::_wifiForm(TextSink &out)
+{
+  renderTemplate(out, WIFIHTML, [this](TextSink &o, std::string_view name)
   {
-    char z[]="0123456789abcdef";
-    String r="";
-    for (int i=0;i<4;i++)
+    if (name=="ssid") htmlEscape(o, std::string_view(_eSsid.c_str(), _eSsid.length()));
+    else if (name=="pwd")
     {
-      r=String(z[(byte)((c%256)/16)])+String(z[(byte)(c%16)])+r;
-      c=c>>8;
+      if (_showWifiPwd) htmlEscape(o, std::string_view(_ePwd.c_str(), _ePwd.length()));
+      else o.print("*****");
     }
-    return r;
-  }
+    else if (name=="ip") {if (_eAdr[0]>0) printIp(o, _eAdr);}
+    else if (name=="gateway") {if (_eGateway[0]>0) printIp(o, _eGateway);}
+    else if (name=="netmask")
+    {
+      if (_eMask[0]>0) printIp(o, _eMask);
+      else o.print("255.255.255.0");
+    }
+    else if (name=="updateinterval") o.print((uint32_t)_updateinterval);
+    else if (name=="broker") htmlEscape(o, std::string_view(_broker.c_str(), _broker.length()));
+    else if (name=="topic") htmlEscape(o, std::string_view(_devTopic.c_str(), _devTopic.length()));
+    else if (name=="port") o.print((uint32_t)_mqttPort);
+    else if (name=="peer")
+    {
+      if (_showWifiPwd || _peerKey=="") htmlEscape(o, std::string_view(_peerKey.c_str(), _peerKey.length()));
+      else o.print("*****");
+    }
+  });
+}
 
 void BasicESP8266::_setserver()
 {
@@ -419,222 +617,202 @@ void BasicESP8266::_setserver()
   
   server->on("/apsetup",HTTP_POST,[&](AsyncWebServerRequest *request)
   {
-    if (_debug) DPRLN("\nSetup\n");
+    StallSection s("apsetup");
+    LOGD("http", "Setup");
     _nextAPWifiCheck=millis()+10*_APWifiCheckIntervall;
     _setArgs(request);
     boolean apMode=_apFlag;
     String msg="";
-    for (int i=0;i<(sizeof(apsnames)/sizeof(apsnames[0]));i++)
+    for (size_t i=0;i<APSCOUNT;i++)
     {
-      if (apsnames[i]=="pwd")
+      String name=FPSTR(APSNAMES[i]);
+      if (name=="pwd")
       {
-        String val=request->getParam(apsnames[i],true)->value();
+        String val=request->getParam(name,true)->value();
         msg+="pwd="+(val=="*****"?_ePwd:val)+"\n";
       }
-      else msg+=apsnames[i]+"="+(request->hasParam(apsnames[i],true)?request->getParam(apsnames[i],true)->value():"")+"\n";
+      else if (name=="peer" && request->hasParam(name,true))
+      {
+        String val=request->getParam(name,true)->value();
+        msg+="peer="+(val=="*****"?_peerKey:val)+"\n";
+      }
+      else msg+=name+"="+(request->hasParam(name,true)?request->getParam(name,true)->value():"")+"\n";
     }
-    if (_debug) DPRLN (msg);
     saveFile("config",msg);
     _setConfig();
     _apFlag=0;
     _eePutULong(_IND_RESETCOUNT, (long)0);
     _eePutULong(_IND_APFLAG, (long)_apFlag);
-    if (_debug) DPRLN ("Set RESETCOUNT to 0");
+    LOGD("esp", "Set RESETCOUNT to 0");
     String ip=_eAdr.toString();
-    if (_debug) DPRLN("IP: "+ip);
-    String h=ip.indexOf(".")>0?"<html><head></head><body>Restart device and click ok!<br><a href=\"http://"+ip+"\">ok</a></body></html>":
-    "<html><head></head><body>Restart device and connect via DHCP given IP-Address (find out in your router)</body></html>";
+    LOGD("http", "IP: %s", ip.c_str());
+    String h;
+    if (ip.indexOf(".")>0)
+    {
+      h=F("<html><head></head><body>Restart device and click ok!<br><a href=\"http://");
+      h+=ip;
+      h+=F("\">ok</a></body></html>");
+    }
+    else h=F("<html><head></head><body>Restart device and connect via DHCP given IP-Address (find out in your router)</body></html>");
 // <meta http-equiv=\"refresh\" content=\"5; URL=http://"+ip+"\">    
-    if (_debug) DPRLN(h);
     request->send(200, "text/html", h);
   });
   
-  server->on("/info",HTTP_GET,[&](AsyncWebServerRequest *request)
-  {
-    String dir=_getSpiffs(true);
-    String cinf=_chipInfo;
-    cinf.replace("##real",String(realSize));
-    cinf.replace("##ide",String(ideSize));
-    cinf.replace("##mode",chipMode);
-    cinf.replace("##total",String(totalSpiffs));
-    cinf.replace("##used",String(usedSpiffs));
-    cinf.replace("##free",String(freeSpiffs));
-    String ht=wifiHtml1+wifiHtml2+wifiHtml3;
-    ht.replace("##ssid",_eSsid);
-    ht.replace("##pwd",_showWifiPwd?_ePwd:"*****");                       // *****
-    ht.replace("##ip",_eAdr[0]>0?_eAdr.toString():"");
-    ht.replace("##gateway",_eGateway[0]>0?_eGateway.toString():"");
-    ht.replace("##netmask",_eMask[0]>0?_eMask.toString():"255.255.255.0");
-    String res=dir+"<br>"+cinf+ht;
-    res=htmlMask(res,false);
-    if (_debug) Serial.println(res);
-    request->send(200, "text/html", res);
-    
+  _fileApi=new FileApi(fileIndex, _showWifiPwd);
+  _fileApi->infoExtra=[this](TextSink &out)
+  {
+    uint32_t total=0, used=0;
+    fileIndex.usage(total, used);
+    renderTemplate(out, CHIPINFO, [this, total, used](TextSink &o, std::string_view name)
+    {
+      if (name=="real") o.print(realSize);
+      else if (name=="ide") o.print(ideSize);
+      else if (name=="mode") o.print(chipMode.c_str());
+      else if (name=="total") o.print(total);
+      else if (name=="used") o.print(used);
+      else if (name=="free") o.print(total-used);
+    });
+    _wifiForm(out);
+  };
+
+  serveHttp(server, "/info", HTTP_GET, [this](HttpRequest &req, HttpResponse &res)
+  {
+    StallSection s("info");
+    _fileApi->info(req, res);
+  }, HTTPHEAVY);
+
+#if FEATURE_UPLOAD
+  serveUpload(server, "/upload", [this](HttpRequest &req, std::string_view filename, size_t index, const uint8_t *data,
+    size_t len, bool final, HttpResponse *res)
+  {
+    _fileApi->upload(req, filename, index, data, len, final, res);
   });
+#endif
 
-  server->on( "/upload", HTTP_POST, [&]( AsyncWebServerRequest * request )
-  {},
-  [&]( AsyncWebServerRequest * request, String filename, size_t index, uint8_t *data, size_t len, bool final )
+#if FEATURE_HTTPOTA
+  _ota=new OtaUpdate(firmwareWriter, []() -> uint32_t {return millis();});
+  _ota->onStart=[this]() {signal(LED_OTA, LEDBUSY);};
+  _ota->onEnd=[this](bool ok)
   {
-    if ( !index )
-    {
-      if(_debug) Serial.printf( "UPLOAD: Started to receive '%s'.\n", filename.c_str() );
-      f = LittleFS.open("/"+filename, "w+");
-    }
-    for (int i=0;i<len;i++) f.write((char)data[i]);
-    if ( final )
+    cancelSignal(LED_OTA);
+    if (!ok)
     {
-      f.close();
-      if (_debug) Serial.printf( "UPLOAD: Done. Received %ld Bytes.\n", index);
-      request->send(200, "text/html", "\nUPLOAD: Done. Received "+String(index)+" Bytes.\n");
+      signalCode(LEDCODE_OTA, 3);
+      return;
     }
+    _restartDue=true;
+    _restartAt=millis();
+  };
+  // before /update, whose handlers take the URIs below it too
+  serveHttp(server, "/update/status", HTTP_GET, [this](HttpRequest &req, HttpResponse &res)
+  {
+    _ota->status(req, res);
+  }, HTTPLIGHT);
+  serveHttp(server, "/update", HTTP_GET, [this](HttpRequest &req, HttpResponse &res)
+  {
+    _ota->form(req, res);
   });
+  serveUpload(server, "/update", [this](HttpRequest &req, std::string_view filename, size_t index, const uint8_t *data,
+    size_t len, bool final, HttpResponse *res)
+  {
+    _ota->upload(req, filename, index, data, len, final, res);
+  });
+#endif
 
+#if FEATURE_LOG
+  server->on("/log", HTTP_GET, [&] (AsyncWebServerRequest *request)
+  {
+    if (request->hasParam("level")) logger.setLevel(request->getParam("level")->value().toInt());
+    uint32_t since=request->hasParam("since")?request->getParam("since")->value().toInt():0;
+    AsyncResponseStream *response=request->beginResponseStream("text/plain");
+    logger.dump(*response, since);
+    request->send(response);
+  });
+#endif
+
+  server->on("/stall", HTTP_GET, [&] (AsyncWebServerRequest *request)
+  {
+    request->send(200, "text/plain", stallWatch.report());
+  });
+
+  server->on("/idle", HTTP_GET, [&] (AsyncWebServerRequest *request)
+  {
+    AsyncResponseStream *response=request->beginResponseStream("text/plain");
+    PrintSink out(*response);
+    tickless.report(out);
+    request->send(response);
+  });
+
+  server->on("/admission", HTTP_GET, [&] (AsyncWebServerRequest *request)
+  {
+    AsyncResponseStream *response=request->beginResponseStream("text/plain");
+    PrintSink out(*response);
+    httpAdmission.report(out);
+    request->send(response);
+  });
+
+  server->on("/boot", HTTP_GET, [&] (AsyncWebServerRequest *request)
+  {
+    AsyncResponseStream *response=request->beginResponseStream("text/plain");
+    PrintSink out(*response);
+    bootProfile.report(out);
+    request->send(response);
+  });
 
-  
   server->onNotFound([](AsyncWebServerRequest *request) {
       request->send(404, "text/plain", "Not found");
    });  
 
-  server->on("/mem", HTTP_GET, [&] (AsyncWebServerRequest *request) 
+  serveHttp(server, "/files", HTTP_GET, [this](HttpRequest &req, HttpResponse &res)
   {
-    String fn="";
-    String res="";
-    if (request->hasParam("filename")) 
-    {
-      fn = request->getParam("filename")->value();
-      if (fn.charAt(0)!='/')fn="/"+fn;
-      f= LittleFS.open(fn,"r");
-      if(f)
-      {
-        if (_debug) Serial.println("Serving file \""+fn+"\"");    
-        if (fn=="/config")
-        {
-          String fc=loadFile(fn);
-          String pw=getInitValue(fc,"pwd");
-          if (!_showWifiPwd) fc.replace("pwd="+pw,"pwd=*****"); 
-          res=fn+":\n\n"+fc;
-        }
-        else
-        {
-          request->send(f, fn, "application/octet-stream");
-          return;
-        }
-      } 
-      else res="File "+fn+" not found"; 
-      res=htmlMask(res,true);
-    } 
-    else if (request->hasParam("delete")) 
-    {
-      fn = request->getParam("delete")->value();
-      res = _deleteFile(fn)? "File "+fn+" deleted":"File "+fn+" could not be deleted";
-      res=htmlMask(res,true);
-    } 
-    else 
-    {
-      res=htmlMask(_getSpiffs(true),false);
-    }
-    request->send(200, "text/html", res);
-  });
+    _fileApi->files(req, res);
+  }, HTTPLIGHT);
 
-  server->on("/dump", HTTP_GET, [&] (AsyncWebServerRequest *request)
+#if FEATURE_MEM
+  serveHttp(server, "/mem", HTTP_GET, [this](HttpRequest &req, HttpResponse &res)
   {
-    _fn="";
-    if (request->hasParam("filename")) 
-    {
-      _fn = request->getParam("filename")->value();
-      if (_fn.charAt(0)!='/') _fn="/"+_fn;
-      _dumpFormat=0;
-      if (request->hasParam("format"))
-      {
-        String df=request->getParam("format")->value();
-        if (df=="json") _dumpFormat=2; 
-        if (df=="html") _dumpFormat=1;
-      }
-         _n=0;
-        _pos=0;
-        String type="text/plain";
-        if (_dumpFormat==1) type="text/html";
-        if (_dumpFormat==2) type="application/json";
-        f=LittleFS.open(_fn,"r");
-        if (!f || (_fn=="/config" && !_showWifiPwd)) request->send(200, "text/plain", "File not available");
-        else
-        {
-          AsyncWebServerResponse *response = request->beginChunkedResponse(type, [&](uint8_t *buffer, size_t maxLen, size_t index) -> size_t 
-          {
-            char bu[33]="                ";
-            bu[32]=0;
-            String r="";
-            if (!f.available()) return 0;
-            if (_pos==0)
-            {
-              if (_dumpFormat==0) r+=_fn+"\n\n";
-              if (_dumpFormat==1) r+="<!DOCTYPE html>\n<html><body><pre>\n"+_fn+"\n\n";
-              if (_dumpFormat==2) r+="{\"filename\":\""+_fn+"\",\"data\":[";
-            }
-            if (_pos>0)
-            {
-              if (_dumpFormat==0) r+="\n";
-              if (_dumpFormat==1) r+="\n";
-              if (_dumpFormat==2) r+=",";
-            }
-       
-            r+=(_dumpFormat==2?"\"":"")+mHex8(_pos)+": ";
-            int n=0;
-            while (f.available() && n<32)
-            {
-              byte c=(byte)f.read();
-              r+=mHex(c)+(n%2==1?" ":"");
-              bu[n]=(c>32 && c<127 && c!=34 && c!=92)?c:46;
-              n++;
-              _pos++;
-              if (n==32) r+="    "+String(bu)+(_dumpFormat==2?"\"":"");
-            }
-            if (n%32!=0)
-            {
-              for(int i=n%32;i<32;i++)
-              {
-                r+="   ";
-                bu[i]=46;
-              }
-              r+="    "+String(bu)+(_dumpFormat==2?"\"":"");
-            }
-            if (!f.available())
-            {
-              if (_dumpFormat==0) r+="\n";
-              if (_dumpFormat==1) r+="\n</pre></body></html>\n";
-              if (_dumpFormat==2) r+="]}";
-            }  
-
-            int len=r.length();
-            if (len<maxLen) memcpy(buffer, (uint8_t *)r.c_str(),len);
-            else len=0;
-            buffer[len]=0;
-            _n++;
-            return len;
-          });
-          request->send(response);
-        
-      }
-    }
-    else request->send(200,"text/plain", "use <ip>/dump?filename=<filename>");
-  });
-    
-  
-  server->begin();
-  if (_debug) DPRLN("Server started");
+    StallSection s("mem");
+    _fileApi->mem(req, res);
+  }, HTTPHEAVY);
+#endif
+
+#if FEATURE_DUMP
+  serveHttp(server, "/dump", HTTP_GET, [this](HttpRequest &req, HttpResponse &res)
+  {
+    _fileApi->dump(req, res);
+  }, HttpBudget{HttpClass::Heavy, 1, 4000});
+#endif
+}
+
+// ms until loop() has work
+uint32_t BasicESP8266::idleTime()
+{
+  uint32_t ms=IDLEMAX;
+  if (_resetCount>0) ms=millis()>_RESETTIME?0:_RESETTIME-millis();
+  if (_stage==BootStage::Wifi && ms>_WIFIPOLL) ms=_WIFIPOLL;
+  else if (_stage!=BootStage::Wifi && _stage!=BootStage::Done) ms=0;
+#if FEATURE_OTA
+  if (!apmode && ms>_OTAPOLL) ms=_OTAPOLL;
+#endif
+#if FEATURE_HTTPOTA
+  if (_restartDue)
+  {
+    uint32_t wait=millis()-_restartAt>=_RESTARTDELAY?0:_RESTARTDELAY-(millis()-_restartAt);
+    if (wait<ms) ms=wait;
+  }
+#endif
+  return ms;
 }
 
 void BasicESP8266::loop()
 {
+  if (_stage!=BootStage::Done) _bootStep();
 
-  if (!apmode) 
+  if (!apmode && _stage>BootStage::Ota)
   {
+#if FEATURE_OTA
     ArduinoOTA.handle();
-  }
-  else
-  {
-    if (_sigOff==0) {_sigOn=millis()+5000;_sigOff=_sigOn+500;}
+#endif
   }
 
   if (_resetCount>0 && millis()>_RESETTIME) {
@@ -642,21 +820,16 @@ void BasicESP8266::loop()
     _eePutULong(_IND_RESETCOUNT, (long)0);
   }
 
-  if (_sigOn>0 && millis()>_sigOn)
+#if FEATURE_HTTPOTA
+  if (_ota) _ota->writing();      // ends an abandoned upload, and its LED signal
+  if (_restartDue && millis()-_restartAt>=_RESTARTDELAY)
   {
-    digitalWrite(_sigLed,_sigLowActive?LOW:HIGH);
-    _sigOn=0;
-    _sigOff=millis()+_sigOnDur;
-  }
-  
-  if (_sigOff>0 && millis()>_sigOff)
-  {
-    digitalWrite(_sigLed,_sigLowActive?HIGH:LOW);
-    _sigOff=0;
-    if (_sigCount>0)
-    {
-      _sigOn=millis()+_sigOffDur;
-      _sigCount--;
-    }
+    LOGI("ota", "Restart");
+    ESP.restart();
   }
+#endif
+
+#if FEATURE_LOG
+  logger.drain();
+#endif
 }
\ No newline at end of file
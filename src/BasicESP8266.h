@@ -9,12 +9,29 @@
  * AP address is 192.168.4.1
  * /mem?filename=xxx shows contents of file xxx
  * /mem?delete=xxx erases file xxx from SPIFFS
+ * /files lists the files with size, mtime and ETag and the used and free bytes as JSON (?format=html), from
+ * the FileIndex in RAM, which uploads, deletes and config writes keep current
  * /info shows directory of SPIFFS, properties of the ESP8266 chip and provides a form to set WiFi and MQTT
+ * (broker, base topic and port of the clock's MQTT interface, no broker = no MQTT) and the passphrase of
+ * the peer time sync (see PeerSync.h, empty = off)
  * 
  * resetting 5 times within 2 seconds sets the AP flag. The ESP will not switch to STA mode
  * and will not connect to Wifi specified in config
  * 
  * resetting 5 times within 2 seconds again switches off the AP mode
+ *
+ * /log shows the log ring buffer (?since=<seq>, ?level=<0..3>)
+ * /stall shows loop stalls and the code path that was running at the last watchdog reset
+ *
+ * the signal LED plays the patterns of LedPatterns.h from a Ticker, the loop does not poll it
+ * /idle shows the duty cycle of the loop, which sleeps between its deadlines (TicklessIdle)
+ * /admission shows the requests admitted, queued and rejected per route (HttpAdmission)
+ * /boot shows the time and free heap of each boot phase (BootProfile); begin() only brings up what the clock
+ * needs, startWifi() starts to connect after the clock's begin(), loop() waits for the connection or the AP
+ * and then starts the web server with the routes of onNetwork, NTP and OTA one stage per pass
+ * /update takes a firmware (also gzip compressed) or file system image and restarts, /update/status has its
+ * progress (OtaUpdate), in AP mode too
+ * the time comes from the SNTP client of the core in UTC, to the ms (getEpochTime), every updateinterval
  * 
  * written by Dr. Hans-Jürgen Weber at 12.05.2020
  * last modification 10.04.2022
@@ -28,111 +45,116 @@
 //#include <ESP8266mDNS.h>
 #include "EEPROM.h"
 #include <ESPAsyncWebServer.h>
+#include "Features.h"
+#if FEATURE_OTA
 #include <ArduinoOTA.h>
+#endif
 #include "LittleFS.h"
 #include <WiFiUdp.h>
-#include <NTPClient.h>
-
-
-
-
-#define DPR(args...)    Serial.print(args)
-#define DPRLN(args...)    Serial.println(args)
-#define DPRF(args...)    Serial.printf(args)
-#define DPRW(args...) Serial.write(args)
+#include <Ticker.h>
+#include "StallWatch.h"
+#include "BootProfile.h"
+#include "TicklessIdle.h"
+#include "Logger.h"
+#include "TextUtil.h"
+#include "Pages.h"
+#include "FileApi.h"
+#if FEATURE_HTTPOTA
+#include "OtaUpdate.h"
+#endif
+#include "LedPatterns.h"
 
 #define ESIZE 16
 #define MAXARGS 30
+#define CONFIGSIZE 512
 #define SHOWWIFIPWD false
-#define ntp true
+
+enum class BootStage : uint8_t { Wifi, Server, Ntp, Ota, Files, Done };
 
 class BasicESP8266
 {
   public:
-    BasicESP8266(boolean debug, int sigLed, boolean sigLowActive, bool apPwd, bool showWifiPwd);
+    BasicESP8266(int sigLed, boolean sigLowActive, bool apPwd, bool showWifiPwd);
     void begin();
+    void startWifi();
     void loop();
-    bool setSig(uint32_t onDur, uint32_t offDur, uint8_t sigCount);
-    bool sig(int n);
-    String htmlMask(String a, bool citation, String title);
+    bool signal(const LedPattern &pattern, uint8_t priority, uint8_t cycles=0);
+    bool signalCode(uint8_t code, uint8_t cycles=0);
+    void cancelSignal(const LedPattern &pattern);
+    bool signalling() const {return _sigSeq.current()!=nullptr;}
+    uint32_t idleTime();
     String getPostParams(AsyncWebServerRequest *req);
-    String getInitValue(String src, String key);
-    int countInitKeys(String src);
-    bool isInitKey(String src, String key);
-    bool saveFile(String fname, String finhalt);
-    String loadFile(String fname);
-    String getSsid();
-    String getPwd();
+
+    // allocation free versions: views in, caller buffer or TextSink out
+    void htmlMask(TextSink &out, std::string_view a, bool citation=true, std::string_view title="");
+    size_t getInitValue(const char *src, const char *key, char *out, size_t outLen);
+    int countInitKeys(const char *src);
+    bool isInitKey(const char *src, const char *key);
+    bool saveFile(const char *fname, const char *data, size_t len);
+    int loadFile(const char *fname, char *buf, size_t len);   // bytes read or -1
+    void setSsid(const char *ssid);
+    void setPwd(const char *pwd);
+    void setIp(const char *ip);
+    void setGateway(const char *gateway);
+    void setNetmask(const char *netmask);
+    void setUpdateInterval(const char *updateinterval);
+    const String &getSsid();
+    const String &getPwd();
+    const String &getBroker();
+    const String &getTopic();
+    uint16_t getMqttPort();
+    const String &getMac();
+    const String &getPeerKey();
+
+    // String versions, wrappers of the above
+    String htmlMask(const String &a, bool citation=true, const String &title="");
+    String getInitValue(const String &src, const String &key);
+    int countInitKeys(const String &src);
+    bool isInitKey(const String &src, const String &key);
+    bool saveFile(const String &fname, const String &finhalt);
+    String loadFile(const String &fname);
     String getIp();
     String getGateway();
     String getNetmask();
-    void setSsid(String ssid);
-    void setPwd(String pwd);
-    void setIp(String ip);
-    void setGateway(String gateway);
-    void setNetmask(String netmask);
-    void setUpdateInterval(String updateinterval);
-    void setTZOffset(String tzoffset);
+    void setSsid(const String &ssid) {setSsid(ssid.c_str());}
+    void setPwd(const String &pwd) {setPwd(pwd.c_str());}
+    void setIp(const String &ip) {setIp(ip.c_str());}
+    void setGateway(const String &gateway) {setGateway(gateway.c_str());}
+    void setNetmask(const String &netmask) {setNetmask(netmask.c_str());}
+    void setUpdateInterval(const String &updateinterval) {setUpdateInterval(updateinterval.c_str());}
     void setupWifi(AsyncWebServerRequest *req);
     bool saveConfig();
     
     uint32_t realSize = ESP.getFlashChipRealSize();
     uint32_t ideSize = ESP.getFlashChipSize();
-    uint32_t freeSpiffs=0;
-    uint32_t totalSpiffs=0;
-    uint32_t usedSpiffs=0;
     String chipMode;
     String sIP="";
     IPAddress localIPAdr={0,0,0,0};
-    File f;    
 
     WiFiClient espClient;
     AsyncWebServer *server;
-#ifdef ntp
-    WiFiUDP ntpUDP;
-    NTPClient *timeClient;
-    uint32_t getEpochTime();
-
+#if FEATURE_NTP
+    uint32_t getEpochTime(uint16_t &ms);
+    void setNtpActive(bool on);
 #endif
 
     unsigned long getUpdateInterval();
     bool apmode=true;
     bool mqtt=false;
     unsigned long connectedAt=0;
+    std::function<void()> onNetwork;  // once connected or in AP mode, the routes before the server starts
 
     String tempstr="";
 
-    String apsnames[8]={"ssid","pwd","adr","gateway","mask","broker","topic","port"};
-  
-    String wifiHtml1=
-    "<form action='/apsetup' method='POST'>\n";
-    String wifiHtml2=
-    "<table style='background-color:#ffff80;'>\n"
-    "<tr><td>WiFi name (SSID):</td><td><input type='text' size='30' maxlength='80' name='ssid' id='ssid' value='##ssid'></td></tr>\n"
-    "<tr><td>Password:</td><td><input type='text' size='30' maxlength='80' name='pwd' id='pwd' value='##pwd'></td></tr>\n"
-    "<tr><td>Static IP address (empty=DHCP):</td><td><input type='text' size='15' maxlength='15' name='adr' id='adr' value='##ip'></td></tr>\n"
-    "<tr><td>Gateway:</td><td><input type='text' size='15' maxlength='15' name='gateway' id='gateway' value='##gateway'></td></tr>\n"
-    "<tr><td>Netmask:</td><td><input type='text' size='15' maxlength='15' name='mask' id='mask' value='##netmask'></td></tr>"
-    "<tr><td>NTP Update Interval:</td><td><input type='text' size='15' maxlength='15' name='updateinterval' id='updateinterval' value='##updateinterval'></td></tr>"
-    "<tr><td>Timezone offset (in seconds):</td><td><input type='text' size='15' maxlength='15' name='tzoffset' id='tzoffset' value='##tzoffset'></td></tr>"
-    "<tr><td>&#160;</td><td>&#160;</td></tr>\n"
-    "</table>\n";
-    String wifiHtml3=
-    "<br><input type='submit' value='ok' name='ok'>\n"
-    "</form>\n";
-
-
-
    
   private:    void _setup(AsyncWebServerRequest *request);
     bool _apPwd;
     bool _showWifiPwd;
-    String _getSpiffs(bool table);
-    bool _deleteFile(String fname);
     uint32_t _eeGetULong(int adr);    // holt einen 32BitUWert von adr
     void _eePutULong(int adr, uint32_t val); // speichert einen 32BitUWert val an adr
     bool _setConfig();
-    bool _tryWifi();
+    bool _pollWifi();
+    void _bootStep();
     void _checkResets();
     void _setserver();
     void _onChipInfo(AsyncWebServerRequest *request);
@@ -140,15 +162,14 @@ class BasicESP8266
     int _setArgs(AsyncWebServerRequest *req);
     String _infStr(String dinfo);
     bool _inform();
+    void _wifiForm(TextSink &out);
+    void _sigUpdate();
+    void _sigStep();
     
-    boolean _debug; 
     int _sigLed;
     boolean _sigLowActive;
-    uint32_t _sigOn=0;
-    uint32_t _sigOff=0;
-    uint32_t _sigOnDur=0;
-    uint32_t _sigOffDur=0;
-    uint8_t _sigCount=0;
+    LedSequencer _sigSeq;
+    Ticker _sigTicker;
     
     uint32_t _resetCount=0;
     const uint32_t _RESETTIME=2000;  // Reset within 2 seconds
@@ -156,6 +177,13 @@ class BasicESP8266
     bool _apFlag=false;              // Accesspoint flag true, if no EEPROM information
     const uint8_t _IND_APFLAG=4;     // postition in EEPROM
     const uint8_t _IND_RESETCOUNT=0; 
+    const uint32_t _STALLBUDGET=250;  // ms per loop iteration or section
+    const uint32_t _OTAPOLL=1000;     // ms, espota waits about 10 s for the answer to its invitation
+    const uint32_t _WIFIPOLL=100;     // ms, of the connection while booting
+    BootStage _stage=BootStage::Wifi;
+    bool _connecting=false;           // WiFi.begin() without result yet
+    uint32_t _wifiStart=0;
+    const uint32_t _RESTARTDELAY=1000; // ms after an update over HTTP, for its answer to go out
 
     int _tries=0;
     const int _MaxTries=30;
@@ -168,30 +196,24 @@ class BasicESP8266
     IPAddress _eGateway;
     IPAddress _eMask;
     unsigned long _updateinterval=1800000;
-    int _tzoffset=-21600;
+    bool _ntpSynced=false;            // the SNTP client has set the time
     String _argVal[MAXARGS];
     String _argKey[MAXARGS];
     int _argCount = 0;
-    String _devTopic="";
+    String _broker="";
+    String _devTopic="";              // base topic, espclock/<mac> if not set
+    uint16_t _mqttPort=1883;
+    String _peerKey="";               // passphrase of the peer time sync, empty = off
     uint32_t _lastTry=0;
     uint32_t _ccTimer=0;
     uint32_t _connectionCheckTime=5000;
-    uint8_t _n=0;    // for debugging
-    unsigned long _pos=0;
-    String _fn="";
-    int _dumpFormat=0;     // 0= plain text,  1= html,  2=json
+    FileApi *_fileApi=nullptr;
+#if FEATURE_HTTPOTA
+    OtaUpdate *_ota=nullptr;
+    bool _restartDue=false;
+    uint32_t _restartAt=0;
+#endif
 
     String _mac="";
-    
-    String _chipInfo=
-      "<table style='background-color:#d0d0d0';>\n"
-      "<tr><td>Chip real size</td><td>##real</td><tr>\n"
-      "<tr><td>Chip ide size</td><td>##ide</td><tr>\n"
-      "<tr><td>Chip mode</td><td>##mode</td><tr>\n"
-      "<tr><td>SPIFFS total memory</td><td>##total</td><tr>\n"
-      "<tr><td>SPIFFS used memory</td><td>##used</td><tr>\n"
-      "<tr><td>SPIFFS free memory</td><td>##free</td><tr>\n"
-      "</table><br>\n";
-
 };
 #endif
@@ -0,0 +1,94 @@
+#include "BootProfile.h"
+#include "Logger.h"
+
+BootProfile bootProfile;
+
+// -1 when the table is full, end() ignores it then
+int BootProfile::start(const char *name)
+{
+  if (_count>=BOOTPHASES) return -1;
+  BootEntry &e=_entries[_count];
+  e.name=name;
+  e.at=micros64();
+  e.us=0;
+  e.heap=0;
+  return _count++;
+}
+
+void BootProfile::end(int index)
+{
+  if (index<0) return;
+  BootEntry &e=_entries[index];
+  e.us=micros64()-e.at;
+  e.heap=ESP.getFreeHeap();
+  LOGD("boot", "%s: %u us", e.name, (uint32_t)e.us);
+#if FEATURE_LOG
+  if (!_looping) logger.drain();      // loop() drains from then on
+#endif
+}
+
+void BootProfile::mark(const char *name)
+{
+  int index=start(name);
+  if (index<0) return;
+  _entries[index].heap=ESP.getFreeHeap();
+  LOGD("boot", "%s at %u ms", name, (uint32_t)(_entries[index].at/1000));
+#if FEATURE_LOG
+  if (!_looping) logger.drain();      // loop() drains from then on
+#endif
+}
+
+// at the end of setup()
+void BootProfile::setupDone()
+{
+  mark("loop");
+  _looping=true;
+}
+
+void BootProfile::done()
+{
+  if (_doneAt) return;
+  _doneAt=micros64();
+  LOGI("boot", "Boot done after %u ms, free heap %u", (uint32_t)(_doneAt/1000), ESP.getFreeHeap());
+#if FEATURE_LOG
+  if (logger.dropped()) LOGW("log", "%u messages dropped while booting", logger.dropped());
+#endif
+}
+
+void BootProfile::report(TextSink &out)
+{
+  for (int i=0;i<_count;i++)
+  {
+    const BootEntry &e=_entries[i];
+    out.print(e.name);
+    out.print(": at ");
+    out.print((uint32_t)(e.at/1000));
+    out.print(" ms");
+    if (e.us)
+    {
+      out.print(", ");
+      out.print((uint32_t)e.us);
+      out.print(" us");
+    }
+    out.print(", heap ");
+    out.print(e.heap);
+    out.print("\n");
+  }
+  if (_doneAt)
+  {
+    out.print("Boot done after ");
+    out.print((uint32_t)(_doneAt/1000));
+    out.print(" ms\n");
+  }
+  else out.print("Boot running\n");
+}
+
+BootPhase::BootPhase(const char *name)
+{
+  _index=bootProfile.start(name);
+}
+
+BootPhase::~BootPhase()
+{
+  bootProfile.end(_index);
+}
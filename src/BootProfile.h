@@ -0,0 +1,58 @@
+/* Boot phase profiler
+ *
+ * Times the phases of the boot (BootPhase, from its constructor to its destructor) and marks single
+ * events (mark()) with micros64(), which counts from the reset and does not wrap, and records the free
+ * heap after each. The boot runs in stages: setup() shows dashes on the display (the button runs from its
+ * constructor on), then brings up the LED, EEPROM, LittleFS and the config, starts the clock and only
+ * then starts WiFi; loop() waits for the connection in the background and starts the web server, NTP,
+ * OTA and the rest one stage per pass, so the display ticks in between (BasicESP8266::loop).
+ * done() ends the boot and logs its length, /boot shows every phase.
+ */
+
+#ifndef BootProfile_h
+#define BootProfile_h
+
+#include <Arduino.h>
+#include "TextUtil.h"
+
+#define BOOTPHASES 16
+
+struct BootEntry
+{
+  const char *name;
+  uint64_t at;      // us since the reset at the start, micros64() width
+  uint64_t us;      // duration, 0 for a mark
+  uint32_t heap;    // free at the end
+};
+
+class BootProfile
+{
+  public:
+    int start(const char *name);
+    void end(int index);
+    void mark(const char *name);
+    void setupDone();
+    void done();
+    bool complete() const {return _doneAt!=0;}
+    void report(TextSink &out);
+
+  private:
+    BootEntry _entries[BOOTPHASES];
+    uint8_t _count=0;
+    bool _looping=false;
+    uint64_t _doneAt=0;   // us since the reset
+};
+
+class BootPhase
+{
+  public:
+    BootPhase(const char *name);
+    ~BootPhase();
+
+  private:
+    int _index;
+};
+
+extern BootProfile bootProfile;
+
+#endif
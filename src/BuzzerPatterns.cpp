@@ -0,0 +1,53 @@
+#include "BuzzerPatterns.h"
+
+#define N(steps) (sizeof(steps) / sizeof(steps[0]))
+
+static const ToneStep CLASSIC[] = {
+    { TONE_DC, 500, 100, 100 },
+    { 0, 500, 0, 0 }
+};
+
+static const ToneStep BEEP[] = {
+    { 2700, 100, 50, 50 },
+    { 0, 100, 0, 0 },
+    { 2700, 100, 50, 50 },
+    { 0, 700, 0, 0 }
+};
+
+static const ToneStep RISING[] = {
+    { 2000, 150, 50, 50 },
+    { 2400, 150, 50, 50 },
+    { 2900, 150, 50, 50 },
+    { 0, 550, 0, 0 }
+};
+
+// swells from quiet to full over a second
+static const ToneStep GENTLE[] = {
+    { 2700, 1000, 3, 50 },
+    { 2700, 200, 50, 0 },
+    { 0, 800, 0, 0 }
+};
+
+static const ToneStep CHIME[] = {
+    { 2100, 400, 50, 5 },
+    { 1600, 600, 50, 5 },
+    { 0, 1000, 0, 0 }
+};
+
+const TonePattern BUZZERPATTERNS[] = {
+    { "classic", CLASSIC, N(CLASSIC), true },
+    { "beep", BEEP, N(BEEP), true },
+    { "rising", RISING, N(RISING), true },
+    { "gentle", GENTLE, N(GENTLE), true },
+    { "chime", CHIME, N(CHIME), true }
+};
+
+const uint8_t BUZZERPATTERNCOUNT = N(BUZZERPATTERNS);
+
+const TonePattern *buzzerPattern(std::string_view name) {
+    for(int i = 0; i < BUZZERPATTERNCOUNT; i++)
+        if(name == BUZZERPATTERNS[i].name)
+            return &BUZZERPATTERNS[i];
+
+    return nullptr;
+}
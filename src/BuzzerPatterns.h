@@ -0,0 +1,20 @@
+/* Alarm sounds
+ *
+ * The patterns the buzzer can play, selected by name ("pattern" in the clock config, /alarm/pattern).
+ * "classic" is the 1 Hz on/off of an active buzzer, the others are tones for a passive one.
+ * The tables stay in RAM, the timer interrupt reads them (see TonePattern).
+ */
+
+#ifndef BuzzerPatterns_h
+#define BuzzerPatterns_h
+
+#include <string_view>
+#include "hal/Hal.h"
+
+extern const TonePattern BUZZERPATTERNS[];
+extern const uint8_t BUZZERPATTERNCOUNT;
+
+// nullptr if unknown
+const TonePattern *buzzerPattern(std::string_view name);
+
+#endif
@@ -0,0 +1,285 @@
+#include "ClockApi.h"
+#include <memory>
+#include "Logger.h"
+#include "BuzzerPatterns.h"
+#include "ClockPage.h"
+
+// ArduinoJson writer into a TextSink
+struct JsonSink {
+    TextSink &out;
+    size_t write(uint8_t c) {
+        out.write((const char *)&c, 1);
+        return 1;
+    }
+    size_t write(const uint8_t *s, size_t n) {
+        out.write((const char *)s, n);
+        return n;
+    }
+};
+
+// ArduinoJson writer appending to a string, '<' escaped so the JSON cannot end an inline script
+struct ScriptSink {
+    std::string &out;
+    size_t write(uint8_t c) {
+        if(c == '<')
+            out += "\\u003c";
+        else
+            out += (char)c;
+        return 1;
+    }
+    size_t write(const uint8_t *s, size_t n) {
+        for(size_t i = 0; i < n; i++)
+            write(s[i]);
+        return n;
+    }
+};
+
+static bool endsWith(std::string_view s, std::string_view suffix) {
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// decimal digits only, false on anything else or overflow
+static bool parseNumber(std::string_view s, uint32_t &v) {
+    v = 0;
+    if(s.empty() || s.size() > 9)
+        return false;
+    for(char c : s) {
+        if(c < '0' || c > '9')
+            return false;
+        v = v * 10 + (c - '0');
+    }
+    return true;
+}
+
+static const char *const TIMERMODES[] = { "off", "countdown", "stopwatch" };
+
+ClockApi::ClockApi(ClockCore &core) : _core(core) {
+}
+
+// dispatch by path, false if the path is not a clock endpoint
+bool ClockApi::handle(HttpRequest &req, HttpResponse &res) {
+    std::string_view path = req.path();
+
+    if(path.substr(0, 7) == "/alarm/")
+        alarm(req, res);
+    else if(path.substr(0, 7) == "/timer/")
+        timer(req, res);
+    else if(path == "/currenttime")
+        currentTime(req, res);
+    else if(path == "/timezones")
+        timeZones(req, res);
+    else if(path == "/clockconfig")
+        clockConfig(req, res);
+    else
+        return false;
+
+    return true;
+}
+
+void ClockApi::alarm(HttpRequest &req, HttpResponse &res) {
+    JsonDocument status;
+    JsonObject fields = status.to<JsonObject>();
+    std::string_view command = req.path();
+    std::string_view name;
+    const TonePattern *pattern = nullptr;
+
+    if(req.param("pattern", name) || req.param("name", name)) {
+        pattern = buzzerPattern(name);
+        if(!pattern)
+            status["error"] = "Unknown pattern";
+    }
+
+    if(endsWith(command, "on")) {
+        if(status["error"].isNull() && !_core.setAlarm(true, pattern))
+            status["error"] = "Alarm is already on";
+    } else if(endsWith(command, "off")) {
+        if(!_core.setAlarm(false))
+            status["error"] = "Alarm is already off";
+    } else if(endsWith(command, "snooze")) {
+        if(!_core.snooze())
+            status["error"] = "Alarm is not on";
+    } else if(endsWith(command, "patterns")) {
+        JsonArray names = status["patterns"].to<JsonArray>();
+        for(int i = 0; i < BUZZERPATTERNCOUNT; i++)
+            names.add(BUZZERPATTERNS[i].name);
+    } else if(endsWith(command, "pattern")) {
+        if(pattern) {
+            JsonDocument config;
+            config["pattern"] = pattern->name;
+            _core.updateConfig(config.as<JsonObjectConst>());
+        } else if(status["error"].isNull())
+            status["error"] = "Missing pattern name";
+    } else if(!endsWith(command, "status"))
+        status["error"] = "No valid command found. Must be on, off, snooze, pattern, patterns or status. Sending status.";
+
+    _alarmStatus(fields);
+    JsonSink out{res};
+    res.begin(200, "text/json");
+    serializeJson(status, out);
+}
+
+void ClockApi::timer(HttpRequest &req, HttpResponse &res) {
+    JsonDocument status;
+    std::string_view command = req.path();
+    std::string_view value;
+    const TonePattern *pattern = nullptr;
+
+    if(req.param("pattern", value)) {
+        pattern = buzzerPattern(value);
+        if(!pattern)
+            status["error"] = "Unknown pattern";
+    }
+
+    if(endsWith(command, "countdown")) {
+        uint32_t n = 0, ms = 0;
+        if(req.param("ms", value) && parseNumber(value, n))
+            ms = n;
+        else if(req.param("seconds", value) && parseNumber(value, n) && n <= TIMERMAX / 1000)
+            ms = n * 1000;
+
+        if(ms == 0 || ms > TIMERMAX)
+            status["error"] = "Missing or invalid seconds or ms";
+        else if(status["error"].isNull())
+            _core.countdown(ms, pattern);
+    } else if(endsWith(command, "stopwatch")) {
+        _core.stopwatch();
+    } else if(endsWith(command, "pause")) {
+        if(!_core.pauseTimer(true))
+            status["error"] = "Timer is not running";
+    } else if(endsWith(command, "resume")) {
+        if(!_core.pauseTimer(false))
+            status["error"] = "Timer is running, off or expired";
+    } else if(endsWith(command, "reset")) {
+        _core.resetTimer();
+    } else if(endsWith(command, "off")) {
+        _core.timerOff();
+    } else if(!endsWith(command, "status"))
+        status["error"] = "No valid command found. Must be countdown, stopwatch, pause, resume, reset, off or status. Sending status.";
+
+    ClockTimer &timer = _core.timer();
+    uint32_t ms = _core.millis();
+    status["mode"] = TIMERMODES[timer.mode()];
+    status["running"] = timer.running();
+    status["shown"] = _core.timerShown();
+    status["ringing"] = _core.timerShown() && _core.alarmOn();
+    status["elapsed"] = timer.elapsed(ms);
+    status["remaining"] = timer.remaining(ms);
+    status["duration"] = timer.duration();
+
+    const TimerStats &stats = _core.timerStats();
+    JsonObject counters = status["counters"].to<JsonObject>();
+    counters["expired"] = stats.expired;
+    counters["lastlate"] = stats.lastLate;
+    counters["maxlate"] = stats.maxLate;
+    JsonSink out{res};
+    res.begin(200, "text/json");
+    serializeJson(status, out);
+}
+
+void ClockApi::currentTime(HttpRequest &req, HttpResponse &res) {
+    JsonDocument jsonResponse;
+    jsonResponse["currenttime"] = _core.currentTime();
+    jsonResponse["timezone"] = _core.timeZone().zone().name;
+    jsonResponse["utcoffset"] = _core.timeZone().offset();
+    jsonResponse["dst"] = _core.timeZone().dst();
+
+    const RefreshStats &stats = _core.refreshStats();
+    JsonObject refresh = jsonResponse["refresh"].to<JsonObject>();
+    refresh["count"] = stats.count;
+    refresh["late"] = stats.late;
+    refresh["meanlate"] = stats.count ? stats.sumLate / stats.count : 0;
+    refresh["maxlate"] = stats.maxLate;
+    refresh["lastlate"] = stats.lastLate;
+    JsonSink out{res};
+    res.begin(200, "text/json");
+    serializeJson(jsonResponse, out);
+}
+
+void ClockApi::timeZones(HttpRequest &req, HttpResponse &res) {
+    JsonDocument jsonResponse;
+    JsonArray names = jsonResponse["timezones"].to<JsonArray>();
+    for(int i = 0; i < TZZONECOUNT; i++)
+        names.add(TZZONES[i].name);
+    JsonSink out{res};
+    res.begin(200, "text/json");
+    serializeJson(jsonResponse, out);
+}
+
+void ClockApi::clockConfig(HttpRequest &req, HttpResponse &res) {
+    LOGD("http", "Getting clockconfig request");
+    JsonSink out{res};
+
+    if(req.method() == HttpMethod::Post || req.method() == HttpMethod::Put) {
+        JsonDocument json;
+        std::string_view body = req.body();
+
+        if(deserializeJson(json, body.data(), body.size()) != DeserializationError::Ok || !json.is<JsonObject>()) {
+            res.begin(400, "application/json");
+            res.print("{\"error\":\"invalid json\"}");
+            return;
+        }
+
+        res.begin(200, "application/json");
+
+        if(req.method() == HttpMethod::Post) {
+            LOGD("http", "Reading in new clockconfig data");
+            _core.updateConfig(json.as<JsonObjectConst>());
+            serializeJson(json, out);
+        } else {
+            JsonDocument responseJson;
+            responseJson["persist"] = _core.persistConfig();
+            serializeJson(responseJson, out);
+        }
+
+    } else {
+        res.begin(200, "application/json");
+        serializeJson(_core.config(), out);
+    }
+}
+
+// false if the client does not take gzip, the caller serves the page from the file system then
+bool ClockApi::clockPage(HttpRequest &req, HttpResponse &res) {
+    std::string_view accept;
+    if(!req.header("Accept-Encoding", accept) || accept.find("gzip") == std::string_view::npos)
+        return false;
+
+    JsonDocument state;
+    state["config"] = _core.config().as<JsonVariantConst>();
+    _alarmStatus(state["alarm"].to<JsonObject>());
+    JsonArray patterns = state["patterns"].to<JsonArray>();
+    for(int i = 0; i < BUZZERPATTERNCOUNT; i++)
+        patterns.add(BUZZERPATTERNS[i].name);
+    JsonArray zones = state["timezones"].to<JsonArray>();
+    for(int i = 0; i < TZZONECOUNT; i++)
+        zones.add(TZZONES[i].name);
+
+    std::string fragment;
+    fragment.reserve(measureJson(state) + 40);
+    fragment += "<script>const STATE = ";
+    ScriptSink out{fragment};
+    serializeJson(state, out);
+    fragment += ";</script>\n";
+
+    auto page = std::make_shared<GzipTemplate>(CLOCKPAGEHEAD, CLOCKPAGETAIL, std::move(fragment));
+    res.stream(200, "text/html", [page](uint8_t *buf, size_t maxLen, size_t index) -> size_t {
+        return page->fill(buf, maxLen, index);
+    });
+    res.header("Content-Encoding", "gzip");
+    res.header("Cache-Control", "no-store");
+    return true;
+}
+
+void ClockApi::_alarmStatus(JsonObject status) {
+    status["alarmon"] = _core.alarmOn();
+    status["snoozed"] = _core.alarms().snoozed();
+    status["nextalarm"] = _core.alarms().next();
+    status["pattern"] = _core.pattern().name;
+
+    const AlarmStats &stats = _core.alarms().stats();
+    JsonObject counters = status["counters"].to<JsonObject>();
+    counters["fired"] = stats.fired;
+    counters["late"] = stats.late;
+    counters["missed"] = stats.missed;
+    counters["maxlate"] = stats.maxLate;
+    counters["backsteps"] = stats.backSteps;
+}
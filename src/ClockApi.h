@@ -0,0 +1,42 @@
+/* Clock endpoints
+ *
+ * /alarm/on[?pattern=x], /alarm/off, /alarm/snooze, /alarm/pattern?name=x (selects the alarm sound),
+ * /alarm/patterns, /alarm/status, /currenttime, /timezones and /clockconfig (GET, POST new values, PUT
+ * persists), written against Http.h so they run on the ESP8266 and on the host.
+ * /currenttime has the zone, its UTC offset and DST flag besides the hhmm, /timezones lists the zone names
+ * "timezone" of the clock config takes. Its "refresh" tells how late the display ticks come after the
+ * boundaries of the second, in ms (see ClockCore::refreshStats()).
+ * The alarm status has "nextalarm", the local epoch seconds of the next alarm or 0, and the "counters"
+ * of fired, late and missed alarms (see AlarmScheduler.h).
+ * /timer/countdown?seconds=n (or ms=n, optional pattern=x), /timer/stopwatch, /timer/pause, /timer/resume,
+ * /timer/reset, /timer/off and /timer/status control the timer (see ClockTimer.h), the status has the times
+ * in ms and how late the expired countdowns rang.
+ * clockPage() serves /clock in one response: the page precompressed in flash (ClockPage.h, made by
+ * tools/gzippage.py from data/index.html) with the config, the alarm status and the pattern and time zone
+ * names inlined as STATE, so the page shows them without further requests.
+ */
+
+#ifndef ClockApi_h
+#define ClockApi_h
+
+#include "Http.h"
+#include "ClockCore.h"
+
+class ClockApi {
+    public:
+        ClockApi(ClockCore &core);
+        bool handle(HttpRequest &req, HttpResponse &res);
+        void alarm(HttpRequest &req, HttpResponse &res);
+        void timer(HttpRequest &req, HttpResponse &res);
+        void currentTime(HttpRequest &req, HttpResponse &res);
+        void timeZones(HttpRequest &req, HttpResponse &res);
+        void clockConfig(HttpRequest &req, HttpResponse &res);
+        bool clockPage(HttpRequest &req, HttpResponse &res);
+
+    private:
+        ClockCore &_core;
+
+        void _alarmStatus(JsonObject status);
+};
+
+#endif
@@ -0,0 +1,678 @@
+#include "ClockCore.h"
+#include "Features.h"
+#include "Logger.h"
+#include "BuzzerPatterns.h"
+
+static bool copyAlarms(JsonArrayConst in, JsonArray out);
+
+static const uint8_t DIGITS[] = {
+    0x3f, 0x06, 0x5b, 0x4f, 0x66, 0x6d, 0x7d, 0x07,
+    0x7f, 0x6f, 0x77, 0x7c, 0x39, 0x5e, 0x79, 0x71
+};
+
+ClockCore::ClockCore(Hal &hal) : _hal(hal) {
+    _pattern = &BUZZERPATTERNS[0];
+}
+
+uint8_t ClockCore::encodeDigit(uint8_t digit) {
+    return DIGITS[digit & 0x0f];
+}
+
+// before begin(), which needs the file system: dashes at the default brightness until the first tick
+void ClockCore::showBooting() {
+    uint8_t data[4] = { SEG_G, SEG_G | SEG_COLON, SEG_G, SEG_G };
+    _hal.display.setBrightness(_brightness);
+    _hal.display.setSegments(data);
+}
+
+void ClockCore::begin() {
+    if(!_loadConfig(_clockConfig)) {
+        _clockConfig["brightness"] = _brightness;
+        _clockConfig["blink"] = _blink;
+        _clockConfig["alarms"].to<JsonArray>();
+        _clockConfig["snooze"] = _snoozeMinutes;
+        _clockConfig["pattern"] = _pattern->name;
+        _clockConfig["twelvehours"] = _twelveHours;
+        _clockConfig["timezone"] = TZDEFAULT;
+        _saveConfig();
+    } else if(!_clockConfig["alarms"].is<JsonArray>())
+        _migrateConfig();
+
+    _applyClockConfig();
+    _hal.display.clear();
+    _displayState = CLOCK;
+}
+
+void ClockCore::pollButton() {
+    switch(_hal.button.poll()) {
+        case BUTTON_CLICK: click(); break;
+        case BUTTON_LONGPRESS: longPress(); break;
+        case BUTTON_DOUBLECLICK: doubleClick(); break;
+        default: break;
+    }
+}
+
+// ms until tick() has work: the start of the next minute on the display, an alarm or the NTP update, 0 while
+// the display changes on every tick (blinking colon, a shown state, a ringing alarm)
+uint32_t ClockCore::idleTime() {
+    if(_blink || _displayState != CLOCK || _alarmOn)
+        return 0;
+
+    uint32_t utc = _hal.clock.now();
+    uint32_t now = localTime();
+    uint32_t s = 60 - now % 60;
+
+    if(utc >= CLOCKSET && _tz.validUntil() - utc < s)
+        s = _tz.validUntil() - utc;
+
+    uint32_t next = _alarms.next();
+    if(next != 0 && next <= now)
+        s = 0;
+    else if(next != 0 && next - now < s)
+        s = next - now;
+
+#if FEATURE_NTP
+    uint32_t ntp = _lastUpdated + _hal.timeSync.updateInterval() / 1000 + 1;
+    if(_lastUpdated == 0 || ntp <= utc)
+        s = 0;
+    else if(ntp - utc < s)
+        s = ntp - utc;
+#endif
+
+    uint32_t ms = s > 0 ? s * 1000 - _hal.clock.subSecond() : 0;
+    uint32_t expiry = _timer.untilExpiry(_hal.clock.millis());
+    return expiry < ms ? expiry : ms;
+}
+
+// the buzzer plays on its own, independent of tick(), it is only started and stopped here
+void ClockCore::_ring(bool on, const TonePattern *pattern) {
+    _alarmOn = on;
+
+    if(on)
+        _hal.buzzer.play(pattern ? *pattern : *_pattern);
+    else
+        _hal.buzzer.stop();
+}
+
+void ClockCore::tick() {
+    uint32_t utc = _hal.clock.now();
+    uint16_t ms = _hal.clock.subSecond();
+
+    if(utc != _tickSecond || (ms >= 500) != _tickHalf) {
+        uint16_t late = ms % 500;
+        _refresh.count++;
+        _refresh.sumLate += late;
+        _refresh.lastLate = late;
+        if(late > _refresh.maxLate)
+            _refresh.maxLate = late;
+        if(late > REFRESHLATE)
+            _refresh.late++;
+    }
+
+    _checkOffset();
+    _checkAlarms();
+    _checkSync();
+
+    switch(_displayState) {
+        case CLOCK: {
+            _displayTime();
+        } break;
+
+        case ALARMTIME: {
+            _displayAlarmTime();
+        } break;
+
+        case ON: {
+            _displayOnOff(true);
+        } break;
+
+        case OFF: {
+            _displayOnOff(false);
+        } break;
+
+        case TIMER: {
+            _displayTimer();
+        } break;
+    }
+
+    // after the NTP time was set the boundary is that of the new time
+    _tickSecond = _hal.clock.now();
+    _tickHalf = _hal.clock.subSecond() >= 500;
+}
+
+// a new half second of the clock began since the last tick, or the shown timer changed
+bool ClockCore::tickDue() {
+    uint32_t utc = _hal.clock.now();
+    bool half = _hal.clock.subSecond() >= 500;
+    if(utc != _tickSecond || half != _tickHalf)
+        return true;
+    if(_displayState != TIMER)
+        return false;
+
+    uint32_t unit;
+    uint32_t value = _timer.shown(_hal.clock.millis(), unit);
+    return value != _timerValue || unit != _timerUnit;
+}
+
+// ms to the next start or middle of a second, the next change of the shown timer or the end of a countdown
+uint32_t ClockCore::tickIn() {
+    uint32_t in = 500 - _hal.clock.subSecond() % 500;
+    uint32_t ms = _hal.clock.millis();
+
+    if(_displayState == TIMER && _timer.untilChange(ms) < in)
+        in = _timer.untilChange(ms);
+    if(_timer.untilExpiry(ms) < in)
+        in = _timer.untilExpiry(ms);
+    return in;
+}
+
+const RefreshStats &ClockCore::refreshStats() const {
+    return _refresh;
+}
+
+// every passed deadline once, also after a stall or a forward step of the clock
+void ClockCore::_checkAlarms() {
+    uint32_t now = localTime();
+
+    while(_alarms.due(now)) {
+        uint32_t deadline = _alarms.next();
+        bool ring;
+        int i = _alarms.fire(now, ring);
+
+        if(i >= 0 && _alarms.alarm(i).once) {
+            _clockConfig["alarms"][i]["active"] = false;
+            _configVersion++;
+            persistConfig();
+        }
+
+        if(!ring) {
+            LOGE("alarm", "Missed alarm %d, %u s late", i, (unsigned)(now - deadline));
+            continue;
+        }
+
+        if(now - deadline > ALARMLATE)
+            LOGW("alarm", "Alarm %d is %u s late", i, (unsigned)(now - deadline));
+
+        if(!_alarmOn) {
+            LOGI("alarm", "Turning on alarm %d", i);
+            _ring(true);
+            _showState(ON);
+        }
+    }
+}
+
+// a new UTC offset (DST began or ended) steps the local time, like setting the clock
+void ClockCore::_checkOffset() {
+    uint32_t utc = _hal.clock.now();
+    if(utc < CLOCKSET)
+        return;
+
+    uint32_t now = _tz.toLocal(utc);
+    if(_tz.offset() != _utcOffset) {
+        LOGI("clock", "UTC offset now %d s (%s)", (int)_tz.offset(), _tz.dst() ? "DST" : "standard time");
+        _alarms.timeStep(now, ((int64_t)now - (utc + _utcOffset)) * 1000);
+        _utcOffset = _tz.offset();
+    }
+}
+
+void ClockCore::_showState(enum _state state) {
+    _displayState = state;
+    _displayStartTime = _hal.clock.millis();
+}
+
+// once a second whatever is shown, the NTP time is taken outside the minute mark
+void ClockCore::_checkSync() {
+    uint32_t utc = _hal.clock.now();
+    uint32_t current_time = localTime();
+    uint32_t time_to_check = utc - _hal.timeSync.updateInterval() / 1000;
+
+    if(_previousTime != current_time) {
+        if(current_time % 60 == 0) {
+            LOGD("clock", "At the minute mark %02u:%02u, next alarm %u", (unsigned)(current_time % 86400L) / 3600,
+                (unsigned)(current_time % 3600) / 60, (unsigned)_alarms.next());
+        }
+#if FEATURE_NTP
+        else if(_lastUpdated < time_to_check || _lastUpdated == 0) {
+            uint16_t ms = 0;
+            uint32_t ntp_time = _hal.timeSync.getEpochTime(ms);
+            if(ntp_time != 0) {
+                int64_t before = _localMs();
+                _hal.clock.setTime(ntp_time, ms);
+                int64_t after = _localMs();
+                _utcOffset = _tz.offset();
+                _alarms.timeStep(localTime(), after - before);
+            }
+            _lastUpdated = _hal.clock.now();
+
+            LOGI("ntp", "Retrieved time from NTP server: %02u:%02u UTC", (unsigned)(ntp_time % 86400) / 3600, (unsigned)(ntp_time % 3600) / 60);
+        }
+#endif
+    }
+
+    _previousTime = current_time;
+}
+
+void ClockCore::_displayTime() {
+    uint32_t current_time = localTime();
+    bool colon = !_blink || _hal.clock.subSecond() < 500;
+    int hours = (current_time % 86400L) / 3600;
+    int minutes = (current_time % 3600) / 60;
+    uint8_t clock_data[4];
+
+    if(_twelveHours)
+        hours = hours > 12 ? hours - 12 : hours;
+
+    clock_data[0] = hours >= 10 ? encodeDigit(hours / 10) : 0;
+    clock_data[1] = encodeDigit(hours % 10) | (colon ? SEG_COLON : 0);
+    clock_data[2] = encodeDigit(minutes / 10);
+    clock_data[3] = encodeDigit(minutes % 10);
+
+    _hal.display.setSegments(clock_data);
+}
+
+// ss.cc, mm:ss or hh:mm (see ClockTimer.h), the colon blinks while the timer is stopped
+void ClockCore::_displayTimer() {
+    uint32_t unit;
+    uint32_t value = _timer.shown(_hal.clock.millis(), unit);
+    bool colon = _timer.running() || _hal.clock.subSecond() < 500;
+    uint32_t high, low;
+
+    if(unit == 10) {
+        high = value / 100;
+        low = value % 100;
+    } else {
+        high = value / 60 % 100;
+        low = value % 60;
+    }
+
+    uint8_t data[4];
+    data[0] = high >= 10 ? encodeDigit(high / 10) : 0;
+    data[1] = encodeDigit(high % 10) | (colon ? SEG_COLON : 0);
+    data[2] = encodeDigit(low / 10);
+    data[3] = encodeDigit(low % 10);
+
+    _hal.display.setSegments(data);
+    _timerValue = value;
+    _timerUnit = unit;
+}
+
+// the next alarm or the end of the snooze, dashes if none
+void ClockCore::_displayAlarmTime() {
+    uint32_t now = _hal.clock.millis();
+
+    if(now - _displayStartTime < _displayDuration) {
+        uint32_t next = _alarms.next();
+        int hours = (next % 86400L) / 3600;
+        int minutes = (next % 3600) / 60;
+
+        if(_twelveHours)
+            hours = hours > 12 ? hours - 12 : hours;
+
+        uint8_t clock_data[4] = { SEG_G, SEG_G | SEG_COLON, SEG_G, SEG_G };
+        if(next != 0) {
+            clock_data[0] = hours >= 10 ? encodeDigit(hours / 10) : 0;
+            clock_data[1] = encodeDigit(hours % 10) | SEG_COLON;
+            clock_data[2] = encodeDigit(minutes / 10);
+            clock_data[3] = encodeDigit(minutes % 10);
+        }
+
+        _hal.display.setSegments(clock_data);
+
+    } else
+        _displayState = CLOCK;
+}
+
+// "on" or "off"
+void ClockCore::_displayOnOff(bool on) {
+    uint32_t now = _hal.clock.millis();
+
+    if(now - _displayStartTime < _displayDuration) {
+        uint8_t data[4] = { 0 };
+
+        data[0] = encodeDigit(0);
+        if(on) {
+            data[1] = SEG_C | SEG_E | SEG_G;
+        } else {
+            data[1] = SEG_A | SEG_E | SEG_F | SEG_G;
+            data[2] = data[1];
+        }
+
+        _hal.display.setSegments(data);
+    } else
+        _displayState = CLOCK;
+}
+
+void ClockCore::click() {
+    LOGD("clock", "Button clicked");
+    if(_displayState != TIMER)
+        setAlarm(false);
+    else if(_alarmOn)
+        _ring(false);
+    else if(!pauseTimer(true))
+        pauseTimer(false);
+}
+
+void ClockCore::longPress() {
+    if(_displayState == TIMER) {
+        if(_alarmOn)
+            _ring(false);
+        _displayState = CLOCK;
+    } else if(_displayState == ALARMTIME && !_alarmOn) {
+        if(_timer.mode() == TIMER_OFF) {
+            _timer.stopwatch(_hal.clock.millis());
+            _timer.reset();
+        }
+        _displayState = TIMER;
+    } else if(!snooze())
+        _showState(ALARMTIME);
+}
+
+// brightness 0..7 and round, kept until the config is saved like a change from the web page; resets the timer
+// while it is shown
+void ClockCore::doubleClick() {
+    if(_displayState == TIMER) {
+        if(_alarmOn)
+            _ring(false);
+        resetTimer();
+        return;
+    }
+
+    JsonDocument change;
+    change["brightness"] = (_brightness + 1) % 8;
+    updateConfig(change.as<JsonObjectConst>());
+    LOGD("clock", "Brightness %d", _brightness);
+}
+
+bool ClockCore::alarmOn() {
+    return _alarmOn;
+}
+
+// false if the alarm already was in that state, off also ends a snooze; pattern overrides the configured one
+bool ClockCore::setAlarm(bool on, const TonePattern *pattern) {
+    if(!on && _alarms.snoozed()) {
+        _alarms.cancelSnooze(localTime());
+    } else if(_alarmOn == on)
+        return false;
+
+    LOGI("alarm", "Turning %s alarm", on ? "on" : "off");
+    _ring(on, pattern);
+    _showState(on ? ON : OFF);
+    return true;
+}
+
+// stops the ringing alarm and rings again after the snooze time, false if the alarm is not on
+bool ClockCore::snooze() {
+    if(!_alarmOn)
+        return false;
+
+    LOGI("alarm", "Snoozing for %u minutes", _snoozeMinutes);
+    _ring(false);
+    _alarms.snooze(localTime(), _snoozeMinutes * 60L);
+    _showState(ALARMTIME);
+    return true;
+}
+
+// rings an expired countdown at its deadline, independent of the ticks, and shows it
+void ClockCore::pollTimer() {
+    uint32_t ms = _hal.clock.millis();
+    if(!_timer.expired(ms))
+        return;
+
+    uint32_t late = ms - _timer.deadline();
+    _timer.pause(ms);
+    _timerStats.expired++;
+    _timerStats.lastLate = late;
+    if(late > _timerStats.maxLate)
+        _timerStats.maxLate = late;
+
+    LOGI("timer", "Countdown expired, %u ms late", (unsigned)late);
+    if(!_alarmOn)
+        _ring(true, _timerPattern);
+    _displayState = TIMER;
+}
+
+// starts a countdown and shows it, pattern overrides the configured one
+void ClockCore::countdown(uint32_t ms, const TonePattern *pattern) {
+    LOGI("timer", "Countdown of %u ms", (unsigned)ms);
+    _timer.countdown(ms, _hal.clock.millis());
+    _timerPattern = pattern;
+    _displayState = TIMER;
+}
+
+// starts the stopwatch from 0 and shows it
+void ClockCore::stopwatch() {
+    LOGI("timer", "Stopwatch started");
+    _timer.stopwatch(_hal.clock.millis());
+    _displayState = TIMER;
+}
+
+// false if it already was in that state, or cannot resume (off, expired)
+bool ClockCore::pauseTimer(bool pause) {
+    uint32_t ms = _hal.clock.millis();
+    return pause ? _timer.pause(ms) : _timer.resume(ms);
+}
+
+// a countdown back to its full time, the stopwatch to 0, both stopped
+void ClockCore::resetTimer() {
+    _timer.reset();
+}
+
+// stops the timer, and its buzzer if it is shown, and returns to the clock
+void ClockCore::timerOff() {
+    _timer.off();
+    if(_displayState == TIMER) {
+        if(_alarmOn)
+            _ring(false);
+        _displayState = CLOCK;
+    }
+}
+
+bool ClockCore::timerShown() {
+    return _displayState == TIMER;
+}
+
+ClockTimer &ClockCore::timer() {
+    return _timer;
+}
+
+const TimerStats &ClockCore::timerStats() const {
+    return _timerStats;
+}
+
+AlarmScheduler &ClockCore::alarms() {
+    return _alarms;
+}
+
+const TonePattern &ClockCore::pattern() {
+    return *_pattern;
+}
+
+TimeZone &ClockCore::timeZone() {
+    return _tz;
+}
+
+// epoch seconds in the selected zone
+uint32_t ClockCore::localTime() {
+    uint32_t utc = _hal.clock.now();
+    return utc < CLOCKSET ? utc : _tz.toLocal(utc);
+}
+
+// local time in ms, read again when the second turned in between
+int64_t ClockCore::_localMs() {
+    uint16_t ms;
+    uint32_t t;
+    do {
+        ms = _hal.clock.subSecond();
+        t = localTime();
+    } while(_hal.clock.subSecond() < ms);
+    return (int64_t)t * 1000 + ms;
+}
+
+// monotonic, the clock of the timer
+uint32_t ClockCore::millis() {
+    return _hal.clock.millis();
+}
+
+// hhmm
+uint16_t ClockCore::currentTime() {
+    uint32_t current_time = localTime();
+    int hours = (current_time % 86400L) / 3600;
+    int minutes = (current_time % 3600) / 60;
+    return hours * 100 + minutes;
+}
+
+JsonDocument &ClockCore::config() {
+    return _clockConfig;
+}
+
+// changes whenever config() does, for those who mirror it
+uint32_t ClockCore::configVersion() const {
+    return _configVersion;
+}
+
+// takes the known keys that differ from the current config, returns the number of changes
+int ClockCore::updateConfig(JsonObjectConst newClockConfig) {
+    int changes = 0;
+
+    if(newClockConfig["brightness"].is<int>() && newClockConfig["brightness"] != _brightness) {
+        _clockConfig["brightness"] = newClockConfig["brightness"].as<int>();
+        changes++;
+    }
+
+    if(newClockConfig["blink"].is<bool>() && newClockConfig["blink"] != _blink) {
+        _clockConfig["blink"] = newClockConfig["blink"].as<bool>();
+        changes++;
+    }
+
+    if(newClockConfig["alarms"].is<JsonArrayConst>()) {
+        JsonDocument alarms;
+        if(copyAlarms(newClockConfig["alarms"], alarms.to<JsonArray>())
+            && alarms.as<JsonVariantConst>() != _clockConfig["alarms"].as<JsonVariantConst>()) {
+            _clockConfig["alarms"] = alarms;
+            changes++;
+        }
+    }
+
+    if(newClockConfig["pattern"].is<const char *>() && newClockConfig["pattern"] != _pattern->name
+        && buzzerPattern(newClockConfig["pattern"].as<const char *>())) {
+        _clockConfig["pattern"] = buzzerPattern(newClockConfig["pattern"].as<const char *>())->name;
+        changes++;
+    }
+
+    if(newClockConfig["snooze"].is<uint8_t>() && newClockConfig["snooze"].as<uint8_t>() > 0
+        && newClockConfig["snooze"] != _snoozeMinutes) {
+        _clockConfig["snooze"] = newClockConfig["snooze"].as<uint8_t>();
+        changes++;
+    }
+
+    if(newClockConfig["timezone"].is<const char *>() && newClockConfig["timezone"] != _tz.zone().name
+        && tzZone(newClockConfig["timezone"].as<const char *>())) {
+        _clockConfig["timezone"] = tzZone(newClockConfig["timezone"].as<const char *>())->name;
+        changes++;
+    }
+
+    if(newClockConfig["twelvehours"].is<bool>() && newClockConfig["twelvehours"] != _twelveHours) {
+        _clockConfig["twelvehours"] = newClockConfig["twelvehours"].as<bool>();
+        changes++;
+    }
+
+    if(changes)
+        _configVersion++;
+    _applyClockConfig();
+    return changes;
+}
+
+// writes the config if it differs from the stored one, true if written
+bool ClockCore::persistConfig() {
+    JsonDocument oldClockConfig;
+    _loadConfig(oldClockConfig);
+
+    if(oldClockConfig["brightness"] != _clockConfig["brightness"]
+        || oldClockConfig["blink"] != _clockConfig["blink"]
+        || oldClockConfig["alarms"] != _clockConfig["alarms"]
+        || oldClockConfig["snooze"] != _clockConfig["snooze"]
+        || oldClockConfig["pattern"] != _clockConfig["pattern"]
+        || oldClockConfig["twelvehours"] != _clockConfig["twelvehours"]
+        || oldClockConfig["timezone"] != _clockConfig["timezone"]) {
+        LOGI("clock", "Writing new clockconfig data");
+        return _saveConfig();
+    }
+
+    return false;
+}
+
+bool ClockCore::_loadConfig(JsonDocument &doc) {
+    char buf[CLOCKCONFIGMAX];
+    int n = _hal.fs.read(CLOCKCONFIG, 0, buf, sizeof(buf));
+
+    if(n < 0)
+        return false;
+
+    return deserializeJson(doc, buf, n) == DeserializationError::Ok;
+}
+
+bool ClockCore::_saveConfig() {
+    char buf[CLOCKCONFIGMAX];
+    size_t n = serializeJson(_clockConfig, buf, sizeof(buf));
+    return _hal.fs.write(CLOCKCONFIG, buf, n);
+}
+
+void ClockCore::_applyClockConfig() {
+    _brightness = _clockConfig["brightness"];
+    _hal.display.setBrightness(_brightness);
+    _blink = _clockConfig["blink"];
+    _snoozeMinutes = _clockConfig["snooze"] | 9;
+    const TonePattern *pattern = buzzerPattern(_clockConfig["pattern"] | "");
+    _pattern = pattern ? pattern : &BUZZERPATTERNS[0];
+    _twelveHours = _clockConfig["twelvehours"];
+    const TzZone *zone = tzZone(_clockConfig["timezone"] | TZDEFAULT);
+    _tz.select(zone ? zone : tzZone(TZDEFAULT));
+
+    _alarms.clear();
+    for(JsonVariantConst a : _clockConfig["alarms"].as<JsonArrayConst>()) {
+        Alarm alarm;
+        alarm.time = a["time"];
+        alarm.days = a["days"];
+        alarm.active = a["active"];
+        alarm.once = a["once"];
+        _alarms.add(alarm);
+    }
+    _alarms.replan(localTime());
+    _utcOffset = _tz.offset();
+}
+
+// alarmtime and alarmactive of older configs become the first alarm
+void ClockCore::_migrateConfig() {
+    LOGI("clock", "Converting the alarm of an older clockconfig");
+    JsonObject alarm = _clockConfig["alarms"].to<JsonArray>().add<JsonObject>();
+    alarm["time"] = _clockConfig["alarmtime"] | 0;
+    alarm["days"] = EVERYDAY;
+    alarm["active"] = _clockConfig["alarmactive"] | false;
+    alarm["once"] = false;
+    _clockConfig.remove("alarmtime");
+    _clockConfig.remove("alarmactive");
+    _clockConfig["snooze"] = _snoozeMinutes;
+}
+
+// normalised copy of the alarms of a request, false if there are too many or one is invalid
+static bool copyAlarms(JsonArrayConst in, JsonArray out) {
+    if(in.size() > MAXALARMS)
+        return false;
+
+    for(JsonVariantConst a : in) {
+        uint16_t time = a["time"];
+        uint8_t days = a["days"] | EVERYDAY;
+
+        if(!a["time"].is<uint16_t>() || time / 100 > 23 || time % 100 > 59
+            || !(a["days"].isNull() || a["days"].is<uint8_t>()) || days > EVERYDAY)
+            return false;
+
+        JsonObject alarm = out.add<JsonObject>();
+        alarm["time"] = time;
+        alarm["days"] = days;
+        alarm["active"] = a["active"] | true;
+        alarm["once"] = a["once"] | false;
+    }
+
+    return true;
+}
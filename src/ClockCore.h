@@ -0,0 +1,146 @@
+/* Clock state machine
+ *
+ * Time display, alarm and clock configuration, independent of the hardware.
+ * Everything goes through the Hal, so the same code runs on the ESP8266 and on the host.
+ * tick() is called when tickDue(): at the start of every second of the clock and in its middle, so the display
+ * changes the minute when the second begins and the colon blinks with it; tickIn() is the time to the next
+ * of these boundaries. How late the ticks come after them is counted in refreshStats(). pollButton() and
+ * pollTimer() are called as often as possible. idleTime() tells how long the ticks can be left out when nothing
+ * would change.
+ *
+ * The alarms are the "alarms" array of the config: [{"time":hhmm,"days":mask,"active":bool,"once":bool}],
+ * days bit 0 is Sunday. A long press while the alarm rings snoozes it for "snooze" minutes.
+ * A double click steps the brightness.
+ *
+ * The TIMER state shows the countdown or stopwatch of ClockTimer, which runs on the monotonic ms clock: while
+ * it is shown the ticks also come when its digits change (tickDue(), tickIn()), a countdown rings from
+ * pollTimer() at its ms deadline and the loop sleeps no further than that, whatever is shown.
+ * A second long press while the alarm time is shown switches to the timer (a stopped stopwatch if none is
+ * set). There a click starts and stops it, a double click resets it and a long press returns to the clock,
+ * the timer keeps running. A click silences an expired countdown and keeps the timer shown.
+ * The alarm plays the buzzer pattern named "pattern" (see BuzzerPatterns.h).
+ * The clock runs in UTC, "timezone" names the zone shown (see TimeZone.h); alarms are in local time and
+ * a DST transition is a step of the clock for them.
+ */
+
+#ifndef ClockCore_h
+#define ClockCore_h
+
+#include <ArduinoJson.h>
+#include "hal/Hal.h"
+#include "AlarmScheduler.h"
+#include "TimeZone.h"
+#include "ClockTimer.h"
+
+#define CLOCKCONFIG "/clockconfig.json"
+#define CLOCKCONFIGMAX 768
+#define CLOCKSET 86400      // UTC before is a clock that was not set yet, it is shown as it is
+#define REFRESHLATE 50      // ms after its boundary a tick counts as late
+
+struct TimerStats {
+    uint32_t expired = 0;
+    uint32_t lastLate = 0;      // ms from the deadline to the buzzer
+    uint32_t maxLate = 0;
+};
+
+struct RefreshStats {
+    uint32_t count = 0;
+    uint32_t late = 0;
+    uint32_t sumLate = 0;   // ms
+    uint16_t maxLate = 0;
+    uint16_t lastLate = 0;
+};
+
+class ClockCore {
+    public:
+        ClockCore(Hal &hal);
+        void showBooting();
+        void begin();
+        void tick();
+        bool tickDue();
+        uint32_t tickIn();
+        const RefreshStats &refreshStats() const;
+        void pollButton();
+        void pollTimer();
+        uint32_t idleTime();
+        void click();
+        void longPress();
+        void doubleClick();
+        bool alarmOn();
+        bool setAlarm(bool on, const TonePattern *pattern = nullptr);
+        bool snooze();
+        void countdown(uint32_t ms, const TonePattern *pattern = nullptr);
+        void stopwatch();
+        bool pauseTimer(bool pause);
+        void resetTimer();
+        void timerOff();
+        bool timerShown();
+        ClockTimer &timer();
+        const TimerStats &timerStats() const;
+        AlarmScheduler &alarms();
+        const TonePattern &pattern();
+        TimeZone &timeZone();
+        uint32_t localTime();
+        uint32_t millis();
+        uint16_t currentTime();
+        JsonDocument &config();
+        uint32_t configVersion() const;
+        int updateConfig(JsonObjectConst newClockConfig);
+        bool persistConfig();
+
+        static uint8_t encodeDigit(uint8_t digit);
+
+        static const uint8_t SEG_A = 0x01;
+        static const uint8_t SEG_B = 0x02;
+        static const uint8_t SEG_C = 0x04;
+        static const uint8_t SEG_D = 0x08;
+        static const uint8_t SEG_E = 0x10;
+        static const uint8_t SEG_F = 0x20;
+        static const uint8_t SEG_G = 0x40;
+        static const uint8_t SEG_COLON = 0x80;
+
+    private:
+        Hal &_hal;
+        JsonDocument _clockConfig;
+        uint32_t _configVersion = 0;    // counts the changes of _clockConfig
+        enum _state { CLOCK, ALARMTIME, ON, OFF, TIMER };
+        enum _state _displayState = CLOCK;
+        uint16_t _displayDuration = 3000;
+        uint32_t _displayStartTime = 0;
+        int _brightness = 3;
+        const TonePattern *_pattern;
+        uint32_t _lastUpdated = 0;
+        uint32_t _previousTime = 0;
+        uint32_t _tickSecond = 0;   // UTC of the last tick
+        bool _tickHalf = false;     // the last tick was in the second half of that second
+        RefreshStats _refresh;
+        ClockTimer _timer;
+        const TonePattern *_timerPattern = nullptr;
+        uint32_t _timerValue = 0;   // shown by the last tick
+        uint32_t _timerUnit = 0;
+        TimerStats _timerStats;
+        bool _blink = false;
+        AlarmScheduler _alarms;
+        uint16_t _snoozeMinutes = 9;
+        bool _alarmOn = false;
+        bool _twelveHours = false;
+        TimeZone _tz;
+        int32_t _utcOffset = 0;     // of the local time the alarms were planned with
+
+        void _displayTime();
+        void _displayAlarmTime();
+        void _displayOnOff(bool on);
+        void _displayTimer();
+        void _showState(enum _state state);
+        void _ring(bool on, const TonePattern *pattern = nullptr);
+        void _checkAlarms();
+        void _checkOffset();
+        void _checkSync();
+        int64_t _localMs();
+        bool _loadConfig(JsonDocument &doc);
+        bool _saveConfig();
+        void _migrateConfig();
+        void _applyClockConfig();
+};
+
+#endif
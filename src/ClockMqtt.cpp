@@ -0,0 +1,204 @@
+#include "ClockMqtt.h"
+#include <string.h>
+#include "Logger.h"
+
+static const char *const TIMERMODES[] = { "off", "countdown", "stopwatch" };
+
+ClockMqtt::ClockMqtt(ClockCore &core, MqttClient &mqtt) : _core(core), _mqtt(mqtt) {
+    _mqtt.onConnect = [this]() { _connected(); };
+    _mqtt.onMessage = [this](std::string_view topic, std::string_view payload) { _command(topic, payload); };
+}
+
+// topic is the base of all topics, without a trailing /
+void ClockMqtt::begin(const char *host, uint16_t port, const char *topic, const char *clientId) {
+    strncpy(_topic, topic, sizeof(_topic) - 1);
+    char will[MQTTTOPICMAX + 8];
+    snprintf(will, sizeof(will), "%s/status", _topic);
+    _seen = _snapshot();
+    _configVersion = _core.configVersion();
+    _expired = _core.timerStats().expired;
+    _missed = _core.alarms().stats().missed;
+    LOGI("mqtt", "Broker %s:%u, topic %s", host, port, _topic);
+    _mqtt.begin(host, port, clientId, will, "offline");
+}
+
+void ClockMqtt::loop() {
+    uint32_t now = _core.millis();
+    _mqtt.loop(now);
+
+    Snapshot s = _snapshot();
+    if(s.alarmOn && !_seen.alarmOn)
+        _event(_core.timerStats().expired != _expired ? "timer" : "alarm");
+    else if(!s.alarmOn && _seen.alarmOn)
+        _event(s.snoozed ? "snooze" : "alarmoff");
+    if(_core.alarms().stats().missed != _missed)
+        _event("missed");
+    _expired = _core.timerStats().expired;
+    _missed = _core.alarms().stats().missed;
+
+    if(s.alarmOn != _seen.alarmOn || s.snoozed != _seen.snoozed || s.nextAlarm != _seen.nextAlarm
+        || s.timer != _seen.timer || s.timerRunning != _seen.timerRunning) {
+        _changed(now);
+        _stateDirty = true;
+    }
+    if(_core.configVersion() != _configVersion) {
+        _changed(now);
+        _configDirty = true;
+        _configVersion = _core.configVersion();
+    }
+    _seen = s;
+
+    if(!_mqtt.connected())
+        return;
+
+    if((_stateDirty || _configDirty) && now - _dirtySince >= MQTTSETTLE) {
+        if(_configDirty)
+            _publish("config", _core.config().as<JsonVariantConst>(), true);
+        if(_stateDirty)
+            _publishState(s);
+        _stateDirty = _configDirty = false;
+    }
+
+    if(_healthDue ? now - _lastHealth >= MQTTSETTLE : now - _lastHealth >= MQTTHEALTH) {
+        _publishHealth();
+        _lastHealth = now;
+        _healthDue = false;
+    }
+}
+
+// ms until loop() has something to do
+uint32_t ClockMqtt::idleTime() {
+    uint32_t now = _core.millis();
+    uint32_t wait = _mqtt.idleTime(now);
+    if(!_mqtt.connected())
+        return wait;
+
+    uint32_t due = 0xffffffff;
+    if(_stateDirty || _configDirty)
+        due = now - _dirtySince >= MQTTSETTLE ? 0 : MQTTSETTLE - (now - _dirtySince);
+    uint32_t every = _healthDue ? MQTTSETTLE : MQTTHEALTH;
+    uint32_t health = now - _lastHealth >= every ? 0 : every - (now - _lastHealth);
+    if(health < due)
+        due = health;
+    return due < wait ? due : wait;
+}
+
+ClockMqtt::Snapshot ClockMqtt::_snapshot() {
+    Snapshot s;
+    s.alarmOn = _core.alarmOn();
+    s.snoozed = _core.alarms().snoozed();
+    uint32_t next = _core.alarms().next();
+    s.nextAlarm = next ? next - _core.timeZone().offset() : 0;
+    s.timer = _core.timer().mode();
+    s.timerRunning = _core.timer().running();
+    return s;
+}
+
+// the first change of a burst starts its settle time
+void ClockMqtt::_changed(uint32_t now) {
+    if(!_stateDirty && !_configDirty)
+        _dirtySince = now;
+}
+
+// a clean session: subscribe again and publish all retained topics
+void ClockMqtt::_connected() {
+    char topic[MQTTTOPICMAX + 8];
+    snprintf(topic, sizeof(topic), "%s/cmd/#", _topic);
+    _mqtt.subscribe(topic);
+    snprintf(topic, sizeof(topic), "%s/status", _topic);
+    _mqtt.publish(topic, "online", true);
+
+    _stateDirty = _configDirty = true;
+    _dirtySince = _core.millis();
+    _healthDue = true;
+    _lastHealth = _dirtySince;
+}
+
+void ClockMqtt::_command(std::string_view topic, std::string_view payload) {
+    std::string_view base(_topic);
+    if(topic.substr(0, base.size()) != base)
+        return;
+    std::string_view cmd = topic.substr(base.size());
+
+    if(cmd == "/cmd/alarm") {
+        LOGI("mqtt", "Alarm command %.*s", (int)payload.size(), payload.data());
+        if(payload == "on")
+            _core.setAlarm(true);
+        else if(payload == "off")
+            _core.setAlarm(false);
+        else if(payload == "snooze")
+            _core.snooze();
+        else
+            LOGW("mqtt", "Unknown alarm command");
+    } else if(cmd == "/cmd/config") {
+        JsonDocument json;
+        if(deserializeJson(json, payload.data(), payload.size()) != DeserializationError::Ok || !json.is<JsonObject>()) {
+            LOGW("mqtt", "Invalid config command");
+            return;
+        }
+        if(!_core.updateConfig(json.as<JsonObjectConst>()))
+            LOGD("mqtt", "Config command without changes");
+        if(json["persist"] == true)
+            _core.persistConfig();
+    }
+}
+
+void ClockMqtt::_publish(const char *sub, JsonVariantConst doc, bool retain) {
+    char topic[MQTTTOPICMAX + 8];
+    snprintf(topic, sizeof(topic), "%s/%s", _topic, sub);
+    char payload[CLOCKCONFIGMAX];
+    size_t n = serializeJson(doc, payload, sizeof(payload));
+    _mqtt.publish(topic, std::string_view(payload, n), retain);
+}
+
+void ClockMqtt::_publishState(const Snapshot &s) {
+    JsonDocument doc;
+    doc["alarmon"] = s.alarmOn;
+    doc["snoozed"] = s.snoozed;
+    doc["nextalarm"] = s.nextAlarm;
+    doc["timer"] = TIMERMODES[s.timer];
+    doc["timerrunning"] = s.timerRunning;
+    _publish("state", doc, true);
+}
+
+void ClockMqtt::_publishHealth() {
+    JsonDocument doc;
+    doc["uptime"] = _core.millis() / 1000;
+
+    const RefreshStats &refresh = _core.refreshStats();
+    JsonObject r = doc["refresh"].to<JsonObject>();
+    r["count"] = refresh.count;
+    r["late"] = refresh.late;
+    r["maxlate"] = refresh.maxLate;
+
+    const AlarmStats &alarms = _core.alarms().stats();
+    JsonObject a = doc["alarms"].to<JsonObject>();
+    a["fired"] = alarms.fired;
+    a["late"] = alarms.late;
+    a["missed"] = alarms.missed;
+
+    const TimerStats &timer = _core.timerStats();
+    JsonObject t = doc["timer"].to<JsonObject>();
+    t["expired"] = timer.expired;
+    t["maxlate"] = timer.maxLate;
+
+    const MqttStats &mqtt = _mqtt.stats();
+    JsonObject m = doc["mqtt"].to<JsonObject>();
+    m["connects"] = mqtt.connects;
+    m["drops"] = mqtt.drops;
+    m["published"] = mqtt.published;
+    m["dropped"] = mqtt.dropped;
+    m["writes"] = mqtt.writes;
+    m["received"] = mqtt.received;
+
+    if(healthExtra)
+        healthExtra(doc.as<JsonObject>());
+    _publish("health", doc, true);
+}
+
+void ClockMqtt::_event(const char *event) {
+    LOGD("mqtt", "Event %s", event);
+    JsonDocument doc;
+    doc["event"] = event;
+    _publish("event", doc, false);
+}
@@ -0,0 +1,73 @@
+/* MQTT interface of the clock
+ *
+ * Mirrors ClockCore on a broker under a base topic:
+ *   <topic>/status      "online", retained, the will of the connection sets it to "offline"
+ *   <topic>/state       {"alarmon","snoozed","nextalarm" (UTC, 0 if none),"timer","timerrunning"}, retained
+ *   <topic>/config      the clock config as GET /clockconfig serves it, retained
+ *   <topic>/health      uptime, refresh, alarm, timer and MQTT counters and healthExtra, retained,
+ *                       every MQTTHEALTH ms
+ *   <topic>/event       {"event":"alarm"|"timer"|"snooze"|"alarmoff"|"missed"} when it happens, not retained
+ * and takes the commands
+ *   <topic>/cmd/alarm   on, off or snooze
+ *   <topic>/cmd/config  a JSON object like POST /clockconfig, with "persist":true it is also written
+ *
+ * loop() compares the state with the one it saw last. A change is published MQTTSETTLE ms after the
+ * first one of a burst, whatever came meanwhile, so a config POST with several keys or an alarm that is
+ * switched on and off again makes one message. Events are published at once and leave with the next
+ * batch of MqttClient. After every (re)connect the retained topics are published again.
+ */
+
+#ifndef ClockMqtt_h
+#define ClockMqtt_h
+
+#include <functional>
+#include <ArduinoJson.h>
+#include "ClockCore.h"
+#include "MqttClient.h"
+
+#define MQTTSETTLE 200          // ms from the first change to the publish of the state
+#define MQTTHEALTH 60000        // ms between health reports
+#define MQTTTOPICMAX 64
+
+class ClockMqtt {
+    public:
+        ClockMqtt(ClockCore &core, MqttClient &mqtt);
+        void begin(const char *host, uint16_t port, const char *topic, const char *clientId);
+        void loop();
+        uint32_t idleTime();
+
+        std::function<void(JsonObject health)> healthExtra;
+
+    private:
+        struct Snapshot {
+            bool alarmOn = false;
+            bool snoozed = false;
+            uint32_t nextAlarm = 0;
+            TimerMode timer = TIMER_OFF;
+            bool timerRunning = false;
+        };
+
+        ClockCore &_core;
+        MqttClient &_mqtt;
+        char _topic[MQTTTOPICMAX] = "";
+        Snapshot _seen;             // at the last loop()
+        uint32_t _configVersion = 0;
+        uint32_t _expired = 0;      // timer expiries seen
+        uint32_t _missed = 0;       // missed alarms seen
+        bool _stateDirty = false;
+        bool _configDirty = false;
+        uint32_t _dirtySince = 0;   // ms of the first unpublished change
+        uint32_t _lastHealth = 0;
+        bool _healthDue = false;
+
+        Snapshot _snapshot();
+        void _changed(uint32_t now);
+        void _connected();
+        void _command(std::string_view topic, std::string_view payload);
+        void _publish(const char *sub, JsonVariantConst doc, bool retain);
+        void _publishState(const Snapshot &s);
+        void _publishHealth();
+        void _event(const char *event);
+};
+
+#endif
@@ -0,0 +1,174 @@
+// generated by tools/gzippage.py from data/index.html, do not edit
+
+#ifndef ClockPage_h
+#define ClockPage_h
+
+#include "GzipTemplate.h"
+
+static const uint8_t CLOCKPAGEHEADGZ[] PROGMEM={
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x94, 0x55, 0xcb, 0x6e, 0xe2, 0x30,
+  0x14, 0xdd, 0xf3, 0x15, 0x9e, 0x2c, 0x46, 0x74, 0x51, 0x65, 0xe8, 0x48, 0x68, 0x54, 0x42, 0xa4,
+  0x96, 0x56, 0xea, 0x6a, 0x8a, 0x04, 0x52, 0x35, 0xb3, 0x73, 0x92, 0x9b, 0xc4, 0xc2, 0xb1, 0x91,
+  0xed, 0x50, 0xe0, 0xeb, 0xc7, 0x0f, 0x42, 0x9c, 0x26, 0xa0, 0xc1, 0x1b, 0x27, 0xd7, 0xf7, 0x9c,
+  0xfb, 0x3a, 0x89, 0xa3, 0x6f, 0x2f, 0xef, 0x8b, 0xf5, 0x9f, 0xe5, 0x2b, 0x2a, 0x55, 0x45, 0xe3,
+  0x51, 0xe4, 0xb6, 0x51, 0x94, 0xf0, 0xec, 0x80, 0xa4, 0x3a, 0x50, 0x98, 0x07, 0x09, 0x4e, 0x37,
+  0x85, 0xe0, 0x35, 0xcb, 0xee, 0x53, 0x4e, 0xb9, 0x78, 0x44, 0x09, 0xd5, 0xa6, 0x19, 0x3a, 0xbd,
+  0x7d, 0x96, 0x44, 0xc1, 0x2c, 0x88, 0x47, 0x48, 0xaf, 0xa8, 0x9c, 0xc4, 0x1f, 0x40, 0x53, 0x5e,
+  0x01, 0x52, 0x1c, 0xbd, 0xae, 0x96, 0xbf, 0x1e, 0xa6, 0x53, 0xb4, 0xa0, 0x3c, 0xdd, 0x44, 0xa1,
+  0x3e, 0x74, 0x5e, 0x19, 0xd9, 0x21, 0x92, 0x69, 0x6e, 0x41, 0x8a, 0x52, 0x31, 0x90, 0x52, 0x73,
+  0x33, 0x25, 0x38, 0x3d, 0xf1, 0x98, 0xf5, 0x7c, 0x3e, 0x8c, 0x12, 0x81, 0xc2, 0xf6, 0x20, 0x92,
+  0x5b, 0xcc, 0x2c, 0x3e, 0x83, 0x34, 0x40, 0x9c, 0xa5, 0x94, 0xa4, 0x9b, 0x79, 0x90, 0x96, 0x98,
+  0x15, 0xd0, 0xc2, 0xc6, 0xf7, 0x93, 0xbb, 0x59, 0x70, 0xb9, 0x0e, 0x01, 0x59, 0xaf, 0x8a, 0xef,
+  0x54, 0xcd, 0xa2, 0xd0, 0x04, 0x88, 0x6d, 0x98, 0x73, 0x50, 0xb3, 0xba, 0x29, 0x5f, 0x61, 0x2e,
+  0x04, 0x1c, 0x7a, 0xd4, 0x3e, 0xad, 0xa5, 0x22, 0x2c, 0x0d, 0x3a, 0xfc, 0x97, 0x2b, 0xb9, 0x5e,
+  0x48, 0x42, 0x6b, 0xe8, 0x57, 0x52, 0x9c, 0x2b, 0x71, 0x4d, 0x0f, 0x75, 0xd7, 0x9b, 0x29, 0x89,
+  0xaf, 0x83, 0xa0, 0x84, 0x6d, 0x06, 0x66, 0x10, 0x11, 0xb6, 0xad, 0x15, 0x52, 0x87, 0x2d, 0x98,
+  0xac, 0x20, 0xdd, 0x24, 0x7c, 0x1f, 0xb4, 0x10, 0xaf, 0xfb, 0x12, 0xd4, 0xb3, 0x31, 0x8d, 0xef,
+  0x66, 0x3e, 0x01, 0xc5, 0x09, 0x50, 0x94, 0x73, 0xd1, 0x20, 0x62, 0xeb, 0x45, 0x58, 0x61, 0x13,
+  0x66, 0x32, 0x0a, 0xad, 0x4b, 0xec, 0x0d, 0xf9, 0x6a, 0xaa, 0x98, 0x62, 0x51, 0x0d, 0xa4, 0xfa,
+  0x64, 0xec, 0x3d, 0xa9, 0x28, 0x9c, 0x50, 0x68, 0x71, 0xd2, 0x8c, 0xc1, 0xda, 0x3c, 0x9f, 0xa4,
+  0x56, 0x8a, 0xbb, 0x91, 0xe0, 0x2c, 0xb3, 0x7e, 0x5e, 0x5d, 0xda, 0x64, 0xa9, 0x6d, 0x5d, 0x4f,
+  0x59, 0x86, 0xac, 0x43, 0x14, 0x3a, 0x54, 0xfc, 0x35, 0xa0, 0x57, 0xaf, 0x64, 0x9c, 0x1f, 0x21,
+  0x88, 0x57, 0x76, 0x47, 0xe3, 0x8a, 0xb0, 0x5a, 0x81, 0xbc, 0x6b, 0x2a, 0x1e, 0xee, 0x32, 0xab,
+  0xab, 0x04, 0x84, 0xeb, 0xf1, 0x89, 0x01, 0x69, 0xe4, 0x3c, 0x98, 0xe8, 0x1d, 0xef, 0xe7, 0xc1,
+  0xf4, 0x87, 0x96, 0x02, 0x39, 0x6a, 0xd7, 0x9f, 0x36, 0x4d, 0xab, 0x15, 0xdb, 0x7f, 0x17, 0xc8,
+  0x26, 0x7a, 0x25, 0xad, 0x2d, 0x56, 0x0a, 0x04, 0xd3, 0x79, 0x19, 0x0d, 0xf5, 0x93, 0x91, 0x40,
+  0x21, 0x55, 0x36, 0x7e, 0xe3, 0xda, 0x0d, 0xb3, 0x74, 0x56, 0x17, 0x27, 0x74, 0xee, 0xff, 0x3d,
+  0x3e, 0xf5, 0x09, 0x74, 0x07, 0x25, 0xaf, 0xc5, 0x6d, 0x72, 0x73, 0xb8, 0x37, 0x8d, 0x93, 0x5d,
+  0xd1, 0xad, 0xdb, 0x83, 0xcb, 0xd2, 0xf3, 0xd1, 0xf1, 0xe4, 0xe1, 0x6d, 0x40, 0x74, 0x3d, 0x08,
+  0xa9, 0xe0, 0xc8, 0x99, 0x9e, 0xdf, 0x5a, 0x3f, 0x21, 0xf3, 0x78, 0xb5, 0x57, 0x67, 0xff, 0x6e,
+  0xb3, 0x0c, 0xf8, 0xaf, 0x36, 0xdf, 0xd6, 0x2d, 0x4f, 0x92, 0x12, 0xef, 0x40, 0x77, 0x2a, 0x27,
+  0x45, 0xb7, 0xee, 0x17, 0xac, 0xb0, 0x25, 0x5d, 0x69, 0x07, 0xb4, 0xb0, 0x1e, 0xb5, 0xc0, 0x8a,
+  0x70, 0x36, 0x24, 0xce, 0x41, 0x6e, 0x2b, 0x65, 0xce, 0x7c, 0xb5, 0x1b, 0xcb, 0xbb, 0x9b, 0xed,
+  0xba, 0x16, 0x4c, 0x9f, 0x5c, 0x16, 0x7c, 0x9f, 0x2a, 0xcf, 0x7b, 0x5c, 0x79, 0xee, 0x91, 0xe5,
+  0xf9, 0x0d, 0x6c, 0x8d, 0xfa, 0xbb, 0x84, 0x9e, 0xc8, 0x4f, 0x1f, 0xd6, 0x45, 0x46, 0xfb, 0xdd,
+  0x22, 0x22, 0xbd, 0x1b, 0xc3, 0x11, 0x2b, 0xac, 0x6a, 0xd9, 0xfe, 0x91, 0x5b, 0xc4, 0x6f, 0xd8,
+  0x2b, 0xc7, 0xf7, 0xe8, 0x81, 0x98, 0xb6, 0xba, 0xdf, 0x42, 0x03, 0xd1, 0x77, 0x64, 0x68, 0x2e,
+  0xc9, 0x78, 0xf4, 0x0f, 0x00, 0x00, 0xff, 0xff
+};
+
+static const uint8_t CLOCKPAGETAILGZ[] PROGMEM={
+  0xed, 0x5a, 0x59, 0x73, 0xdb, 0x36, 0x10, 0x7e, 0xf7, 0xaf, 0x40, 0x39, 0x6d, 0x4c, 0x36, 0x0a,
+  0xa5, 0xe4, 0xa1, 0xe9, 0xd0, 0x96, 0x3b, 0x8e, 0xed, 0x36, 0xe9, 0xc4, 0x71, 0x26, 0x52, 0x7a,
+  0x79, 0xdc, 0x09, 0x4d, 0x82, 0x22, 0x6b, 0x0a, 0xd0, 0x10, 0x90, 0x15, 0x25, 0xa3, 0xff, 0xde,
+  0x5d, 0x80, 0x07, 0x78, 0x58, 0x4e, 0x62, 0xc5, 0x69, 0xc7, 0xd1, 0x83, 0x24, 0x82, 0xbb, 0x0b,
+  0x60, 0xbf, 0xbd, 0x70, 0x6c, 0xed, 0x8a, 0x20, 0x4b, 0x66, 0x72, 0x6f, 0x6b, 0x8b, 0xc0, 0xe7,
+  0x3c, 0x4b, 0x26, 0xb1, 0x64, 0x54, 0x08, 0x32, 0x24, 0x21, 0x0f, 0xe6, 0x53, 0xca, 0xa4, 0x3b,
+  0xa1, 0xf2, 0x28, 0xa5, 0xf8, 0xf7, 0xc9, 0xf2, 0x59, 0x68, 0x5b, 0x15, 0x95, 0xe5, 0xec, 0x68,
+  0xbe, 0x34, 0x61, 0x17, 0x6b, 0x59, 0x90, 0xa0, 0xa0, 0xf6, 0x53, 0x3f, 0x9b, 0x8e, 0xfd, 0xf3,
+  0x94, 0xae, 0x63, 0x51, 0x54, 0x65, 0x0f, 0x82, 0x71, 0xfe, 0x6e, 0x2d, 0xbd, 0xa6, 0x28, 0xe8,
+  0x67, 0xbe, 0x94, 0x34, 0x63, 0xeb, 0x18, 0x72, 0x92, 0x82, 0x43, 0x2e, 0x68, 0x7a, 0x49, 0x9f,
+  0xf2, 0x79, 0xb6, 0x76, 0xf2, 0x06, 0x59, 0xc9, 0x99, 0x4c, 0xe9, 0x3b, 0xce, 0xd6, 0x8e, 0xae,
+  0xa0, 0xa9, 0xe9, 0x40, 0x48, 0x5f, 0xce, 0xc5, 0xf5, 0x4a, 0x50, 0x64, 0x05, 0x27, 0xa3, 0x6f,
+  0xa5, 0x6a, 0x5e, 0xc7, 0x57, 0x12, 0x21, 0x97, 0x62, 0x0b, 0x38, 0x13, 0x92, 0x1c, 0xee, 0xff,
+  0x39, 0x02, 0xbe, 0x53, 0x6b, 0x34, 0xb7, 0x7a, 0xc4, 0x3a, 0xe6, 0xf8, 0x3d, 0x56, 0xff, 0x7f,
+  0xa7, 0xea, 0x7f, 0x8c, 0xdf, 0x3f, 0x67, 0xf8, 0x3d, 0xf2, 0xad, 0xb3, 0x1d, 0x83, 0xf9, 0x78,
+  0xff, 0x8f, 0xfd, 0xe7, 0xfb, 0xaf, 0x8e, 0x51, 0xc2, 0x8f, 0xfa, 0x45, 0x4a, 0x65, 0x3e, 0x15,
+  0x94, 0x7a, 0x96, 0xf7, 0xd5, 0xef, 0x93, 0x7e, 0x90, 0xf2, 0xe0, 0x82, 0x24, 0x0c, 0x80, 0xa7,
+  0x82, 0x8c, 0xc6, 0xfb, 0xe3, 0x23, 0x78, 0x92, 0x9c, 0xc8, 0x98, 0x02, 0x3a, 0x13, 0xda, 0x53,
+  0xff, 0xa2, 0x04, 0xac, 0x20, 0xca, 0xf8, 0xb4, 0x7a, 0x12, 0x4b, 0x21, 0xe9, 0x94, 0x44, 0x54,
+  0x06, 0x31, 0xb0, 0x26, 0x52, 0xc9, 0x5c, 0x24, 0x2c, 0xe4, 0x0b, 0x97, 0xb3, 0x94, 0xfb, 0x21,
+  0x74, 0xe6, 0x8b, 0x25, 0x0b, 0x48, 0x34, 0x67, 0x81, 0x4c, 0x38, 0x23, 0xb6, 0x43, 0xde, 0x2b,
+  0x3a, 0xfc, 0x24, 0x11, 0xb1, 0xe5, 0x72, 0x46, 0x79, 0x94, 0x77, 0xfc, 0xcd, 0x70, 0x48, 0xac,
+  0x39, 0x0b, 0x69, 0x04, 0xa3, 0x09, 0x2d, 0x93, 0x56, 0x19, 0x57, 0xcc, 0x17, 0x2f, 0xb5, 0x35,
+  0x08, 0x5b, 0x71, 0xb8, 0xb9, 0x71, 0x88, 0x5c, 0xe9, 0x26, 0xe5, 0x18, 0xa0, 0xfc, 0x0b, 0xa0,
+  0x2c, 0x48, 0x0b, 0x68, 0xbb, 0x68, 0x0f, 0x7d, 0xe9, 0xe7, 0x64, 0xa0, 0xc3, 0x28, 0x99, 0x74,
+  0xd0, 0x8c, 0x14, 0xbc, 0x39, 0x95, 0x52, 0xa6, 0xfe, 0xe6, 0xac, 0x47, 0xcc, 0xc6, 0x12, 0xd3,
+  0x86, 0x8c, 0x8c, 0xca, 0x79, 0xc6, 0xaa, 0xb6, 0x55, 0xf9, 0xcf, 0x5f, 0xf8, 0x89, 0x24, 0x60,
+  0x1b, 0xe5, 0xe4, 0x0c, 0xd6, 0xf2, 0x65, 0x35, 0x1f, 0xe3, 0x2d, 0xb4, 0xab, 0xb1, 0x9b, 0x0c,
+  0xd8, 0x77, 0x3e, 0xd8, 0xbc, 0x79, 0x95, 0x03, 0xde, 0x00, 0x43, 0x50, 0xf9, 0x04, 0x1d, 0xbe,
+  0x06, 0x8a, 0xb6, 0xa1, 0x44, 0x1c, 0xc4, 0x34, 0xb8, 0xa0, 0x08, 0xa1, 0x0a, 0x0a, 0x6e, 0xa0,
+  0x9f, 0xab, 0x7e, 0x64, 0xb6, 0x6c, 0xe0, 0xa3, 0x59, 0x33, 0x2a, 0x66, 0xf0, 0x07, 0xdd, 0x4c,
+  0x8f, 0x5d, 0x59, 0x88, 0x6d, 0x69, 0x53, 0xd3, 0xea, 0x05, 0xb3, 0xad, 0xb3, 0xe2, 0x67, 0x4a,
+  0x65, 0xcc, 0x43, 0x8f, 0x58, 0x2f, 0x4f, 0x46, 0x63, 0xab, 0xd7, 0x7a, 0x1f, 0x53, 0x3f, 0xa4,
+  0x99, 0xf0, 0x3a, 0x58, 0xf1, 0xb3, 0x7d, 0xc0, 0x99, 0x04, 0xcf, 0x7a, 0x30, 0x06, 0x93, 0xda,
+  0xf6, 0xc8, 0xb6, 0x3f, 0x9b, 0xa5, 0x49, 0xe0, 0xe3, 0x54, 0xfb, 0xff, 0x08, 0xce, 0xb6, 0x5b,
+  0x6c, 0xab, 0x76, 0x27, 0xe7, 0x3c, 0x5c, 0x7a, 0xe4, 0xd7, 0xd1, 0xc9, 0x0b, 0x57, 0xc8, 0x2c,
+  0x61, 0x93, 0x24, 0x5a, 0xda, 0xef, 0xb5, 0x0e, 0x3c, 0x43, 0x2d, 0x2b, 0xa7, 0xce, 0xbb, 0x32,
+  0x10, 0x58, 0x11, 0xe8, 0x35, 0x88, 0x89, 0x4d, 0xb3, 0x8c, 0x67, 0x4e, 0x87, 0x96, 0x78, 0x4a,
+  0x5d, 0xf5, 0x52, 0x93, 0xb8, 0x53, 0x08, 0xd2, 0xe0, 0x6b, 0x4e, 0xd3, 0x3a, 0x56, 0xa5, 0xa3,
+  0x62, 0xdc, 0xca, 0xf8, 0x82, 0xcc, 0x68, 0xa6, 0x11, 0xf6, 0x54, 0x3c, 0xeb, 0x91, 0x05, 0xa5,
+  0x17, 0xa1, 0xbf, 0x14, 0x3d, 0xe2, 0x03, 0xaa, 0x97, 0xd0, 0xc2, 0x59, 0x00, 0xdf, 0x21, 0x05,
+  0xa7, 0xa7, 0x8a, 0xbd, 0x02, 0x1c, 0xcc, 0x78, 0x5f, 0x85, 0x81, 0x1a, 0xe4, 0x55, 0xa0, 0x77,
+  0x13, 0xc6, 0x68, 0xf6, 0x74, 0x7c, 0xfc, 0x1c, 0xd0, 0xb3, 0xac, 0x86, 0x51, 0x09, 0x37, 0xe2,
+  0xd9, 0x91, 0x0f, 0x60, 0xda, 0xea, 0xb9, 0x47, 0x12, 0x87, 0x0c, 0xf7, 0xba, 0xad, 0x00, 0xc6,
+  0x3a, 0xac, 0x4b, 0x16, 0x34, 0x93, 0xaf, 0xf8, 0xc2, 0x6e, 0xf8, 0x85, 0xa6, 0xc7, 0xc9, 0x98,
+  0x91, 0x32, 0xc8, 0xa8, 0x2f, 0x69, 0x1e, 0x2c, 0x6d, 0x2b, 0x61, 0xb3, 0xb9, 0xb4, 0x1a, 0x9c,
+  0xc8, 0xe3, 0x62, 0x00, 0xc1, 0xc1, 0xe2, 0x83, 0xd5, 0xf1, 0xfe, 0xd2, 0x4f, 0xe7, 0x48, 0x30,
+  0x52, 0x68, 0xda, 0xc7, 0xbe, 0x8c, 0xdd, 0x28, 0xe5, 0xa0, 0x7a, 0xed, 0xae, 0xaa, 0xe3, 0x3e,
+  0x79, 0x38, 0x18, 0x38, 0x0e, 0x84, 0x93, 0x10, 0x3c, 0x27, 0x93, 0xf6, 0xa3, 0x1e, 0xd9, 0x1e,
+  0x6c, 0x3b, 0xe4, 0x3e, 0xb1, 0x3c, 0x0b, 0xbe, 0x73, 0x6e, 0x83, 0xe5, 0x3b, 0xc5, 0xd2, 0xe2,
+  0xe8, 0x18, 0x01, 0xe0, 0x11, 0xfb, 0x6c, 0x82, 0x83, 0xb0, 0xb5, 0xbe, 0x88, 0x21, 0x67, 0x08,
+  0x51, 0x36, 0x13, 0xf4, 0x19, 0xcc, 0xb2, 0x1a, 0xaf, 0x9b, 0xd1, 0x59, 0xea, 0x07, 0xd4, 0x86,
+  0xde, 0x21, 0xc2, 0x5b, 0x8e, 0xb3, 0x83, 0xde, 0x5a, 0x60, 0xb7, 0x83, 0x1e, 0x5d, 0x8b, 0x2d,
+  0x10, 0x72, 0xb5, 0x82, 0x0f, 0x68, 0x9a, 0xda, 0x8e, 0x0b, 0xb6, 0x4f, 0x59, 0x78, 0x10, 0x27,
+  0x69, 0xa8, 0xc4, 0x16, 0xe9, 0xa5, 0xf8, 0x60, 0x82, 0xa9, 0xd0, 0x64, 0x3e, 0x5a, 0x12, 0x58,
+  0x51, 0x07, 0x9c, 0x15, 0x44, 0x01, 0x88, 0x86, 0xe1, 0x36, 0xfb, 0xda, 0xb9, 0x82, 0xfc, 0x9c,
+  0xbf, 0xfd, 0x58, 0x40, 0xb5, 0x03, 0xbe, 0x2d, 0x31, 0x55, 0x31, 0x07, 0x1a, 0xac, 0x6e, 0xb2,
+  0xa0, 0x0c, 0x51, 0x39, 0x30, 0xe8, 0x07, 0xe4, 0x1e, 0xb1, 0x1f, 0x92, 0xdd, 0x5d, 0x35, 0x1d,
+  0x07, 0x52, 0x0a, 0x19, 0x74, 0x73, 0x03, 0x2c, 0x10, 0x1e, 0x2e, 0x5a, 0xa8, 0x28, 0x21, 0x7f,
+  0x0f, 0x49, 0x21, 0x64, 0xbd, 0xe6, 0xd5, 0x7c, 0x41, 0x0f, 0x35, 0x8d, 0x83, 0x78, 0xe7, 0x03,
+  0xc8, 0x1a, 0xba, 0x19, 0x43, 0xe2, 0x78, 0xc1, 0x43, 0xaa, 0xe0, 0x70, 0x1a, 0x02, 0x56, 0x4d,
+  0x04, 0x01, 0x3c, 0x62, 0x6b, 0x4d, 0x5f, 0xd0, 0x25, 0x81, 0x1c, 0x7a, 0x6a, 0xe9, 0x08, 0x80,
+  0x16, 0x83, 0x31, 0xc0, 0x3a, 0x73, 0xfe, 0x8f, 0x58, 0x2a, 0x14, 0x4e, 0x61, 0x4e, 0x67, 0x1f,
+  0x85, 0x9b, 0xe2, 0xc0, 0x6c, 0x55, 0x09, 0xbb, 0x7d, 0xe4, 0x10, 0x09, 0xac, 0x61, 0x72, 0x20,
+  0xc8, 0x4f, 0xc4, 0x3a, 0x61, 0x16, 0xf1, 0xf0, 0x07, 0x00, 0x69, 0x81, 0xba, 0xd5, 0x99, 0x3f,
+  0xa7, 0xfc, 0x72, 0x5d, 0x2c, 0x3c, 0x9f, 0x4b, 0xc9, 0x99, 0xd5, 0x2a, 0x2f, 0x90, 0xcd, 0x95,
+  0x30, 0x94, 0x3c, 0x11, 0xa2, 0xd6, 0x0f, 0x55, 0x16, 0xb0, 0x3a, 0x49, 0xaf, 0x50, 0xa4, 0x70,
+  0x05, 0xe6, 0x4d, 0x6a, 0x27, 0x3d, 0xf2, 0xf0, 0x26, 0x71, 0x47, 0x77, 0x63, 0xe6, 0xb4, 0xa2,
+  0x1c, 0xd9, 0xaa, 0xa7, 0x25, 0x3f, 0x0c, 0x55, 0x0f, 0xad, 0xe2, 0x30, 0x1f, 0x4f, 0x4a, 0xd9,
+  0x44, 0xc6, 0x64, 0x6f, 0x58, 0x95, 0xb6, 0x4e, 0x67, 0x69, 0xd5, 0x4c, 0x57, 0xb3, 0xb9, 0x88,
+  0x21, 0x79, 0x63, 0x00, 0xf4, 0xc8, 0xe3, 0xc1, 0x40, 0xc5, 0x38, 0x28, 0x20, 0x7e, 0x78, 0x54,
+  0x64, 0x4b, 0xc8, 0xa2, 0xd9, 0x3c, 0xcf, 0x99, 0x1e, 0x89, 0xfc, 0x14, 0xea, 0x16, 0x33, 0x95,
+  0x9b, 0x93, 0x37, 0xc7, 0xde, 0xae, 0xa4, 0x3a, 0xf2, 0xaa, 0x99, 0x6e, 0xef, 0x68, 0xdd, 0xa4,
+  0x81, 0xf0, 0x8a, 0xc5, 0xc7, 0xba, 0xaa, 0xe9, 0x8a, 0xda, 0xf5, 0xb3, 0x14, 0x54, 0x6d, 0xf8,
+  0x46, 0x6a, 0x59, 0x5a, 0x83, 0xef, 0x4e, 0x01, 0xa5, 0x97, 0xe5, 0x5e, 0x55, 0x8c, 0xe8, 0x06,
+  0x5d, 0x8e, 0x38, 0xb7, 0x5b, 0xee, 0x36, 0xd0, 0xa9, 0x2d, 0x8c, 0x6e, 0x82, 0x8f, 0xb2, 0xae,
+  0x7e, 0xb1, 0x64, 0xb4, 0x3a, 0xeb, 0x50, 0x60, 0x9e, 0xa7, 0xb2, 0x64, 0x2d, 0x64, 0xb9, 0xa8,
+  0x5f, 0xbb, 0x63, 0x55, 0x58, 0x8e, 0x4c, 0x33, 0x76, 0x2d, 0x48, 0x37, 0xae, 0x9f, 0x5a, 0x3d,
+  0x5f, 0x0e, 0x00, 0xab, 0x06, 0x61, 0x4a, 0x37, 0x2a, 0x04, 0x7c, 0x87, 0x25, 0x42, 0x8b, 0xc6,
+  0xd8, 0x83, 0x71, 0x21, 0x0c, 0xdb, 0x8c, 0x2e, 0xc8, 0xc9, 0x0c, 0x85, 0xe7, 0x45, 0x61, 0xb3,
+  0x16, 0xb9, 0xc6, 0x8d, 0xf2, 0xd1, 0xdc, 0x5d, 0x3f, 0xca, 0x95, 0xe9, 0x95, 0x5a, 0xd5, 0xeb,
+  0x8f, 0x2f, 0xec, 0x3f, 0xc6, 0xde, 0xc1, 0x4d, 0x80, 0x29, 0xb7, 0x50, 0x36, 0xe3, 0x3b, 0xd5,
+  0xa8, 0x72, 0xe7, 0xe9, 0xda, 0xa2, 0xf9, 0xbc, 0xde, 0x53, 0x0d, 0xe1, 0x93, 0xdd, 0xa7, 0x18,
+  0xf4, 0x46, 0xfc, 0xa7, 0x18, 0xcf, 0xdd, 0x75, 0xa0, 0x42, 0x9d, 0x5e, 0xa5, 0xd8, 0x2f, 0xef,
+  0x42, 0x88, 0x4c, 0xb5, 0xa1, 0x7c, 0xcd, 0x7e, 0x99, 0xb1, 0xf5, 0x7c, 0xc7, 0x77, 0xcd, 0xb4,
+  0x26, 0x62, 0xd4, 0xc4, 0x17, 0xdb, 0x3b, 0x6b, 0x20, 0xa9, 0xb7, 0x62, 0x9e, 0x94, 0x47, 0x23,
+  0x76, 0x98, 0x64, 0x54, 0xbd, 0x32, 0xfb, 0xaa, 0x8e, 0x4e, 0x7e, 0xf3, 0x53, 0x73, 0x8b, 0xa6,
+  0x7a, 0x61, 0xae, 0xb4, 0xcc, 0xb5, 0x39, 0xae, 0x5b, 0xea, 0xec, 0x7b, 0x64, 0x40, 0xee, 0xdd,
+  0x23, 0x65, 0x47, 0x64, 0x97, 0x0c, 0xea, 0xeb, 0x97, 0x1a, 0xfd, 0x83, 0x07, 0xd5, 0x4c, 0x28,
+  0xae, 0x47, 0xda, 0x12, 0x77, 0xc9, 0xe3, 0xba, 0xc4, 0xbd, 0xb5, 0x12, 0xef, 0xdf, 0xaf, 0x4b,
+  0x5c, 0xbf, 0x76, 0xba, 0x5b, 0xfb, 0xba, 0xa5, 0x9e, 0xbc, 0x06, 0xe8, 0x5d, 0x46, 0x7a, 0xc3,
+  0x9c, 0xd7, 0x6d, 0x3c, 0xb8, 0x0d, 0xa3, 0xd3, 0x5f, 0xf5, 0xfe, 0xb3, 0xf8, 0xc3, 0xce, 0x55,
+  0xd5, 0x81, 0x3e, 0x41, 0x68, 0xc5, 0xb4, 0x79, 0x86, 0xa6, 0x5f, 0xc7, 0xf7, 0xd3, 0xed, 0x04,
+  0xa4, 0x35, 0xd4, 0x81, 0x76, 0xfd, 0x4d, 0xa9, 0x30, 0x7e, 0xd1, 0xb5, 0x5b, 0x25, 0x63, 0xdc,
+  0x48, 0xc6, 0xac, 0x7a, 0xa4, 0xa6, 0xf8, 0xe6, 0x55, 0x21, 0x5d, 0x9f, 0xb6, 0x79, 0xe4, 0xdb,
+  0xf7, 0xa5, 0x08, 0xdd, 0xb4, 0x7a, 0xf3, 0x61, 0xbb, 0x2c, 0x1f, 0x57, 0xab, 0x28, 0x1d, 0x69,
+  0xa6, 0x2e, 0x43, 0x40, 0x10, 0x52, 0x3e, 0xa9, 0x28, 0x6e, 0xa7, 0x7c, 0x51, 0xa3, 0xca, 0x4f,
+  0xac, 0x3a, 0xc3, 0x57, 0xc3, 0xd0, 0x34, 0x69, 0xa7, 0xa1, 0xd5, 0x4e, 0x79, 0x0c, 0x52, 0x6c,
+  0x6e, 0x9e, 0x03, 0x54, 0xaf, 0xf5, 0xf3, 0xce, 0x35, 0x5b, 0x1e, 0xe6, 0x5a, 0xb2, 0xe2, 0xd5,
+  0xad, 0x15, 0x55, 0xbd, 0x62, 0x2e, 0xc9, 0xf2, 0x66, 0x23, 0x85, 0xb6, 0xf3, 0x6b, 0x45, 0x6d,
+  0xa4, 0x1c, 0x83, 0xa3, 0x5e, 0x49, 0x54, 0xc4, 0x79, 0xfb, 0x35, 0x5b, 0x3b, 0xa5, 0x7f, 0xdc,
+  0x46, 0x8c, 0x7c, 0xfd, 0x9f, 0x5b, 0xd1, 0x40, 0xc7, 0x89, 0x90, 0x7a, 0xa7, 0xec, 0xc3, 0xc2,
+  0xe2, 0xed, 0x79, 0x43, 0x03, 0x2c, 0x65, 0x8e, 0x27, 0x6c, 0x13, 0xdb, 0x04, 0x9c, 0xad, 0x07,
+  0xea, 0x97, 0xa3, 0x26, 0x50, 0x1b, 0xc8, 0x10, 0xc6, 0x39, 0x73, 0x9e, 0x13, 0xca, 0x23, 0xe6,
+  0xfc, 0xd9, 0x3c, 0x5d, 0xbe, 0x65, 0xb5, 0x46, 0xd1, 0x46, 0xf4, 0x1a, 0x45, 0x5f, 0x15, 0x5b,
+  0x53, 0xec, 0x26, 0xb6, 0x1e, 0xb5, 0x6e, 0xf3, 0xbb, 0x35, 0x5f, 0xd5, 0x5b, 0x53, 0x6f, 0xbe,
+  0x9d, 0xbc, 0x01, 0xf5, 0xea, 0x0b, 0x3e, 0x77, 0x57, 0xbd, 0xfd, 0xbe, 0x71, 0xad, 0x29, 0x11,
+  0x24, 0x61, 0x04, 0xf2, 0x1a, 0x14, 0xcb, 0x82, 0x82, 0xb4, 0x50, 0xe0, 0x1e, 0x09, 0xde, 0x0f,
+  0x52, 0xd9, 0xae, 0x47, 0x04, 0x27, 0x09, 0x2e, 0x8d, 0xd5, 0xf8, 0x01, 0x0d, 0x41, 0x5e, 0x8f,
+  0x0f, 0x3a, 0x73, 0x6c, 0x35, 0xbf, 0x72, 0x62, 0xd8, 0x51, 0xfd, 0x3c, 0xa8, 0x78, 0x87, 0x27,
+  0x6c, 0x98, 0x8b, 0x9c, 0xf6, 0xd1, 0x81, 0x46, 0xa8, 0x79, 0x08, 0x76, 0xc2, 0xac, 0x35, 0x0b,
+  0xa0, 0x75, 0x8c, 0x10, 0xab, 0x1a, 0x4b, 0x3b, 0x1c, 0x16, 0x0c, 0x60, 0x48, 0xca, 0x6b, 0x4a,
+  0xd7, 0x1c, 0x45, 0x19, 0x4c, 0xcd, 0x45, 0x5a, 0xa9, 0xcb, 0x66, 0xbf, 0x0c, 0x6f, 0xa0, 0x35,
+  0x56, 0x81, 0x5d, 0xf6, 0x1a, 0xfa, 0x12, 0x6d, 0x15, 0xcb, 0x63, 0xa8, 0x51, 0xa8, 0xee, 0xe7,
+  0x7b, 0xbc, 0x98, 0x30, 0x68, 0x58, 0xd0, 0x55, 0x5d, 0xe1, 0x3d, 0x80, 0x53, 0x14, 0x83, 0x57,
+  0xd3, 0x00, 0x9d, 0x43, 0x7f, 0x69, 0x3b, 0x67, 0x78, 0xed, 0x81, 0x18, 0xd7, 0x1e, 0x0c, 0x82,
+  0x7c, 0x03, 0xe4, 0xaa, 0xab, 0x12, 0x2d, 0xc7, 0xe8, 0x92, 0x71, 0x9c, 0xb0, 0xb9, 0xa4, 0x9d,
+  0x52, 0x3a, 0x0c, 0x6f, 0xb7, 0x5f, 0xde, 0x7d, 0xdc, 0xed, 0xc7, 0x72, 0x9a, 0xee, 0xfd, 0x0b
+};
+
+static const GzipPart CLOCKPAGEHEAD={CLOCKPAGEHEADGZ, 616, 1860, 0x5f94ad8d};
+static const GzipPart CLOCKPAGETAIL={CLOCKPAGETAILGZ, 1888, 10510, 0x757d14c2};
+
+#endif
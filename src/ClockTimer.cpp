@@ -0,0 +1,135 @@
+#include "ClockTimer.h"
+
+#define TIMERCS 59990          // ms, largest value shown as ss.cc (rounded up)
+#define TIMERSECONDS 5999000    // mm:ss
+
+// ms per step of the shown value, up rounds up like a countdown
+static uint32_t unitOf(uint32_t value, bool up) {
+    if((up ? value + 9 : value) / 10 < 6000)
+        return 10;
+    if((up ? value + 999 : value) / 1000 < 6000)
+        return 1000;
+    return 60000;
+}
+
+// starts from ms
+void ClockTimer::countdown(uint32_t ms, uint32_t now) {
+    _mode = TIMER_COUNTDOWN;
+    _duration = ms < TIMERMAX ? ms : TIMERMAX;
+    _collected = 0;
+    _startedAt = now;
+    _running = true;
+}
+
+// starts from 0
+void ClockTimer::stopwatch(uint32_t now) {
+    _mode = TIMER_STOPWATCH;
+    _duration = 0;
+    _collected = 0;
+    _startedAt = now;
+    _running = true;
+}
+
+// false if it was not running
+bool ClockTimer::pause(uint32_t now) {
+    if(!_running)
+        return false;
+
+    _collected = elapsed(now);
+    _running = false;
+    return true;
+}
+
+// false if it is running, off or an expired countdown
+bool ClockTimer::resume(uint32_t now) {
+    if(_running || _mode == TIMER_OFF || (_mode == TIMER_COUNTDOWN && _collected >= _duration))
+        return false;
+
+    _startedAt = now;
+    _running = true;
+    return true;
+}
+
+// back to the start, paused
+void ClockTimer::reset() {
+    _collected = 0;
+    _running = false;
+}
+
+void ClockTimer::off() {
+    _mode = TIMER_OFF;
+    _running = false;
+}
+
+TimerMode ClockTimer::mode() const {
+    return _mode;
+}
+
+bool ClockTimer::running() const {
+    return _running;
+}
+
+uint32_t ClockTimer::duration() const {
+    return _duration;
+}
+
+// ms, a countdown stops at its duration
+uint32_t ClockTimer::elapsed(uint32_t now) const {
+    uint32_t e = _collected + (_running ? now - _startedAt : 0);
+    if(_mode == TIMER_COUNTDOWN && e > _duration)
+        e = _duration;
+    return e;
+}
+
+uint32_t ClockTimer::remaining(uint32_t now) const {
+    return _mode == TIMER_COUNTDOWN ? _duration - elapsed(now) : 0;
+}
+
+// a running countdown reached its end, pause() it to take the expiry
+bool ClockTimer::expired(uint32_t now) const {
+    return _running && _mode == TIMER_COUNTDOWN && now - _startedAt >= _duration - _collected;
+}
+
+// ms of the end of a running countdown
+uint32_t ClockTimer::deadline() const {
+    return _startedAt + _duration - _collected;
+}
+
+// ms, 0xffffffff if no countdown runs
+uint32_t ClockTimer::untilExpiry(uint32_t now) const {
+    if(!_running || _mode != TIMER_COUNTDOWN)
+        return 0xffffffff;
+    return expired(now) ? 0 : deadline() - now;
+}
+
+// value on the display in units of unit ms
+uint32_t ClockTimer::shown(uint32_t now, uint32_t &unit) const {
+    if(_mode == TIMER_COUNTDOWN) {
+        uint32_t r = remaining(now);
+        unit = unitOf(r, true);
+        return r / unit + (r % unit != 0);
+    }
+
+    uint32_t e = elapsed(now);
+    unit = unitOf(e, false);
+    return e / unit;
+}
+
+// ms until the display changes, 0xffffffff while it does not
+uint32_t ClockTimer::untilChange(uint32_t now) const {
+    if(!_running)
+        return 0xffffffff;
+
+    uint32_t unit;
+    uint32_t k = shown(now, unit);
+    if(_mode == TIMER_COUNTDOWN) {
+        // the next lower value, or the switch to the smaller unit if that comes first
+        uint32_t r = remaining(now);
+        uint32_t smaller = unit == 60000 ? TIMERSECONDS : unit == 1000 ? TIMERCS : 0;
+        uint32_t d = k > 0 ? r - (k - 1) * unit : 0xffffffff;
+        if(smaller && r - smaller < d)
+            d = r - smaller;
+        return d;
+    }
+    return (k + 1) * unit - elapsed(now);
+}
@@ -0,0 +1,49 @@
+/* Countdown timer and stopwatch
+ *
+ * Runs on the monotonic ms clock (ClockSource::millis()), not on the display ticks: the state is the ms
+ * at the last start and those collected before it, so a reading is exact to the ms whenever it is taken.
+ * A running countdown is due at a fixed ms deadline, untilExpiry() tells the loop how long it may sleep.
+ * The shown value is counted in a unit that grows with it: 10 ms below a minute (ss.cc), then seconds
+ * (mm:ss) and from 100 minutes on minutes (hh:mm). A countdown shows the remaining time rounded up, so
+ * it reads 00.00 exactly when it expires, a stopwatch the elapsed time rounded down.
+ * Intervals up to 49 days, the wrap of millis().
+ */
+
+#ifndef ClockTimer_h
+#define ClockTimer_h
+
+#include <stdint.h>
+
+#define TIMERMAX 86400000UL     // ms, longest countdown
+
+enum TimerMode { TIMER_OFF, TIMER_COUNTDOWN, TIMER_STOPWATCH };
+
+class ClockTimer {
+    public:
+        void countdown(uint32_t ms, uint32_t now);
+        void stopwatch(uint32_t now);
+        bool pause(uint32_t now);
+        bool resume(uint32_t now);
+        void reset();
+        void off();
+
+        TimerMode mode() const;
+        bool running() const;
+        uint32_t duration() const;
+        uint32_t elapsed(uint32_t now) const;
+        uint32_t remaining(uint32_t now) const;
+        bool expired(uint32_t now) const;
+        uint32_t deadline() const;
+        uint32_t untilExpiry(uint32_t now) const;
+        uint32_t shown(uint32_t now, uint32_t &unit) const;
+        uint32_t untilChange(uint32_t now) const;
+
+    private:
+        TimerMode _mode = TIMER_OFF;
+        bool _running = false;
+        uint32_t _duration = 0;     // ms of a countdown
+        uint32_t _startedAt = 0;    // ms of the last start or resume
+        uint32_t _collected = 0;    // ms elapsed before that
+};
+
+#endif
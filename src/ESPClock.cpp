@@ -1,364 +1,167 @@
 #include <ESPClock.h>
-#include <TimeLib.h>
-
-ESPClock::ESPClock(bool debug, int dio_pin, int clk_pin, int button_pin, int buzzer_pin)
-    : _esp(debug, 100, true, false, false), _button(button_pin, true, false), _display(clk_pin, dio_pin) {
-    _debug = debug;
-    _buzzer_pin = buzzer_pin;
-    pinMode(_buzzer_pin, OUTPUT);
-
-    _button.attachClick([](void *ctx){
-        ((ESPClock*)ctx)->_handleClick();
-    }, this);
-
-    _button.attachLongPressStop([](void *ctx) {
-        ((ESPClock*)ctx)->_handleLongPress();
-    }, this);
 
+ESPClock::ESPClock(int dio_pin, int clk_pin, int button_pin, int buzzer_pin)
+    : _esp(100, true, false, false), _timeSync(_esp), _display(clk_pin, dio_pin), _button(button_pin),
+      _buzzer(buzzer_pin),
+#if FEATURE_PEER
+      _peerSync(_clock, _udp, _timeSync), _hal{_clock, _peerSync, _display, _button, _buzzer, _gpio, _kv, fileIndex, _udp},
+#else
+      _hal{_clock, _timeSync, _display, _button, _buzzer, _gpio, _kv, fileIndex, _udp},
+#endif
+      _core(_hal), _api(_core)
+#if FEATURE_MQTT
+      , _mqtt(_tcp), _clockMqtt(_core, _mqtt)
+#endif
+    {
+    {
+        BootPhase p("display");
+        _core.showBooting();
+    }
+    _esp.onNetwork = [this]() { _startNetwork(); };
     _esp.begin();
-    _count = 0;
-    _buzzer_state = LOW;
-
-    File configFile;
-
-    if(LittleFS.exists("/clockconfig.json")) {
-        configFile = LittleFS.open("/clockconfig.json", "r");
-        deserializeJson(_clockConfig, configFile);
-    } else {
-        _clockConfig["brightness"] = _brightness;
-        _clockConfig["blink"] = _blink;
-        _clockConfig["alarmtime"] = _alarmTime;
-        _clockConfig["alarmactive"] = _alarmActive;
-        _clockConfig["twelvehours"] = _twelveHours;
-
-        configFile = LittleFS.open("/clockconfig.json", "w");
-        serializeJson(_clockConfig, configFile);
-        configFile.close();
+    {
+        BootPhase p("clock");
+        _core.begin();
     }
+    _esp.startWifi();
+    httpAdmission.clockBusy = [this]() { return _core.tickDue(); };
+    LOGI("clock", "Free heap after setup: %u", ESP.getFreeHeap());
+}
 
-    _applyClockConfig();
-    _display.clear();
+// from loop() while booting, once WiFi is connected or the AP is up, before the web server starts
+void ESPClock::_startNetwork() {
     _setEndPoints();
-    _displayState = CLOCK;
+#if FEATURE_MQTT
+    if(_esp.mqtt && !_esp.apmode) {
+        _clockMqtt.healthExtra = [](JsonObject health) {
+            health["heap"] = ESP.getFreeHeap();
+            health["rssi"] = WiFi.RSSI();
+            health["active"] = tickless.activePermille();
+        };
+        _clockMqtt.begin(_esp.getBroker().c_str(), _esp.getMqttPort(), _esp.getTopic().c_str(), _esp.getMac().c_str());
+    }
+#endif
+#if FEATURE_PEER
+    if(_esp.getPeerKey() != "" && !_esp.apmode) {
+#if FEATURE_NTP
+        _peerSync.upstreamActive = [this](bool on) { _esp.setNtpActive(on); };
+#endif
+        _peerSync.begin(ESP.getChipId(), _esp.getPeerKey().c_str());
+    }
+#endif
 }
 
 void ESPClock::button_tick() {
-    _button.tick();
+    _core.pollButton();
+}
+
+void ESPClock::timer_tick() {
+    _core.pollTimer();
 }
 
 void ESPClock::loop() {
     _esp.loop();
+    pollHttp();
+#if FEATURE_MQTT
+    _clockMqtt.loop();
+#endif
+#if FEATURE_PEER
+    _peerSync.loop();
+#endif
 }
 
-void ESPClock::_handleAlarm() {
-    if(_alarmOn) {
-        if(_buzzer_state == LOW)
-            _buzzer_state = HIGH;
-        else
-            _buzzer_state = LOW;
-
-        digitalWrite(_buzzer_pin, _buzzer_state);
-    } else {
-        if(_buzzer_state == HIGH)
-            digitalWrite(_buzzer_pin, LOW);
-    }
+// at the start and in the middle of every second of the clock
+bool ESPClock::displayDue() {
+    return _core.tickDue();
 }
 
 void ESPClock::doDisplay() {
-    switch(_displayState) {
-        case CLOCK: {
-            _displayTime();
-        } break;
-
-        case ALARMTIME: {
-            _displayAlarmTime();
-        } break;
-
-        case ON: {
-            _displayString("on");
-        } break;
-
-        case OFF: {
-            _displayString("off");
-        } break;
-    }
-
-    _handleAlarm();
+    _core.tick();
 }
 
-void ESPClock::_displayTime() {
-    uint32_t current_time = now();
+// sleeps to the next deadline: the display tick, unless the core can leave ticks out, the button, and
+// those of BasicESP8266; the LED and the buzzer run from timers meanwhile and rule out light sleep
+void ESPClock::idle() {
+    uint32_t wait = _core.tickIn();
 
-    uint32_t time_to_check = current_time - _esp.getUpdateInterval() / 1000;
-    int hours = (current_time % 86400L) / 3600;
-    int minutes = (current_time % 3600) / 60;
+    uint32_t skip = _core.idleTime();
+    if(skip > wait)
+        wait = skip;
 
-    if(_previousTime != current_time) {
-        if(current_time % 60 == 0) {
-            if(_debug) {
-                Serial.println("At the minute mark");
-                Serial.print("_alarmTime / 100=");
-                Serial.println(_alarmTime / 100);
-                Serial.print("_alarmTime % 100=");
-                Serial.println(_alarmTime % 100);
-                Serial.print("Hours:");
-                Serial.println(hours);
-                Serial.print("Minutes:");
-                Serial.println(minutes);
-            }
+    uint32_t esp = _esp.idleTime();
+    if(esp < wait)
+        wait = esp;
 
-            if(_alarmActive && !_alarmOn && _alarmTime / 100 == hours && _alarmTime % 100 == minutes) {
-                if(_debug) Serial.println("Turning on alarm");
-                _alarmOn = true;
-                _buzzer_state = HIGH;
-                _displayState = ON;
-                _displayStartTime = millis();
-            }
-        } else if(_lastUpdated < time_to_check || _lastUpdated == 0) {
-            uint32_t ntp_time = _esp.getEpochTime();
-            setTime(ntp_time);
-            _lastUpdated = current_time;
+    uint32_t http = httpAdmission.idleTime(millis());
+    if(http < wait)
+        wait = http;
 
-            if(_debug) {
-                Serial.print("Retrieved time from NTP server: ");
-                Serial.print((current_time % 86400L) / 3600);
-                Serial.print(":");
-                Serial.print((current_time % 3600) / 60 / 10);
-                Serial.print(((current_time % 3600) / 60) % 10);
-            }
-        }
-    }
-
-    uint8_t clock_data[4];
-
-    if(_twelveHours)
-        hours = hours > 12 ? hours - 12 : hours;
-
-    clock_data[0] = hours >= 10 ? _display.encodeDigit(hours / 10) : 0;
-    clock_data[1] = _display.encodeDigit(hours % 10) | _showColon;
-    clock_data[2] = _display.encodeDigit(minutes / 10);
-    clock_data[3] = _display.encodeDigit(minutes % 10);
-
-    _display.setSegments(clock_data);
-
-    if(_blink) {
-        _showColon = _showColon == 128 ? 0 : 128;
-    } else {
-        _showColon = 128;
-    }
-
-    _previousTime = current_time;
-}
-
-void ESPClock::_displayAlarmTime() {
-    uint32_t now = millis();
-
-    if(now < _displayStartTime + _displayDuration) {
-        int hours = _alarmTime / 100;
-        int minutes = _alarmTime % 100;
-
-        if(_twelveHours)
-            hours = hours > 12 ? hours - 12 : hours;
-
-        uint8_t clock_data[4];
-        clock_data[0] = hours >= 10 ? _display.encodeDigit(hours / 10) : 0;
-        clock_data[1] = _display.encodeDigit(hours % 10) | 128;
-        clock_data[2] = _display.encodeDigit(minutes / 10);
-        clock_data[3] = _display.encodeDigit(minutes % 10);
+#if FEATURE_MQTT
+    uint32_t mqtt = _clockMqtt.idleTime();
+    if(mqtt < wait)
+        wait = mqtt;
+#endif
 
-        if(_debug) Serial.println("Displaying alarm time");
+#if FEATURE_PEER
+    uint32_t peer = _peerSync.idleTime();
+    if(peer < wait)
+        wait = peer;
+#endif
 
-        _display.setSegments(clock_data);
+    if(_button.pending() && wait > BUTTONDEBOUNCE)
+        wait = BUTTONDEBOUNCE;
 
-    } else
-        _displayState = CLOCK;
-}
-
-void ESPClock::_displayString(String str) {
-    uint32_t now = millis();
-
-    if(now < _displayStartTime + _displayDuration) {
-        uint8_t data[4] = { 0 };
-
-        if(str == "on") {
-            if(_debug) Serial.println("Displaying On");
-
-            data[0] = _display.encodeDigit(0);
-            data[1] = SEG_C | SEG_E | SEG_G;
-        } else if(str == "off") {
-            if(_debug) Serial.println("Displaying Off");
-
-            data[0] = _display.encodeDigit(0);
-            data[1] = SEG_A | SEG_E | SEG_F | SEG_G;
-            data[2] = data[1];
-        }
-
-        _display.setSegments(data);
-    } else
-        _displayState = CLOCK;
-}
-
-void ESPClock::_handleClick() {
-    if(_debug) Serial.println("Button clicked");
-    if(_alarmOn) {
-        if(_debug) Serial.println("Turning off alarm");
-        _alarmOn = false;
-        _displayState = OFF;
-        _displayStartTime = millis();
-    }
-}
-
-void ESPClock::_handleLongPress() {
-    _displayState = ALARMTIME;
-    _displayStartTime = millis();
+    tickless.sleep(wait, !_buzzer.playing() && !_esp.signalling());
 }
 
 void ESPClock::_setEndPoints() {
-    _esp.server->on("/clock", HTTP_GET, [&](AsyncWebServerRequest *request) {
-            File f = LittleFS.open("/index.html", "r");
-
-            if (!f) {
-                if (_debug) Serial.println("no index.html");
-                request->send(404, "text/plain", "No index.html file");
-                return;
-            }
-
-            request->send(LittleFS, "/index.html", "text/html");
+    serveHttp(_esp.server, "/clock", HTTP_GET, [this](HttpRequest &req, HttpResponse &res) {
+        if(_api.clockPage(req, res))
+            return;
+
+        File f = LittleFS.open("/index.html", "r");
+        if(!f) {
+            LOGW("http", "no index.html");
+            res.begin(404, "text/plain");
+            res.print("No index.html file");
+            return;
+        }
+        res.stream(200, "text/html", [f](uint8_t *buf, size_t maxLen, size_t index) mutable -> size_t {
+            return f.read(buf, maxLen);
+        });
     });
 
-    _esp.server->on("/alarm/*", HTTP_GET, [&](AsyncWebServerRequest *request) {
-        JsonDocument status;
-        String command = request->url();
-        String response;
-
-        if(command.endsWith("on")) {
-            if(!_alarmOn) {
-                _alarmOn = true;
-                _displayState = ON;
-                _displayStartTime = millis();
-            } else
+    serveHttp(_esp.server, "/alarm/*", HTTP_GET, [this](HttpRequest &req, HttpResponse &res) {
+        _api.alarm(req, res);
+        tickless.wake();
+    }, HTTPLIGHT);
 
-                status["error"] = "Alarm is already on";
+    serveHttp(_esp.server, "/timer/*", HTTP_GET, [this](HttpRequest &req, HttpResponse &res) {
+        _api.timer(req, res);
+        tickless.wake();
+    }, HTTPLIGHT);
 
-            } else if(command.endsWith("off")) {
-                if(_alarmOn) {
-                    _alarmOn = false;
-                    _displayState = OFF;
-                    _displayStartTime = millis();
-                } else
-
-                status["error"] = "Alarm is already off";
-
-        } else if(command.endsWith("status"))
-            ;
-        else if(!command.endsWith("status"))
-            status["error"] = "No valid command found. Must be on, off or status. Sending status.";
-
-        status["alarmon"] = _alarmOn;
-        serializeJson(status, response);
-        request->send(200, "text/json", response);
-    });
+    serveHttp(_esp.server, "/currenttime", HTTP_GET, [this](HttpRequest &req, HttpResponse &res) {
+        _api.currentTime(req, res);
+    }, HTTPLIGHT);
 
-    _esp.server->on("/currenttime", HTTP_GET, [&](AsyncWebServerRequest *request) {
-        JsonDocument jsonResponse;
-        String response;
-        uint32_t current_time = now();
-        int hours = (current_time % 86400L) / 3600;
-        int minutes = (current_time % 3600) / 60;
-        uint16_t timenow = hours * 100 + minutes;
-        jsonResponse["currenttime"] = timenow;
-        serializeJson(jsonResponse, response);
-        request->send(200, "text/json", response);
+    serveHttp(_esp.server, "/timezones", HTTP_GET, [this](HttpRequest &req, HttpResponse &res) {
+        _api.timeZones(req, res);
     });
 
-    AsyncCallbackJsonWebHandler* handler = new AsyncCallbackJsonWebHandler("/clockconfig", [this](AsyncWebServerRequest *request, JsonVariant &json) {
-        if(_debug) Serial.println("Getting clockconfig request");
-        JsonObject newClockConfig;
-        String response = "";
-        File configFile;
-
-        if(request->method() == HTTP_POST && json != NULL) {
-            if(_debug) Serial.println("Reading in new clockconfig data");
-
-            newClockConfig = json.as<JsonObject>();
-            int changes = 0;
-
-            if(newClockConfig["brightness"].is<int>() &&  newClockConfig["brightness"] != _brightness){
-                _brightness = newClockConfig["brightness"];
-                _clockConfig["brightness"] = _brightness;
-                changes++;
-            }
-
-            if(newClockConfig["blink"].is<bool>() && newClockConfig["blink"] != _blink){
-                _blink = newClockConfig["blink"];
-                _clockConfig["blink"] = _blink;
-                changes++;
-            }
-
-            if(newClockConfig["alarmtime"].is<uint16_t>() && newClockConfig["alarmtime"] != _alarmTime){
-                _alarmTime = newClockConfig["alarmtime"];
-                _clockConfig["alarmtime"] = _alarmTime;
-                changes++;
-            }
-
-            if(newClockConfig["alarmactive"].is<bool>() && newClockConfig["alarmactive"] != _alarmActive){
-                _alarmActive = newClockConfig["alarmactive"];
-                _clockConfig["alarmactive"] = _alarmActive;
-                changes++;
-            }
-
-            if(newClockConfig["twelvehours"].is<bool>() && newClockConfig["twelvehours"] != _twelveHours){
-                _twelveHours = newClockConfig["twelvehours"];
-                _clockConfig["twelvehours"] = _twelveHours;
-                changes++;
-            }
-
-            _applyClockConfig();
-            serializeJson(newClockConfig, response);
-
-        } else if(request->method() == HTTP_PUT && json != NULL) {
-            JsonDocument oldClockConfig;
-            JsonDocument responseJson;
-            configFile = LittleFS.open("/clockconfig.json", "r");
-            deserializeJson(oldClockConfig, configFile);
-
-            if(oldClockConfig["brightness"] != _clockConfig["brightness"]
-                || oldClockConfig["blink"] != _clockConfig["blink"]
-                || oldClockConfig["alarmtime"] != _clockConfig["alarmtime"]
-                || oldClockConfig["alarmactive"] != _clockConfig["alarmactive"]
-                || oldClockConfig["twelvehours"] != _clockConfig["twelvehours"]) {
-                if(_debug) Serial.println("Writing new clockconfig data");
-
-                configFile = LittleFS.open("/clockconfig.json", "w");
-                serializeJson(_clockConfig, configFile);
-                configFile.close();
-                responseJson["persist"] = true;
-            } else {
-                responseJson["persist"] = false;
-            }
-
-            serializeJson(responseJson, response);
-
-        } else if(request->method() == HTTP_GET) {
-            serializeJson(_clockConfig, response);
-
-            if(_debug) {
-                Serial.println("Sending current clockconfig data:");
-                Serial.println(response);
-            }
-        }
-
-        request->send(200, "application/json", response);
+    serveHttp(_esp.server, "/clockconfig", HTTP_GET | HTTP_POST | HTTP_PUT, [this](HttpRequest &req, HttpResponse &res) {
+        _api.clockConfig(req, res);
+        tickless.wake();
     });
 
-    _esp.server->addHandler(handler);
+#if FEATURE_PEER
+    serveHttp(_esp.server, "/peersync", HTTP_GET, [this](HttpRequest &req, HttpResponse &res) {
+        JsonDocument status;
+        _peerSync.report(status.to<JsonObject>());
+        char json[384];
+        size_t n = serializeJson(status, json, sizeof(json));
+        res.begin(200, "text/json");
+        res.write(json, n);
+    }, HTTPLIGHT);
+#endif
 }
-
-void ESPClock::_applyClockConfig() {
-    _brightness = _clockConfig["brightness"];
-    _display.setBrightness(_brightness);
-    _blink = _clockConfig["blink"];
-    _alarmTime = _clockConfig["alarmtime"];
-    _alarmActive = _clockConfig["alarmactive"];
-    _twelveHours = _clockConfig["twelvehours"];
-}
\ No newline at end of file
@@ -2,49 +2,51 @@
 #define ESPClock_h
 
 #include "BasicESP8266.h"
-#include <OneButton.h>
-#include <TM1637Display.h>
-#include <ArduinoJson.h>
+#include "hal/HalEsp8266.h"
+#include "ClockCore.h"
+#include "ClockApi.h"
+#if FEATURE_MQTT
+#include "ClockMqtt.h"
+#endif
+#if FEATURE_PEER
+#include "PeerSync.h"
+#endif
 
 class ESPClock {
     public:
-        ESPClock(bool debug, int dio_pin, int clk_pin, int button_pin, int buzzer_pin);
+        ESPClock(int dio_pin, int clk_pin, int button_pin, int buzzer_pin);
         void button_tick();
+        void timer_tick();
         void loop();
+        bool displayDue();
         void doDisplay();
+        void idle();
 
     private:
         BasicESP8266 _esp;
-        OneButton _button;
-        TM1637Display _display;
-        JsonDocument _clockConfig;
-        enum _state { CLOCK, ALARMTIME, ON, OFF, TIMER };
-        enum _state _displayState;
-        uint16_t _displayDuration = 3000;
-        uint32_t _displayStartTime = 0;
-        int _brightness = 3;
-        int _buzzer_pin;
-        int _count;
-        int _buzzer_state;
-        uint32_t _lastUpdated = 0;
-        uint32_t _previousTime = 0;
-        int _showColon = 128;
-        bool _blink = false;
-        bool _debug;
-        uint16_t _alarmTime;
-        bool _alarmActive = false;
-        bool _alarmOn = false;
-        bool _twelveHours = false;
+        EspClockSource _clock;
+        EspTimeSync _timeSync;
+        Tm1637Sink _display;
+        IsrButton _button;
+        Timer1Buzzer _buzzer;
+        ArduinoGpio _gpio;
+        EepromStore _kv;
+        WifiUdpPort _udp;
+#if FEATURE_PEER
+        PeerSync _peerSync;     // in front of _timeSync, before _hal
+#endif
+        Hal _hal;
+        ClockCore _core;
+        ClockApi _api;
+#if FEATURE_MQTT
+        AsyncTcpStream _tcp;
+        MqttClient _mqtt;
+        ClockMqtt _clockMqtt;
+#endif
 
-        void _displayTime();
-        void _displayAlarmTime();
-        void _displayString(String str);
+        void _startNetwork();
         void _setEndPoints();
-        void _handleAlarm();
-        void _handleClick();
-        void _handleLongPress();
-        void _applyClockConfig();
 };
 
 
-#endif
\ No newline at end of file
+#endif
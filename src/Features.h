@@ -0,0 +1,86 @@
+/* Build time debug and feature selection
+ *
+ * Set with -D in the build_flags of platformio.ini. Disabled features are not compiled at all,
+ * including their endpoints and strings.
+ *
+ * CLOCK_DEBUG      1 = serial output and debug log messages
+ * LOG_MAXLEVEL     highest log level compiled in (0=error .. 3=debug)
+ * FEATURE_LOG      ring buffer logger and /log
+ * FEATURE_OTA      ArduinoOTA push updates
+ * FEATURE_NTP      time from pool.ntp.org
+ * FEATURE_DUMP     /dump hex viewer
+ * FEATURE_MEM      /mem file viewer and delete
+ * FEATURE_UPLOAD   /upload
+ * FEATURE_IDLE     the loop sleeps to its next deadline instead of spinning (TicklessIdle)
+ * FEATURE_LIGHTSLEEP  WiFi light sleep in STA mode while idle, otherwise modem sleep
+ * FEATURE_MQTT     state, events and commands on the MQTT broker of the setup form (ClockMqtt)
+ * FEATURE_PEER     time from an elected clock on the LAN instead of NTP, with the key of the setup form (PeerSync)
+ * FEATURE_HTTPOTA  firmware and file system updates uploaded to /update, also in AP mode (OtaUpdate)
+ */
+
+#ifndef Features_h
+#define Features_h
+
+#ifndef CLOCK_DEBUG
+#define CLOCK_DEBUG 0
+#endif
+
+#ifndef LOG_MAXLEVEL
+#if CLOCK_DEBUG
+#define LOG_MAXLEVEL 3
+#else
+#define LOG_MAXLEVEL 2
+#endif
+#endif
+
+#ifndef FEATURE_LOG
+#define FEATURE_LOG 1
+#endif
+
+#ifndef FEATURE_OTA
+#define FEATURE_OTA 1
+#endif
+
+#ifndef FEATURE_NTP
+#define FEATURE_NTP 1
+#endif
+
+#ifndef FEATURE_DUMP
+#define FEATURE_DUMP 1
+#endif
+
+#ifndef FEATURE_MEM
+#define FEATURE_MEM 1
+#endif
+
+#ifndef FEATURE_UPLOAD
+#define FEATURE_UPLOAD 1
+#endif
+
+#ifndef FEATURE_IDLE
+#define FEATURE_IDLE 1
+#endif
+
+#ifndef FEATURE_LIGHTSLEEP
+#define FEATURE_LIGHTSLEEP 1
+#endif
+
+#ifndef FEATURE_MQTT
+#define FEATURE_MQTT 1
+#endif
+
+#ifndef FEATURE_PEER
+#define FEATURE_PEER 1
+#endif
+
+#ifndef FEATURE_HTTPOTA
+#define FEATURE_HTTPOTA 1
+#endif
+
+// for the code that has to compile either way, the features are left out with #if
+namespace Features
+{
+  constexpr bool debug=CLOCK_DEBUG;
+}
+
+#endif
@@ -0,0 +1,302 @@
+#include "FileApi.h"
+#include <memory>
+#include <string>
+#include "Pages.h"
+#include "Logger.h"
+
+#define DUMPTEXT 0
+#define DUMPHTML 1
+#define DUMPJSON 2
+
+struct DumpState
+{
+  char path[FILEPATHLEN];
+  int format;
+  uint32_t size;
+  uint32_t pos=0;
+  bool done=false;
+};
+
+void filePath(char *path, size_t len, std::string_view fname)
+{
+  BufferSink p(path, len);
+  if (fname.empty() || fname[0]!='/') p.print("/");
+  p.print(fname);
+}
+
+// a JSON string, quotes and backslashes escaped, control characters dropped
+static void jsonString(TextSink &out, std::string_view s)
+{
+  out.print("\"");
+  for (char c : s)
+  {
+    if (c=='"' || c=='\\') out.print("\\");
+    if ((uint8_t)c>=0x20) out.write(&c, 1);
+  }
+  out.print("\"");
+}
+
+FileApi::FileApi(FileIndex &fs, bool showWifiPwd) : _fs(fs)
+{
+  _showWifiPwd=showWifiPwd;
+}
+
+void FileApi::listFiles(TextSink &out)
+{
+  out.printP(PSTR("<table><tr style=\"background-color:lime;\"><th>Filename</th><th>Size (Bytes)</th></tr>\n"));
+  _fs.list([](void *ctx, const char *name, uint32_t size, uint32_t mtime)
+  {
+    TextSink &o=*(TextSink *)ctx;
+    std::string_view fn(name);
+    if (!fn.empty() && fn[0]=='/') fn.remove_prefix(1);
+    o.printP(PSTR("<tr style=\"background-color:yellow;\"><td>"));
+    htmlEscape(o, fn);
+    o.printP(PSTR("</td><td>"));
+    o.print(size);
+    o.printP(PSTR("</td></tr>\n"));
+  }, &out);
+  uint32_t total=0, used=0;
+  _fs.usage(total, used);
+  out.printP(PSTR("<tr style=\"background-color:lightBlue;\"><td>Free memory:</td><td>"));
+  out.print(total-used);
+  out.printP(PSTR("</table>\n"));
+}
+
+struct FilesJson
+{
+  TextSink &out;
+  FileIndex &fs;
+  bool first;
+};
+
+void FileApi::files(HttpRequest &req, HttpResponse &res)
+{
+  std::string_view format;
+  if (req.param("format", format) && format=="html")
+  {
+    res.begin(200, "text/html");
+    htmlBegin(res, "", false);
+    listFiles(res);
+    htmlEnd(res, false);
+    return;
+  }
+
+  uint32_t total=0, used=0;
+  _fs.usage(total, used);
+  res.begin(200, "application/json");
+  res.print("{\"total\":");
+  res.print(total);
+  res.print(",\"used\":");
+  res.print(used);
+  res.print(",\"free\":");
+  res.print(total-used);
+  res.print(_fs.complete()?",\"indexed\":true,\"files\":[":",\"indexed\":false,\"files\":[");
+  FilesJson st{res, _fs, true};
+  _fs.list([](void *ctx, const char *name, uint32_t size, uint32_t mtime)
+  {
+    FilesJson &st=*(FilesJson *)ctx;
+    st.out.print(st.first?"{\"name\":":",{\"name\":");
+    st.first=false;
+    jsonString(st.out, name);
+    st.out.print(",\"size\":");
+    st.out.print(size);
+    st.out.print(",\"mtime\":");
+    st.out.print(mtime);
+    const FileEntry *e=st.fs.find(name);
+    if (e)
+    {
+      char tag[FILEETAGLEN];
+      st.out.print(",\"etag\":");
+      jsonString(st.out, FileIndex::etag(tag, sizeof(tag), *e));
+    }
+    st.out.print("}");
+  }, &st);
+  res.print("]}");
+}
+
+void FileApi::info(HttpRequest &req, HttpResponse &res)
+{
+  res.begin(200, "text/html");
+  htmlBegin(res, "", false);
+  listFiles(res);
+  res.print("<br>");
+  if (infoExtra) infoExtra(res);
+  htmlEnd(res, false);
+}
+
+void FileApi::mem(HttpRequest &req, HttpResponse &res)
+{
+  std::string_view name;
+  char path[FILEPATHLEN];
+  if (req.param("filename", name))
+  {
+    filePath(path, sizeof(path), name);
+    bool exists=_fs.exists(path);
+    if (exists && strcmp(path, "/config")!=0)
+    {
+      const FileEntry *e=_fs.find(path);
+      char tag[FILEETAGLEN];
+      std::string_view known;
+      if (e) FileIndex::etag(tag, sizeof(tag), *e);
+      if (e && req.header("If-None-Match", known) && known==tag)
+      {
+        res.begin(304, "application/octet-stream");
+        res.header("ETag", tag);
+        return;
+      }
+      LOGD("http", "Serving file \"%s\"", path);
+      std::string p(path);
+      res.stream(200, "application/octet-stream", [this, p](uint8_t *buf, size_t maxLen, size_t index) -> size_t
+      {
+        int n=_fs.read(p.c_str(), index, (char *)buf, maxLen);
+        return n>0?n:0;
+      });
+      if (e) res.header("ETag", tag);
+      return;
+    }
+    res.begin(200, "text/html");
+    htmlBegin(res, "", true);
+    if (exists)
+    {
+      // config is shown with the password masked
+      char fc[512];
+      int n=_fs.read(path, 0, fc, sizeof(fc)-1);
+      fc[n>0?n:0]=0;
+      htmlEscape(res, path);
+      res.print(":\n\n");
+      std::string_view rest(fc);
+      while (!rest.empty())
+      {
+        size_t e=rest.find('\n');
+        std::string_view line=rest.substr(0, e==std::string_view::npos?rest.size():e+1);
+        rest.remove_prefix(line.size());
+        if (!_showWifiPwd && line.substr(0, 4)=="pwd=") res.print("pwd=*****\n");
+        else htmlEscape(res, line);
+      }
+    }
+    else
+    {
+      res.print("File ");
+      htmlEscape(res, path);
+      res.print(" not found");
+    }
+    htmlEnd(res, true);
+  }
+  else if (req.param("delete", name))
+  {
+    filePath(path, sizeof(path), name);
+    res.begin(200, "text/html");
+    htmlBegin(res, "", true);
+    res.print("File ");
+    htmlEscape(res, name);
+    res.print(_fs.remove(path)?" deleted":" could not be deleted");
+    htmlEnd(res, true);
+  }
+  else
+  {
+    res.begin(200, "text/html");
+    htmlBegin(res, "", false);
+    listFiles(res);
+    htmlEnd(res, false);
+  }
+}
+
+// as many whole lines as fit into maxLen per call, the file is read once per call and not per line
+static size_t fillDump(FileStore &fs, DumpState &st, uint8_t *buffer, size_t maxLen)
+{
+  uint8_t block[256];
+  int got=st.done?0:fs.read(st.path, st.pos, (char *)block, sizeof(block));
+  if (got<0) got=0;
+  size_t off=0;
+  size_t len=0;
+  while (!st.done)
+  {
+    char line[256];
+    BufferSink out(line, sizeof(line));
+    if (st.pos==0)
+    {
+      if (st.format==DUMPHTML) out.printP(PSTR("<!DOCTYPE html>\n<html><body><pre>\n"));
+      if (st.format==DUMPJSON) out.printP(PSTR("{\"filename\":\""));
+      out.print(st.path);
+      out.print(st.format==DUMPJSON?"\",\"data\":[":"\n\n");
+    }
+    else out.print(st.format==DUMPJSON?",":"\n");
+    size_t n=got-off<32?got-off:32;
+    hexDumpLine(out, st.pos, block+off, n, st.format==DUMPJSON);
+    bool last=n==0 || st.pos+n>=st.size;
+    if (last)
+    {
+      if (st.format==DUMPTEXT) out.print("\n");
+      if (st.format==DUMPHTML) out.printP(PSTR("\n</pre></body></html>\n"));
+      if (st.format==DUMPJSON) out.print("]}");
+    }
+
+    size_t l=out.view().size();
+    if (len+l>maxLen) break;
+    memcpy(buffer+len, line, l);
+    len+=l;
+    off+=n;
+    st.pos+=n;
+    st.done=last;
+    if (off>=(size_t)got) break;
+  }
+  return len;
+}
+
+void FileApi::dump(HttpRequest &req, HttpResponse &res)
+{
+  std::string_view name;
+  if (!req.param("filename", name))
+  {
+    res.begin(200, "text/plain");
+    res.print("use <ip>/dump?filename=<filename>");
+    return;
+  }
+
+  auto st=std::make_shared<DumpState>();
+  filePath(st->path, sizeof(st->path), name);
+  st->format=DUMPTEXT;
+  std::string_view df;
+  if (req.param("format", df))
+  {
+    if (df=="json") st->format=DUMPJSON;
+    if (df=="html") st->format=DUMPHTML;
+  }
+  int size=_fs.size(st->path);
+  if (size<=0 || (strcmp(st->path, "/config")==0 && !_showWifiPwd))
+  {
+    res.begin(200, "text/plain");
+    res.print("File not available");
+    return;
+  }
+  st->size=size;
+
+  const char *type="text/plain";
+  if (st->format==DUMPHTML) type="text/html";
+  if (st->format==DUMPJSON) type="application/json";
+  res.stream(200, type, [this, st](uint8_t *buffer, size_t maxLen, size_t index) -> size_t
+  {
+    return fillDump(_fs, *st, buffer, maxLen);
+  });
+}
+
+void FileApi::upload(HttpRequest &req, std::string_view filename, size_t index, const uint8_t *data, size_t len, bool final,
+  HttpResponse *res)
+{
+  char path[FILEPATHLEN];
+  filePath(path, sizeof(path), filename);
+  if (index==0)
+  {
+    LOGI("http", "UPLOAD: Started to receive '%s'.", path);
+    _fs.write(path, (const char *)data, len);
+  }
+  else _fs.append(path, (const char *)data, len);
+  if (final)
+  {
+    LOGI("http", "UPLOAD: Done. Received %u Bytes.", (unsigned)(index+len));
+    res->begin(200, "text/html");
+    res->print("\nUPLOAD: Done. Received ");
+    res->print((uint32_t)(index+len));
+    res->print(" Bytes.\n");
+  }
+}
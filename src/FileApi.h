@@ -0,0 +1,45 @@
+/* File endpoints
+ *
+ * /info     file list, then infoExtra (chip info and WiFi form on the device)
+ * /mem      ?filename=x shows file x (config with the password masked), ?delete=x erases it, else the file list
+ * /dump     ?filename=x[&format=html|json] hex dump of file x, streamed
+ * /upload   multipart file upload
+ * /files    the files with size, mtime and ETag and the used and free bytes as JSON, ?format=html as a table
+ *
+ * Written against Http.h and the FileStore of the HAL, so they run on the ESP8266 and on the host.
+ * The files go through a FileIndex, lists and storage statistics come from RAM and stay current after
+ * uploads and deletes. A file of /mem?filename=x has its ETag, If-None-Match answers 304 while it is unchanged.
+ * A dump keeps its own position, concurrent dumps don't disturb each other.
+ */
+
+#ifndef FileApi_h
+#define FileApi_h
+
+#include "Http.h"
+#include "FileIndex.h"
+
+#define FILEPATHLEN 64
+
+// fname with or without leading '/'
+void filePath(char *path, size_t len, std::string_view fname);
+
+class FileApi
+{
+  public:
+    FileApi(FileIndex &fs, bool showWifiPwd);
+    void info(HttpRequest &req, HttpResponse &res);
+    void mem(HttpRequest &req, HttpResponse &res);
+    void dump(HttpRequest &req, HttpResponse &res);
+    void upload(HttpRequest &req, std::string_view filename, size_t index, const uint8_t *data, size_t len, bool final,
+      HttpResponse *res);
+    void files(HttpRequest &req, HttpResponse &res);
+    void listFiles(TextSink &out);
+
+    std::function<void(TextSink &out)> infoExtra;
+
+  private:
+    FileIndex &_fs;
+    bool _showWifiPwd;
+};
+
+#endif
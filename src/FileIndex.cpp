@@ -0,0 +1,162 @@
+#include "FileIndex.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *bare(const char *path)
+{
+  while (*path=='/') path++;
+  return path;
+}
+
+FileIndex::FileIndex(FileStore &store, std::function<uint32_t()> now) : _store(store), _now(now)
+{
+}
+
+// scans the directory of the store, again after a removal while incomplete
+void FileIndex::begin()
+{
+  _count=0;
+  _complete=true;
+  _stats.scans++;
+  _store.list([](void *ctx, const char *name, uint32_t size, uint32_t mtime)
+  {
+    FileIndex &ix=*(FileIndex *)ctx;
+    FileEntry *e=ix._add(name);
+    if (!e) return;
+    e->size=size;
+    e->mtime=mtime;
+    e->version=0;
+  }, this);
+  _usageDirty=true;
+}
+
+bool FileIndex::exists(const char *path)
+{
+  if (!_complete)
+  {
+    _stats.passed++;
+    return _store.exists(path);
+  }
+  _stats.lookups++;
+  return _find(path)!=nullptr;
+}
+
+int FileIndex::size(const char *path)
+{
+  if (!_complete)
+  {
+    _stats.passed++;
+    return _store.size(path);
+  }
+  _stats.lookups++;
+  FileEntry *e=_find(path);
+  return e?(int)e->size:-1;
+}
+
+// the content is not kept, only a missing file is answered from RAM
+int FileIndex::read(const char *path, uint32_t offset, char *buf, size_t len)
+{
+  if (_complete && !_find(path)) return -1;
+  return _store.read(path, offset, buf, len);
+}
+
+bool FileIndex::write(const char *path, const char *data, size_t len)
+{
+  bool ok=_store.write(path, data, len);
+  _changed(_find(path), path, ok?(int)len:_store.size(path));
+  return ok;
+}
+
+bool FileIndex::append(const char *path, const char *data, size_t len)
+{
+  bool ok=_store.append(path, data, len);
+  FileEntry *e=_find(path);
+  _changed(e, path, ok && e?(int)(e->size+len):_store.size(path));
+  return ok;
+}
+
+bool FileIndex::remove(const char *path)
+{
+  bool ok=_store.remove(path);
+  _changed(_find(path), path, ok?-1:_store.size(path));
+  if (ok && !_complete) begin();
+  return ok;
+}
+
+void FileIndex::list(void (*fn)(void *ctx, const char *name, uint32_t size, uint32_t mtime), void *ctx)
+{
+  if (!_complete)
+  {
+    _stats.passed++;
+    _store.list(fn, ctx);
+    return;
+  }
+  _stats.lookups++;
+  for (int i=0;i<_count;i++) fn(ctx, _files[i].name, _files[i].size, _files[i].mtime);
+}
+
+bool FileIndex::usage(uint32_t &total, uint32_t &used)
+{
+  if (_usageDirty)
+  {
+    _stats.usageReads++;
+    if (!_store.usage(_total, _used)) return false;
+    _usageDirty=false;
+  }
+  total=_total;
+  used=_used;
+  return true;
+}
+
+// nullptr if the file is missing or the index incomplete
+const FileEntry *FileIndex::find(const char *path)
+{
+  return _complete?_find(path):nullptr;
+}
+
+char *FileIndex::etag(char *out, size_t len, const FileEntry &e)
+{
+  snprintf(out, len, "\"%x-%x-%x\"", (unsigned)e.size, (unsigned)e.mtime, (unsigned)e.version);
+  return out;
+}
+
+FileEntry *FileIndex::_find(const char *path)
+{
+  const char *name=bare(path);
+  for (int i=0;i<_count;i++) if (strcmp(_files[i].name, name)==0) return &_files[i];
+  return nullptr;
+}
+
+// nullptr if there is no room, the index is incomplete then
+FileEntry *FileIndex::_add(const char *path)
+{
+  const char *name=bare(path);
+  if (_count>=FILEINDEXMAX || strlen(name)>=FILEINDEXNAME)
+  {
+    _complete=false;
+    return nullptr;
+  }
+  FileEntry &e=_files[_count++];
+  strcpy(e.name, name);
+  e.size=0;
+  e.mtime=0;
+  e.version=0;
+  return &e;
+}
+
+// size is what the file has now, -1 if it is gone
+void FileIndex::_changed(FileEntry *e, const char *path, int size)
+{
+  _stats.changes++;
+  _usageDirty=true;
+  if (size<0)
+  {
+    if (e) *e=_files[--_count];
+    return;
+  }
+  if (!e) e=_add(path);
+  if (!e) return;
+  e->size=size;
+  e->mtime=_now();
+  e->version=++_version;
+}
@@ -0,0 +1,76 @@
+/* File list and storage statistics kept in RAM
+ *
+ * A FileStore in front of the one of the flash: begin() scans its directory once, after that the
+ * writes, appends and removes that go through the index update it, so listing the files, their size
+ * and whether they exist need no access to the flash. Every file has the epoch seconds it was last
+ * written (mtime, 0 if unknown) and an ETag that changes with each write.
+ * The used and total bytes of the flash come from the store at the first usage() after a change only.
+ * With more than FILEINDEXMAX files or a longer name the index is incomplete and passes lists and
+ * lookups through to the store until a removal makes room and it scans again.
+ */
+
+#ifndef FileIndex_h
+#define FileIndex_h
+
+#include <functional>
+#include "hal/Hal.h"
+
+#define FILEINDEXMAX 24      // files in the index
+#define FILEINDEXNAME 32     // bytes of a name without its '/', with the NUL (like LFS_NAME_MAX)
+#define FILEETAGLEN 32
+
+struct FileEntry
+{
+  char name[FILEINDEXNAME];
+  uint32_t size;
+  uint32_t mtime;      // epoch seconds
+  uint32_t version;    // of the index at the last change, 0 since begin()
+};
+
+struct FileIndexStats
+{
+  uint32_t scans=0;        // of the directory of the store
+  uint32_t lookups=0;      // served from RAM
+  uint32_t passed=0;       // passed through while incomplete
+  uint32_t changes=0;      // writes, appends and removes
+  uint32_t usageReads=0;   // of the used bytes from the store
+};
+
+class FileIndex : public FileStore
+{
+  public:
+    FileIndex(FileStore &store, std::function<uint32_t()> now);
+    void begin();
+    bool exists(const char *path) override;
+    int size(const char *path) override;
+    int read(const char *path, uint32_t offset, char *buf, size_t len) override;
+    bool write(const char *path, const char *data, size_t len) override;
+    bool append(const char *path, const char *data, size_t len) override;
+    bool remove(const char *path) override;
+    void list(void (*fn)(void *ctx, const char *name, uint32_t size, uint32_t mtime), void *ctx) override;
+    bool usage(uint32_t &total, uint32_t &used) override;
+
+    bool complete() const {return _complete;}
+    const FileEntry *find(const char *path);
+    // quoted, for the ETag header and If-None-Match
+    static char *etag(char *out, size_t len, const FileEntry &e);
+    const FileIndexStats &stats() const {return _stats;}
+
+  private:
+    FileStore &_store;
+    std::function<uint32_t()> _now;
+    FileEntry _files[FILEINDEXMAX];
+    int _count=0;
+    bool _complete=false;      // false until begin()
+    uint32_t _version=0;
+    uint32_t _total=0;
+    uint32_t _used=0;
+    bool _usageDirty=true;
+    FileIndexStats _stats;
+
+    FileEntry *_find(const char *path);
+    FileEntry *_add(const char *path);
+    void _changed(FileEntry *e, const char *path, int size);
+};
+
+#endif
@@ -0,0 +1,121 @@
+#include "GzipTemplate.h"
+
+#define CRCPOLY 0xedb88320
+
+// half a byte at a time, the table stays small
+static const uint32_t CRCNIBBLE[16] PROGMEM=
+{
+  0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac, 0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+  0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c, 0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c
+};
+
+uint32_t gzipCrc32(uint32_t crc, const uint8_t *data, size_t len)
+{
+  crc=~crc;
+  while (len--)
+  {
+    crc^=*data++;
+    crc=(crc>>4)^pgm_read_dword(&CRCNIBBLE[crc&15]);
+    crc=(crc>>4)^pgm_read_dword(&CRCNIBBLE[crc&15]);
+  }
+  return ~crc;
+}
+
+// a*b modulo the CRC polynomial, bit reflected like the CRC
+static uint32_t multModP(uint32_t a, uint32_t b)
+{
+  uint32_t m=1u<<31;
+  uint32_t p=0;
+  while (true)
+  {
+    if (a&m)
+    {
+      p^=b;
+      if ((a&(m-1))==0) break;
+    }
+    m>>=1;
+    b=b&1?(b>>1)^CRCPOLY:b>>1;
+  }
+  return p;
+}
+
+// like zlib: crc(a) shifted over lenB zero bytes is x^(8*lenB)*crc(a)
+uint32_t gzipCrc32Combine(uint32_t crcA, uint32_t crcB, uint32_t lenB)
+{
+  uint32_t p=1u<<31;      // x^0
+  uint32_t sq=1u<<30;     // x^1
+  for (int i=0;i<3;i++) sq=multModP(sq, sq);    // x^8, a byte
+  while (lenB)
+  {
+    if (lenB&1) p=multModP(sq, p);
+    sq=multModP(sq, sq);
+    lenB>>=1;
+  }
+  return multModP(p, crcA)^crcB;
+}
+
+GzipTemplate::GzipTemplate(const GzipPart &head, const GzipPart &tail, std::string &&fragment)
+  : _head(head), _tail(tail), _fragment(std::move(fragment))
+{
+  uint32_t crc=gzipCrc32(head.crc, (const uint8_t *)_fragment.data(), _fragment.size());
+  crc=gzipCrc32Combine(crc, tail.crc, tail.size);
+  uint32_t size=head.size+_fragment.size()+tail.size;
+  for (int i=0;i<4;i++)
+  {
+    _trailer[i]=crc>>(8*i);
+    _trailer[4+i]=size>>(8*i);
+  }
+  size_t blocks=(_fragment.size()+GZIPSTORED-1)/GZIPSTORED;
+  _length=head.len+5*blocks+_fragment.size()+tail.len+sizeof(_trailer);
+}
+
+size_t GzipTemplate::fill(uint8_t *buf, size_t maxLen, size_t index)
+{
+  size_t n=0;
+  while (n<maxLen && index<_length)
+  {
+    size_t k;
+    size_t stored=_length-_head.len-_tail.len-sizeof(_trailer);
+    if (index<_head.len)
+    {
+      k=_head.len-index<maxLen-n?_head.len-index:maxLen-n;
+      memcpy_P(buf+n, _head.data+index, k);
+    }
+    else if (index<_head.len+stored) k=_stored(buf+n, maxLen-n, index-_head.len);
+    else if (index<_head.len+stored+_tail.len)
+    {
+      size_t at=index-_head.len-stored;
+      k=_tail.len-at<maxLen-n?_tail.len-at:maxLen-n;
+      memcpy_P(buf+n, _tail.data+at, k);
+    }
+    else
+    {
+      size_t at=index-(_length-sizeof(_trailer));
+      k=sizeof(_trailer)-at<maxLen-n?sizeof(_trailer)-at:maxLen-n;
+      memcpy(buf+n, _trailer+at, k);
+    }
+    n+=k;
+    index+=k;
+  }
+  return n;
+}
+
+// the fragment in stored blocks: BFINAL 0 and BTYPE 00 in a byte, LEN and its complement, the bytes
+size_t GzipTemplate::_stored(uint8_t *buf, size_t maxLen, size_t index)
+{
+  size_t block=index/(GZIPSTORED+5);
+  size_t at=index%(GZIPSTORED+5);
+  size_t from=block*GZIPSTORED;
+  size_t len=_fragment.size()-from<GZIPSTORED?_fragment.size()-from:GZIPSTORED;
+  if (at<5)
+  {
+    uint8_t head[5]={0, (uint8_t)len, (uint8_t)(len>>8), (uint8_t)~len, (uint8_t)(~len>>8)};
+    size_t k=5-at<maxLen?5-at:maxLen;
+    memcpy(buf, head+at, k);
+    return k;
+  }
+  at-=5;
+  size_t k=len-at<maxLen?len-at:maxLen;
+  memcpy(buf, _fragment.data()+from+at, k);
+  return k;
+}
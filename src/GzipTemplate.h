@@ -0,0 +1,52 @@
+/* Precompressed page with a fragment rendered per request
+ *
+ * tools/gzippage.py splits a page at its <!--##name--> marker and deflates both parts ahead of time:
+ * the head as a gzip header and deflate blocks ending with a sync flush (byte aligned, not final),
+ * the tail as deflate blocks ending with the final one. Only the fragment is new per request, it goes
+ * between them as stored (uncompressed) deflate blocks, so the whole is a single gzip member the
+ * browser inflates as one page. The gzip trailer takes the CRC-32 of all three: the one of the head
+ * continued over the fragment, combined with the precomputed one of the tail.
+ */
+
+#ifndef GzipTemplate_h
+#define GzipTemplate_h
+
+#include <string>
+#include <string_view>
+#include "hal/Platform.h"
+
+#define GZIPSTORED 65535    // bytes at most in a stored deflate block
+
+// a precompressed part in flash
+struct GzipPart
+{
+  const uint8_t *data;    // PROGMEM
+  uint32_t len;           // compressed bytes
+  uint32_t size;          // uncompressed bytes
+  uint32_t crc;           // CRC-32 of the uncompressed bytes
+};
+
+// CRC-32 of gzip, continued from crc (0 to start)
+uint32_t gzipCrc32(uint32_t crc, const uint8_t *data, size_t len);
+// CRC-32 of a+b from crc(a), crc(b) and the length of b
+uint32_t gzipCrc32Combine(uint32_t crcA, uint32_t crcB, uint32_t lenB);
+
+class GzipTemplate
+{
+  public:
+    GzipTemplate(const GzipPart &head, const GzipPart &tail, std::string &&fragment);
+    size_t length() const {return _length;}
+    // an HttpFiller: up to maxLen bytes of the gzip stream from offset index, 0 at the end
+    size_t fill(uint8_t *buf, size_t maxLen, size_t index);
+
+  private:
+    const GzipPart &_head;
+    const GzipPart &_tail;
+    std::string _fragment;
+    uint8_t _trailer[8];
+    size_t _length;
+
+    size_t _stored(uint8_t *buf, size_t maxLen, size_t index);
+};
+
+#endif
@@ -0,0 +1,46 @@
+/* Transport independent HTTP request and response
+ *
+ * Handlers written against these run behind ESPAsyncWebServer (hal/HalEsp8266) and on the host.
+ * A response is either written: begin(), header()s, then the body as a TextSink,
+ * or streamed: stream() with a filler that is called until it returns 0, like beginChunkedResponse, then header()s.
+ * Uploads (multipart/form-data) arrive in chunks, the last one has final set and a response to answer with.
+ */
+
+#ifndef Http_h
+#define Http_h
+
+#include <functional>
+#include <string_view>
+#include "TextUtil.h"
+
+#define HTTPBODYMAX 1024    // longer request bodies are dropped
+
+enum class HttpMethod { Get, Post, Put, Delete, Other };
+
+class HttpRequest
+{
+  public:
+    virtual HttpMethod method()=0;
+    virtual std::string_view path()=0;
+    virtual bool param(const char *name, std::string_view &value)=0;
+    virtual bool header(const char *name, std::string_view &value)=0;
+    virtual std::string_view body()=0;
+    virtual const void *id()=0;     // the same for every chunk of one upload
+};
+
+// fills buf with up to maxLen bytes of the body from offset index, 0 at the end
+typedef std::function<size_t(uint8_t *buf, size_t maxLen, size_t index)> HttpFiller;
+
+class HttpResponse : public TextSink
+{
+  public:
+    virtual void begin(int status, const char *contentType)=0;
+    virtual void header(const char *name, const char *value)=0;   // after begin() or stream(), before the body
+    virtual void stream(int status, const char *contentType, HttpFiller fill)=0;
+};
+
+typedef std::function<void(HttpRequest &req, HttpResponse &res)> HttpHandler;
+typedef std::function<void(HttpRequest &req, std::string_view filename, size_t index, const uint8_t *data, size_t len,
+  bool final, HttpResponse *res)> HttpUploadHandler;
+
+#endif
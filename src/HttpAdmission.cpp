@@ -0,0 +1,158 @@
+#include "HttpAdmission.h"
+#include <stdio.h>
+
+static const char *const CLASSES[]={"light", "normal", "heavy"};
+
+// -1 if there are too many routes, their requests are not limited then
+int HttpAdmission::route(const char *name, const HttpBudget &budget)
+{
+  if (_routeCount>=ADMITROUTES) return -1;
+  HttpRouteStats &r=_routes[_routeCount];
+  r.name=name;
+  r.budget=budget;
+  return _routeCount++;
+}
+
+// Run: handle it now and finish() it when it is gone, Wait: poll() runs or rejects it later,
+// Reject: answer with reject(); canWait false for requests that cannot be deferred (uploads)
+HttpAdmit HttpAdmission::admit(int route, void *ctx, uint32_t now, bool canWait)
+{
+  if (route<0) return HttpAdmit::Run;
+  HttpRouteStats &r=_routes[route];
+  if (_fits(r, false))
+  {
+    _start(route, ctx);
+    return HttpAdmit::Run;
+  }
+
+  if (r.budget.cls==HttpClass::Light || !canWait || _queued>=ADMITQUEUE)
+  {
+    if (_freeHeap()<_need(r)) r.rejectedHeap++;
+    else r.rejectedBusy++;
+    return HttpAdmit::Reject;
+  }
+  _queue[_queued++]={ctx, route, now};
+  r.queued++;
+  return HttpAdmit::Wait;
+}
+
+// from the loop, after the clock: rejects what waited too long, then runs what fits, Normal before Heavy
+void HttpAdmission::poll(uint32_t now, const std::function<void(void *ctx, int route, bool admitted)> &run)
+{
+  for (int i=0;i<_queued;)
+  {
+    Waiting w=_queue[i];
+    if (now-w.since<ADMITWAIT)
+    {
+      i++;
+      continue;
+    }
+    _remove(i);
+    _routes[w.route].expired++;
+    run(w.ctx, w.route, false);
+  }
+
+  for (HttpClass cls : {HttpClass::Normal, HttpClass::Heavy})
+  {
+    for (int i=0;i<_queued;)
+    {
+      Waiting w=_queue[i];
+      HttpRouteStats &r=_routes[w.route];
+      if (r.budget.cls!=cls || !_fits(r, true))
+      {
+        i++;
+        continue;
+      }
+      _remove(i);
+      _start(w.route, w.ctx);
+      if (now-w.since>r.maxWait) r.maxWait=now-w.since;
+      run(w.ctx, w.route, true);
+      i=0;      // run() may have finished others
+    }
+  }
+}
+
+// the request is gone: its slot is free again, or it leaves the queue
+void HttpAdmission::finish(void *ctx)
+{
+  for (int i=0;i<_runningCount;i++) if (_running[i].ctx==ctx)
+  {
+    HttpRouteStats &r=_routes[_running[i].route];
+    r.active--;
+    if (r.budget.cls==HttpClass::Heavy) _heavyActive--;
+    _running[i]=_running[--_runningCount];
+    return;
+  }
+  for (int i=0;i<_queued;i++) if (_queue[i].ctx==ctx)
+  {
+    _routes[_queue[i].route].cancelled++;
+    _remove(i);
+    return;
+  }
+}
+
+// ms until poll() has something to do
+uint32_t HttpAdmission::idleTime(uint32_t now)
+{
+  uint32_t wait=0xffffffff;
+  for (int i=0;i<_queued;i++)
+  {
+    if (_fits(_routes[_queue[i].route], true)) return 0;
+    uint32_t left=now-_queue[i].since>=ADMITWAIT?0:ADMITWAIT-(now-_queue[i].since);
+    if (left<wait) wait=left;
+  }
+  return wait;
+}
+
+void HttpAdmission::report(TextSink &out)
+{
+  char line[200];
+  snprintf(line, sizeof(line), "Free heap: %u bytes, reserve %u\nWaiting: %d of %d\n", (unsigned)_freeHeap(),
+    ADMITRESERVE, _queued, ADMITQUEUE);
+  out.print(line);
+  for (int i=0;i<_routeCount;i++)
+  {
+    const HttpRouteStats &r=_routes[i];
+    snprintf(line, sizeof(line), "%-12s %-6s active %u/%u admitted %u queued %u busy %u heap %u expired %u cancelled %u maxwait %u ms\n",
+      r.name, CLASSES[(int)r.budget.cls], r.active, r.budget.maxActive, (unsigned)r.admitted, (unsigned)r.queued,
+      (unsigned)r.rejectedBusy, (unsigned)r.rejectedHeap, (unsigned)r.expired, (unsigned)r.cancelled, (unsigned)r.maxWait);
+    out.print(line);
+  }
+}
+
+void HttpAdmission::reject(HttpResponse &res)
+{
+  res.begin(503, "text/plain");
+  res.header("Retry-After", ADMITRETRY);
+  res.print("Busy, retry later");
+}
+
+uint32_t HttpAdmission::_need(const HttpRouteStats &r)
+{
+  return r.budget.cls==HttpClass::Light?ADMITRESERVE/2:ADMITRESERVE+r.budget.heapCost;
+}
+
+// queued is false for a new request, which does not pass those waiting of its class or a higher one
+bool HttpAdmission::_fits(const HttpRouteStats &r, bool queued)
+{
+  if (r.active>=r.budget.maxActive || _runningCount>=ADMITACTIVE || _freeHeap()<_need(r)) return false;
+  if (r.budget.cls==HttpClass::Light) return true;
+  if (!queued) for (int i=0;i<_queued;i++) if (_routes[_queue[i].route].budget.cls<=r.budget.cls) return false;
+  if (r.budget.cls==HttpClass::Heavy && (_heavyActive>0 || (clockBusy && clockBusy()))) return false;
+  return true;
+}
+
+void HttpAdmission::_start(int route, void *ctx)
+{
+  HttpRouteStats &r=_routes[route];
+  _running[_runningCount++]={ctx, route};
+  r.active++;
+  r.admitted++;
+  if (r.budget.cls==HttpClass::Heavy) _heavyActive++;
+}
+
+void HttpAdmission::_remove(int i)
+{
+  for (int k=i+1;k<_queued;k++) _queue[k-1]=_queue[k];
+  _queued--;
+}
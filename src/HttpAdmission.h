@@ -0,0 +1,106 @@
+/* Admission control of the HTTP routes
+ *
+ * The web server must not take the heap and the CPU the clock needs. Every route has a budget: its class,
+ * how many of its requests may run at once and how much heap its handler needs. A request is admitted
+ * when its route has a free slot and the free heap minus that cost stays above ADMITRESERVE:
+ *   Light    status endpoints (/currenttime, /alarm/..): run at once while the heap is above half the
+ *            reserve, otherwise 503; they never wait behind the others
+ *   Normal   run at once if admitted, else they wait in the queue
+ *   Heavy    (/info, /mem, /dump, /upload) in addition one at a time over all routes, and not while
+ *            clockBusy() says a tick or an alarm is due: they wait and run from poll() in the loop after it
+ * The queue holds ADMITQUEUE requests, Normal ones before Heavy ones; what waited ADMITWAIT ms or finds the
+ * queue full gets a fast 503 with Retry-After. Admitted, queued, rejected and expired requests are counted
+ * per route.
+ *
+ * The transport passes an opaque ctx per request (the AsyncWebServerRequest, a connection of the emulator)
+ * and calls finish() when the request is gone, whether it ran, waited or was rejected.
+ */
+
+#ifndef HttpAdmission_h
+#define HttpAdmission_h
+
+#include <functional>
+#include <stdint.h>
+#include "Http.h"
+
+#define ADMITRESERVE 8000   // bytes of free heap kept for the clock, WiFi and lwIP
+#define ADMITQUEUE 4        // requests waiting for a slot
+#define ADMITWAIT 3000      // ms a request waits at most
+#define ADMITRETRY "2"      // s, Retry-After of a 503
+#define ADMITROUTES 16
+#define ADMITACTIVE 16      // requests running at once over all routes
+
+enum class HttpClass : uint8_t { Light, Normal, Heavy };
+
+struct HttpBudget
+{
+  HttpClass cls;
+  uint8_t maxActive;      // requests of the route at once
+  uint16_t heapCost;      // bytes the handler needs while it runs
+};
+
+constexpr HttpBudget HTTPLIGHT{HttpClass::Light, 4, 0};
+constexpr HttpBudget HTTPNORMAL{HttpClass::Normal, 2, 1500};
+constexpr HttpBudget HTTPHEAVY{HttpClass::Heavy, 1, 6000};
+
+enum class HttpAdmit { Run, Wait, Reject };
+
+struct HttpRouteStats
+{
+  const char *name=nullptr;
+  HttpBudget budget=HTTPNORMAL;
+  uint8_t active=0;
+  uint32_t admitted=0;
+  uint32_t queued=0;
+  uint32_t rejectedBusy=0;   // no slot and no room in the queue
+  uint32_t rejectedHeap=0;   // the heap was below the reserve
+  uint32_t expired=0;        // waited ADMITWAIT ms
+  uint32_t cancelled=0;      // the client left while it waited
+  uint32_t maxWait=0;        // ms
+};
+
+class HttpAdmission
+{
+  public:
+    HttpAdmission(std::function<uint32_t()> freeHeap) : _freeHeap(freeHeap) {}
+    int route(const char *name, const HttpBudget &budget);
+    HttpAdmit admit(int route, void *ctx, uint32_t now, bool canWait=true);
+    void poll(uint32_t now, const std::function<void(void *ctx, int route, bool admitted)> &run);
+    void finish(void *ctx);
+    uint32_t idleTime(uint32_t now);
+    void report(TextSink &out);
+
+    static void reject(HttpResponse &res);
+
+    std::function<bool()> clockBusy;
+
+  private:
+    struct Waiting
+    {
+      void *ctx;
+      int route;
+      uint32_t since;
+    };
+
+    struct Running
+    {
+      void *ctx;
+      int route;
+    };
+
+    std::function<uint32_t()> _freeHeap;
+    HttpRouteStats _routes[ADMITROUTES];
+    int _routeCount=0;
+    Waiting _queue[ADMITQUEUE];
+    int _queued=0;
+    Running _running[ADMITACTIVE];
+    int _runningCount=0;
+    uint8_t _heavyActive=0;
+
+    uint32_t _need(const HttpRouteStats &r);
+    bool _fits(const HttpRouteStats &r, bool queued);
+    void _start(int route, void *ctx);
+    void _remove(int i);
+};
+
+#endif
@@ -0,0 +1,16 @@
+#include "LedPatterns.h"
+
+#define N(steps) (sizeof(steps)/sizeof(steps[0]))
+
+// in LEDUNIT (20 ms), on, off, ...
+static const uint8_t CONNECTED[]={15, 25, 15, 25, 15, 25};
+static const uint8_t CONNECTING[]={5, 20};
+static const uint8_t APMODE[]={25, 250};
+static const uint8_t NTPFAIL[]={5, 10, 5, 100};
+static const uint8_t OTA[]={3, 3};
+
+const LedPattern LED_CONNECTED={"connected", CONNECTED, N(CONNECTED)};
+const LedPattern LED_CONNECTING={"connecting", CONNECTING, N(CONNECTING)};
+const LedPattern LED_APMODE={"apmode", APMODE, N(APMODE)};
+const LedPattern LED_NTPFAIL={"ntpfail", NTPFAIL, N(NTPFAIL)};
+const LedPattern LED_OTA={"ota", OTA, N(OTA)};
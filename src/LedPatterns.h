@@ -0,0 +1,32 @@
+/* Signal LED patterns
+ *
+ * What the LED of BasicESP8266 shows, from the lowest to the highest priority:
+ *   connected      three slow blinks, once
+ *   connecting     short blink every 0.5 s while WiFi connects
+ *   AP mode        half a second every 5.5 s
+ *   NTP failure    double blink every 2.4 s until the first NTP time
+ *   error code     n blinks and a pause, see LEDCODE_*
+ *   OTA            fast flicker while an update is written
+ */
+
+#ifndef LedPatterns_h
+#define LedPatterns_h
+
+#include "hal/LedSequencer.h"
+
+#define LEDNOTICE 0         // priorities
+#define LEDSTATE 1
+#define LEDFAULT 2
+#define LEDBUSY 3
+
+#define LEDCODE_FS 2        // file system could not be mounted
+#define LEDCODE_AP 3        // access point could not be started
+#define LEDCODE_OTA 4       // OTA update failed
+
+extern const LedPattern LED_CONNECTED;
+extern const LedPattern LED_CONNECTING;
+extern const LedPattern LED_APMODE;
+extern const LedPattern LED_NTPFAIL;
+extern const LedPattern LED_OTA;
+
+#endif
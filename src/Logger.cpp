@@ -0,0 +1,111 @@
+#include "Logger.h"
+#include <stdarg.h>
+
+#if FEATURE_LOG && defined(ARDUINO)
+
+Logger logger;
+
+void Logger::begin(bool toSerial, uint8_t level)
+{
+  _serial=toSerial;
+  setLevel(level);
+  if (_serial) Serial.begin(115200);
+}
+
+bool Logger::enabled(uint8_t level)
+{
+  return level<=_level;
+}
+
+void Logger::log_P(uint8_t level, const char *tag, PGM_P fmt, ...)
+{
+  if (level>_level) return;
+  uint32_t head=_head;
+  if (head-_tail>=LOGSLOTS)
+  {
+    _dropped++;
+    return;
+  }
+  LogEntry &e=_entries[head%LOGSLOTS];
+  e.seq=head;
+  e.ms=millis();
+  e.tag=tag;
+  e.level=level;
+  va_list args;
+  va_start(args, fmt);
+  vsnprintf_P(e.msg, LOGMSGLEN, fmt, args);
+  va_end(args);
+  __asm__ __volatile__ ("" ::: "memory");   // entry complete before it is published
+  _head=head+1;
+}
+
+void Logger::drain()
+{
+  if (!_serial)
+  {
+    _tail=_head;
+    return;
+  }
+  while (true)
+  {
+    if (_linePos>=_lineLen)
+    {
+      if (_tail==_head) return;
+      _lineLen=_format(_entries[_tail%LOGSLOTS], _line, sizeof(_line));
+      _linePos=0;
+      _tail=_tail+1;
+    }
+    int room=Serial.availableForWrite();
+    if (room<=0) return;
+    size_t n=_lineLen-_linePos;
+    if (n>(size_t)room) n=room;
+    Serial.write((const uint8_t *)_line+_linePos, n);
+    _linePos+=n;
+  }
+}
+
+uint32_t Logger::dump(Print &out, uint32_t since)
+{
+  char buf[LOGMSGLEN+32];
+  uint32_t head=_head;
+  uint32_t first=head>LOGSLOTS?head-LOGSLOTS:0;
+  if (since>first) first=since;
+  out.printf("# next %u, dropped %u, level %u\n", head, _dropped, _level);
+  for (uint32_t i=first;i<head;i++)
+  {
+    const LogEntry &e=_entries[i%LOGSLOTS];
+    if (e.seq!=i) continue;
+    out.printf("%u ", i);
+    out.write((const uint8_t *)buf, _format(e, buf, sizeof(buf)));
+  }
+  return head;
+}
+
+void Logger::setLevel(uint8_t level)
+{
+  _level=level>LOG_MAXLEVEL?LOG_MAXLEVEL:level;
+}
+
+uint8_t Logger::level()
+{
+  return _level;
+}
+
+uint32_t Logger::dropped()
+{
+  return _dropped;
+}
+
+size_t Logger::_format(const LogEntry &e, char *buf, size_t len)
+{
+  int n=snprintf(buf, len, "%7u %c %s: %s\n", e.ms, "EWID"[e.level], e.tag, e.msg);
+  if (n<0) return 0;
+  if ((size_t)n>=len)
+  {
+    buf[len-2]='\n';
+    return len-1;
+  }
+  return n;
+}
+
+#endif
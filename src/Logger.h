@@ -0,0 +1,104 @@
+/* Ring buffer logger
+ *
+ * LOGE/LOGW/LOGI/LOGD(tag, format, ...) format into a fixed ring of LOGSLOTS entries and return.
+ * Format strings stay in flash, nothing is allocated on the heap.
+ * drain() is called in idle time and writes only as much as the UART fifo takes without blocking.
+ * The boot logs more than the ring holds before the first loop(), BootProfile drains it after each phase
+ * of setup().
+ * A full ring drops the new message and counts it.
+ * /log shows the retained entries, /log?since=<seq> only newer ones, /log?level=<0..3> sets the level.
+ *
+ * Single producer: call from loop() or web server callbacks, never from an interrupt.
+ *
+ * Messages above LOG_MAXLEVEL and the whole logger with FEATURE_LOG=0 are removed at compile time.
+ * Host builds (no ARDUINO) have no ring and print each message straight to stderr.
+ */
+
+#ifndef Logger_h
+#define Logger_h
+
+#include "hal/Platform.h"
+#include "Features.h"
+
+#define LOGSLOTS 24
+#define LOGMSGLEN 80
+
+#define LOG_ERROR 0
+#define LOG_WARN 1
+#define LOG_INFO 2
+#define LOG_DEBUG 3
+
+#define LOG_NONE(tag, fmt, ...) do {} while (0)
+
+#ifdef ARDUINO
+#define LOG_EMIT(level, tag, fmt, ...) logger.log_P(level, tag, PSTR(fmt), ##__VA_ARGS__)
+#else
+#include <stdio.h>
+#define LOG_EMIT(level, tag, fmt, ...) fprintf(stderr, "%c %s: " fmt "\n", "EWID"[level], tag, ##__VA_ARGS__)
+#endif
+
+#if FEATURE_LOG && LOG_MAXLEVEL>=LOG_ERROR
+#define LOGE(tag, fmt, ...) LOG_EMIT(LOG_ERROR, tag, fmt, ##__VA_ARGS__)
+#else
+#define LOGE LOG_NONE
+#endif
+
+#if FEATURE_LOG && LOG_MAXLEVEL>=LOG_WARN
+#define LOGW(tag, fmt, ...) LOG_EMIT(LOG_WARN, tag, fmt, ##__VA_ARGS__)
+#else
+#define LOGW LOG_NONE
+#endif
+
+#if FEATURE_LOG && LOG_MAXLEVEL>=LOG_INFO
+#define LOGI(tag, fmt, ...) LOG_EMIT(LOG_INFO, tag, fmt, ##__VA_ARGS__)
+#else
+#define LOGI LOG_NONE
+#endif
+
+#if FEATURE_LOG && LOG_MAXLEVEL>=LOG_DEBUG
+#define LOGD(tag, fmt, ...) LOG_EMIT(LOG_DEBUG, tag, fmt, ##__VA_ARGS__)
+#else
+#define LOGD LOG_NONE
+#endif
+
+#if FEATURE_LOG && defined(ARDUINO)
+
+struct LogEntry
+{
+  uint32_t seq;
+  uint32_t ms;
+  const char *tag;
+  uint8_t level;
+  char msg[LOGMSGLEN];
+};
+
+class Logger
+{
+  public:
+    void begin(bool toSerial, uint8_t level);
+    void log_P(uint8_t level, const char *tag, PGM_P fmt, ...) __attribute__((format(printf, 4, 5)));
+    void drain();
+    uint32_t dump(Print &out, uint32_t since=0);
+    void setLevel(uint8_t level);
+    uint8_t level();
+    uint32_t dropped();
+    bool enabled(uint8_t level);
+
+  private:
+    size_t _format(const LogEntry &e, char *buf, size_t len);
+
+    LogEntry _entries[LOGSLOTS];
+    volatile uint32_t _head=0;       // next sequence number to write
+    volatile uint32_t _tail=0;       // next sequence number to drain
+    uint32_t _dropped=0;
+    uint8_t _level=LOG_INFO;
+    bool _serial=false;
+    char _line[LOGMSGLEN+32];
+    size_t _lineLen=0;
+    size_t _linePos=0;
+};
+
+extern Logger logger;
+
+#endif
+#endif
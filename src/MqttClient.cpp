@@ -0,0 +1,365 @@
+#include "MqttClient.h"
+#include <string.h>
+#include "Logger.h"
+
+#define MQTTCONNECT 0x10
+#define MQTTCONNACK 0x20
+#define MQTTPUBLISH 0x30
+#define MQTTPUBACK 0x40
+#define MQTTSUBSCRIBE 0x82
+#define MQTTPINGREQ 0xc0
+#define MQTTPINGRESP 0xd0
+
+#define MQTTPING (MQTTKEEPALIVE * 750UL)    // ms of silence after which the client pings
+
+static void copyString(char *dest, size_t size, const char *src) {
+    strncpy(dest, src ? src : "", size - 1);
+    dest[size - 1] = 0;
+}
+
+MqttClient::MqttClient(TcpStream &tcp) : _tcp(tcp) {
+}
+
+// connects from the next loop() on, the strings are copied
+void MqttClient::begin(const char *host, uint16_t port, const char *clientId, const char *willTopic,
+    const char *willPayload) {
+    copyString(_host, sizeof(_host), host);
+    copyString(_clientId, sizeof(_clientId), clientId);
+    copyString(_willTopic, sizeof(_willTopic), willTopic);
+    copyString(_willPayload, sizeof(_willPayload), willPayload);
+    _port = port;
+    _tcp.close();
+    _state = WAIT;
+    _wait = 0;
+    _backoff = MQTTBACKOFFMIN;
+}
+
+void MqttClient::loop(uint32_t now) {
+    _now = now;
+    switch(_state) {
+        case IDLE:
+            return;
+
+        case WAIT:
+            if(now - _since >= _wait)
+                _connect(now);
+            return;
+
+        case TCP: {
+            TcpState state = _tcp.state();
+            if(state == TCP_CLOSED || (state == TCP_CONNECTING && now - _since >= MQTTTIMEOUT)) {
+                LOGW("mqtt", "No connection to %s:%u", _host, _port);
+                _drop(now);
+                return;
+            }
+            if(state == TCP_CONNECTING)
+                return;
+
+            // CONNECT with a clean session and the will, sent at once
+            bool will = _willTopic[0] != 0;
+            size_t len = 10 + 2 + strlen(_clientId) + (will ? 4 + strlen(_willTopic) + strlen(_willPayload) : 0);
+            _begin(MQTTCONNECT, len);
+            _putString("MQTT");
+            uint8_t flags[] = { 4, (uint8_t)(will ? 0x26 : 0x02) };     // level 3.1.1, will retained
+            _put(flags, sizeof(flags));
+            _putWord(MQTTKEEPALIVE);
+            _putString(_clientId);
+            if(will) {
+                _putString(_willTopic);
+                _putString(_willPayload);
+            }
+            _txNow = true;
+            _state = CONNACK;
+            _since = now;
+            break;
+        }
+
+        case CONNACK:
+            if(now - _since >= MQTTTIMEOUT) {
+                LOGW("mqtt", "No CONNACK from %s", _host);
+                _drop(now);
+                return;
+            }
+            break;
+
+        case UP:
+            if(_pinging && now - _pingSent >= MQTTTIMEOUT) {
+                LOGW("mqtt", "Broker silent, reconnecting");
+                _drop(now);
+                return;
+            }
+            if(!_pinging && (now - _lastSent >= MQTTPING || now - _lastReceived >= MQTTPING) && _begin(MQTTPINGREQ, 0)) {
+                _pinging = true;
+                _pingSent = now;
+                _txNow = true;
+            }
+            break;
+    }
+
+    _receive(now);
+    if(_state == CONNACK || _state == UP)
+        _flush(now);
+}
+
+bool MqttClient::connected() const {
+    return _state == UP;
+}
+
+// QoS 0, queued for the next batch; false while not connected or if the queue is full
+bool MqttClient::publish(std::string_view topic, std::string_view payload, bool retain) {
+    if(_state != UP)
+        return false;
+
+    if(!_begin(MQTTPUBLISH | (retain ? 1 : 0), 2 + topic.size() + payload.size())) {
+        _stats.dropped++;
+        return false;
+    }
+    _putString(topic);
+    _put(payload.data(), payload.size());
+    _stats.published++;
+    return true;
+}
+
+// QoS 0, call it from onConnect: the session starts clean
+bool MqttClient::subscribe(std::string_view filter) {
+    if(_state != UP || !_begin(MQTTSUBSCRIBE, 2 + 2 + filter.size() + 1))
+        return false;
+
+    if(++_packetId == 0)
+        _packetId = 1;
+    _putWord(_packetId);
+    _putString(filter);
+    uint8_t qos = 0;
+    _put(&qos, 1);
+    _txNow = true;
+    return true;
+}
+
+// ms until loop() has something to do, 0xffffffff if never; received data wakes the loop anyway
+uint32_t MqttClient::idleTime(uint32_t now) const {
+    uint32_t wait = 0xffffffff;
+    switch(_state) {
+        case IDLE:
+            return wait;
+
+        case WAIT:
+            return now - _since >= _wait ? 0 : _wait - (now - _since);
+
+        case TCP:
+        case CONNACK:
+            wait = now - _since >= MQTTTIMEOUT ? 0 : MQTTTIMEOUT - (now - _since);
+            break;
+
+        case UP: {
+            uint32_t quiet = now - _lastSent < now - _lastReceived ? now - _lastSent : now - _lastReceived;
+            if(_pinging)
+                wait = now - _pingSent >= MQTTTIMEOUT ? 0 : MQTTTIMEOUT - (now - _pingSent);
+            else
+                wait = quiet >= MQTTPING ? 0 : MQTTPING - quiet;
+            break;
+        }
+    }
+
+    if(_txLen > 0) {
+        uint32_t batch = _txNow || now - _txSince >= MQTTBATCH ? 0 : MQTTBATCH - (now - _txSince);
+        if(batch < wait)
+            wait = batch;
+    }
+    return wait;
+}
+
+const MqttStats &MqttClient::stats() const {
+    return _stats;
+}
+
+void MqttClient::_connect(uint32_t now) {
+    LOGD("mqtt", "Connecting to %s:%u", _host, _port);
+    _state = TCP;
+    _since = now;
+    if(!_tcp.connect(_host, _port)) {
+        LOGW("mqtt", "Cannot connect to %s", _host);
+        _drop(now);
+    }
+}
+
+// closes and waits for the next try, the backoff starts over after a session that held
+void MqttClient::_drop(uint32_t now) {
+    if(_state == UP) {
+        LOGW("mqtt", "Connection lost");
+        if(now - _since >= MQTTBACKOFFMAX)
+            _backoff = MQTTBACKOFFMIN;
+    }
+
+    _tcp.close();
+    _stats.drops++;
+    _state = WAIT;
+    _since = now;
+    _wait = _backoff;
+    _backoff = _backoff * 2 < MQTTBACKOFFMAX ? _backoff * 2 : MQTTBACKOFFMAX;
+    _txLen = 0;
+    _txNow = false;
+    _rxLen = 0;
+    _rxSkip = 0;
+    _pinging = false;
+}
+
+// fixed header of a packet with len bytes after it, false if it does not fit the queue even after sending it
+bool MqttClient::_begin(uint8_t header, size_t len) {
+    uint8_t head[5] = { header };
+    size_t n = 1;
+    size_t rest = len;
+    do {
+        head[n] = rest % 128;
+        rest /= 128;
+        if(rest)
+            head[n] |= 0x80;
+        n++;
+    } while(rest && n < sizeof(head));
+
+    if(_txLen + n + len > sizeof(_tx) && _txLen > 0 && _state == UP) {
+        _txNow = true;      // sends what waits to make room
+        _flush(_now);
+    }
+    if(rest || _txLen + n + len > sizeof(_tx))
+        return false;
+
+    if(_txLen == 0)
+        _txSince = _now;
+    _put(head, n);
+    return true;
+}
+
+void MqttClient::_put(const void *data, size_t len) {
+    memcpy(_tx + _txLen, data, len);
+    _txLen += len;
+}
+
+void MqttClient::_putWord(uint16_t w) {
+    uint8_t b[] = { (uint8_t)(w >> 8), (uint8_t)w };
+    _put(b, 2);
+}
+
+void MqttClient::_putString(std::string_view s) {
+    _putWord(s.size());
+    _put(s.data(), s.size());
+}
+
+// the queue goes out when its batch is due, as much of it as the stream takes
+void MqttClient::_flush(uint32_t now) {
+    if(_txLen == 0 || (!_txNow && now - _txSince < MQTTBATCH && _txLen < MQTTBUFFER / 2))
+        return;
+
+    size_t n = _tcp.write(_tx, _txLen);
+    if(n == 0)
+        return;
+
+    _stats.writes++;
+    _lastSent = now;
+    _txLen -= n;
+    memmove(_tx, _tx + n, _txLen);
+    if(_txLen == 0)
+        _txNow = false;
+}
+
+// takes the complete packets received, skips those longer than the buffer
+void MqttClient::_receive(uint32_t now) {
+    while(true) {
+        int n = _tcp.read(_rx + _rxLen, sizeof(_rx) - _rxLen);
+        if(n < 0) {
+            _drop(now);
+            return;
+        }
+        if(n == 0)
+            return;
+
+        _lastReceived = now;
+        _rxLen += n;
+        size_t pos = 0;
+        while(pos < _rxLen) {
+            if(_rxSkip) {
+                size_t k = _rxSkip < _rxLen - pos ? _rxSkip : _rxLen - pos;
+                pos += k;
+                _rxSkip -= k;
+                continue;
+            }
+
+            // remaining length, up to 4 bytes of 7 bits
+            size_t len = 0, i = 1;
+            bool complete = false;
+            while(i < 5 && pos + i < _rxLen) {
+                uint8_t b = _rx[pos + i];
+                len |= (size_t)(b & 0x7f) << (7 * (i - 1));
+                i++;
+                if(!(b & 0x80)) {
+                    complete = true;
+                    break;
+                }
+            }
+            if(!complete) {
+                if(i == 5) {
+                    LOGW("mqtt", "Malformed packet");
+                    _drop(now);
+                    return;
+                }
+                break;
+            }
+
+            if(i + len > sizeof(_rx)) {
+                LOGW("mqtt", "Skipping a packet of %u bytes", (unsigned)(i + len));
+                _rxSkip = i + len;
+                continue;
+            }
+            if(pos + i + len > _rxLen)
+                break;
+
+            _handle(_rx[pos], _rx + pos + i, len, now);
+            if(_state == WAIT)
+                return;
+            pos += i + len;
+        }
+
+        _rxLen -= pos;
+        memmove(_rx, _rx + pos, _rxLen);
+    }
+}
+
+void MqttClient::_handle(uint8_t header, const uint8_t *data, size_t len, uint32_t now) {
+    switch(header & 0xf0) {
+        case MQTTCONNACK:
+            if(_state != CONNACK || len < 2 || data[1] != 0) {
+                LOGW("mqtt", "Connection refused: %u", len >= 2 ? data[1] : 0xff);
+                _drop(now);
+                return;
+            }
+            LOGI("mqtt", "Connected to %s", _host);
+            _state = UP;
+            _since = now;
+            _lastSent = now;
+            _stats.connects++;
+            if(onConnect)
+                onConnect();
+            break;
+
+        case MQTTPUBLISH: {
+            size_t topicLen = len >= 2 ? data[0] << 8 | data[1] : 0;
+            uint8_t qos = (header >> 1) & 3;
+            size_t start = 2 + topicLen + (qos ? 2 : 0);
+            if(len < 2 || start > len)
+                return;
+
+            if(qos == 1 && _begin(MQTTPUBACK, 2)) {
+                _put(data + 2 + topicLen, 2);
+                _txNow = true;
+            }
+            _stats.received++;
+            if(onMessage)
+                onMessage(std::string_view((const char *)data + 2, topicLen),
+                    std::string_view((const char *)data + start, len - start));
+            break;
+        }
+
+        case MQTTPINGRESP:
+            _pinging = false;
+            break;
+    }
+}
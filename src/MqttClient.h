@@ -0,0 +1,93 @@
+/* MQTT 3.1.1 client
+ *
+ * QoS 0 publish and subscribe over a TcpStream of the Hal, without blocking and without heap: loop() is
+ * called from the main loop and moves the connection on. It connects in the background and after a drop
+ * again after a backoff that doubles from MQTTBACKOFFMIN to MQTTBACKOFFMAX. The broker gets a last will,
+ * usually "offline" on a status topic, so the retained state can be trusted while the client is online.
+ * onConnect is called for every new session: subscribe there and publish the retained state again.
+ *
+ * publish() only queues the packet in a buffer of MQTTBUFFER bytes; the queue goes out in one write after
+ * MQTTBATCH ms or when it is half full, so a burst of publishes makes one TCP segment instead of many.
+ * A packet that does not fit sends the queue at once, what does not fit then is dropped and counted. Received packets up to MQTTRXBUFFER bytes are passed to
+ * onMessage, longer ones are skipped. idleTime() tells the loop how long nothing is due.
+ */
+
+#ifndef MqttClient_h
+#define MqttClient_h
+
+#include <functional>
+#include <string_view>
+#include "hal/Hal.h"
+
+#define MQTTBUFFER 1024         // bytes queued for sending
+#define MQTTRXBUFFER 1024       // longest packet received, a clock config fits
+#define MQTTKEEPALIVE 60        // s
+#define MQTTBATCH 50            // ms a queued packet waits for more
+#define MQTTTIMEOUT 10000       // ms for the TCP connection and the CONNACK
+#define MQTTBACKOFFMIN 1000     // ms
+#define MQTTBACKOFFMAX 60000
+
+struct MqttStats {
+    uint32_t connects = 0;
+    uint32_t drops = 0;         // connections lost or refused
+    uint32_t published = 0;
+    uint32_t dropped = 0;       // publishes that did not fit the queue
+    uint32_t writes = 0;        // batches sent
+    uint32_t received = 0;
+};
+
+class MqttClient {
+    public:
+        MqttClient(TcpStream &tcp);
+        void begin(const char *host, uint16_t port, const char *clientId, const char *willTopic = nullptr,
+            const char *willPayload = nullptr);
+        void loop(uint32_t now);
+        bool connected() const;
+        bool publish(std::string_view topic, std::string_view payload, bool retain = false);
+        bool subscribe(std::string_view filter);
+        uint32_t idleTime(uint32_t now) const;
+        const MqttStats &stats() const;
+
+        std::function<void()> onConnect;
+        std::function<void(std::string_view topic, std::string_view payload)> onMessage;
+
+    private:
+        enum _state { IDLE, WAIT, TCP, CONNACK, UP };
+
+        TcpStream &_tcp;
+        enum _state _state = IDLE;
+        char _host[64] = "";
+        uint16_t _port = 1883;
+        char _clientId[32] = "";
+        char _willTopic[96] = "";
+        char _willPayload[16] = "";
+        uint32_t _now = 0;          // ms of the last loop()
+        uint32_t _since = 0;        // ms the state began
+        uint32_t _wait = 0;         // ms in WAIT
+        uint32_t _backoff = MQTTBACKOFFMIN;
+        uint32_t _lastSent = 0;     // ms
+        uint32_t _lastReceived = 0;
+        uint32_t _pingSent = 0;
+        bool _pinging = false;
+        uint16_t _packetId = 0;
+        uint8_t _tx[MQTTBUFFER];
+        size_t _txLen = 0;
+        uint32_t _txSince = 0;      // ms the oldest queued packet waits since
+        bool _txNow = false;        // a control packet is queued, no batching
+        uint8_t _rx[MQTTRXBUFFER];
+        size_t _rxLen = 0;
+        uint32_t _rxSkip = 0;       // bytes of an oversized packet still to skip
+        MqttStats _stats;
+
+        void _connect(uint32_t now);
+        void _drop(uint32_t now);
+        bool _begin(uint8_t header, size_t len);
+        void _put(const void *data, size_t len);
+        void _putWord(uint16_t w);
+        void _putString(std::string_view s);
+        void _flush(uint32_t now);
+        void _receive(uint32_t now);
+        void _handle(uint8_t header, const uint8_t *data, size_t len, uint32_t now);
+};
+
+#endif
@@ -0,0 +1,174 @@
+#include "OtaUpdate.h"
+#include <stdlib.h>
+#include <string.h>
+#include "Logger.h"
+#include "Pages.h"
+#include "TextUtil.h"
+
+static const char *const STATES[]={"idle", "writing", "done", "failed"};
+
+OtaUpdate::OtaUpdate(FirmwareWriter &writer, std::function<uint32_t()> millis) : _writer(writer), _millis(millis)
+{
+}
+
+void OtaUpdate::form(HttpRequest &req, HttpResponse &res)
+{
+  res.begin(200, "text/html");
+  htmlBegin(res, "Update", false);
+  res.printP(UPDATEHTML);
+  htmlEnd(res, false);
+}
+
+// the first chunk starts the update, the final one ends it and answers
+void OtaUpdate::upload(HttpRequest &req, std::string_view filename, size_t index, const uint8_t *data, size_t len,
+  bool final, HttpResponse *res)
+{
+  if (index==0) _begin(req, data, len);
+  bool own=req.id()==_owner;
+  if (own && _status.state==OtaState::Writing && len>0)
+  {
+    if (_writer.write(data, len)!=len) _fail(_writer.error());
+    else
+    {
+      _status.received+=len;
+      _status.last=_millis();
+      if (_status.received>=_nextProgress)
+      {
+        LOGD("ota", "%u bytes written", (unsigned)_status.received);
+        _nextProgress+=OTAPROGRESS;
+      }
+    }
+  }
+  if (!final) return;
+
+  if (!own)
+  {
+    res->begin(409, "text/plain");
+    res->print("Another update is running\n");
+    return;
+  }
+  if (_status.state==OtaState::Writing)
+  {
+    if (_writer.end())
+    {
+      _status.state=OtaState::Done;
+      _status.updates++;
+    }
+    else _fail(_writer.error());
+  }
+  uint32_t ms=_status.last-_status.started;
+  if (_status.state==OtaState::Done)
+  {
+    LOGI("ota", "Update done, %u bytes in %u ms", (unsigned)_status.received, (unsigned)ms);
+    res->begin(200, "text/plain");
+    res->print("Update done, ");
+    res->print(_status.received);
+    res->print(" bytes in ");
+    res->print(ms);
+    res->print(" ms, restarting\n");
+    if (onEnd) onEnd(true);
+  }
+  else
+  {
+    res->begin(500, "text/plain");
+    res->print("Update failed: ");
+    res->print(_status.error);
+    res->print("\n");
+  }
+}
+
+void OtaUpdate::status(HttpRequest &req, HttpResponse &res)
+{
+  writing();
+  uint32_t end=_status.state==OtaState::Writing?_millis():_status.last;
+  uint32_t ms=_status.state==OtaState::Idle?0:end-_status.started;
+  res.begin(200, "application/json");
+  res.print("{\"state\":\"");
+  res.print(STATES[(int)_status.state]);
+  res.print(_status.target==ImageTarget::Firmware?"\",\"target\":\"firmware\"":"\",\"target\":\"fs\"");
+  res.print(_status.gzip?",\"gzip\":true":",\"gzip\":false");
+  res.print(",\"received\":");
+  res.print(_status.received);
+  res.print(",\"expected\":");
+  res.print(_status.expected);
+  res.print(",\"percent\":");
+  if (_status.state==OtaState::Done) res.print(100);    // expected counts the multipart framing too
+  else res.print(_status.expected?(uint32_t)((uint64_t)_status.received*100/_status.expected):0);
+  res.print(",\"elapsed\":");
+  res.print(ms);
+  res.print(",\"rate\":");
+  res.print(ms?(uint32_t)((uint64_t)_status.received*1000/ms):0);
+  res.print(",\"updates\":");
+  res.print(_status.updates);
+  res.print(",\"failures\":");
+  res.print(_status.failures);
+  res.print(",\"refused\":");
+  res.print(_status.refused);
+  res.print(",\"error\":\"");
+  for (const char *e=_status.error;*e;e++) if (*e!='"' && *e!='\\') res.write(e, 1);
+  res.print("\"}");
+}
+
+// an update that got no data for OTATIMEOUT ms was abandoned by its client
+bool OtaUpdate::writing()
+{
+  if (_status.state==OtaState::Writing && _millis()-_status.last>=OTATIMEOUT) _fail("Upload abandoned");
+  return _status.state==OtaState::Writing;
+}
+
+bool OtaUpdate::_begin(HttpRequest &req, const uint8_t *data, size_t len)
+{
+  if (writing())
+  {
+    LOGW("ota", "Upload refused, another update is running");
+    _status.refused++;
+    return false;
+  }
+  _owner=req.id();
+  std::string_view target, md5, length;
+  _status.target=req.param("target", target) && (target=="fs" || target=="filesystem")
+    ?ImageTarget::Filesystem:ImageTarget::Firmware;
+  _status.gzip=len>=2 && data[0]==0x1f && data[1]==0x8b;
+  _status.received=0;
+  char num[12]="";
+  if (req.header("Content-Length", length)) copyText(length, num, sizeof(num));
+  _status.expected=strtoul(num, nullptr, 10);
+  _status.started=_status.last=_millis();
+  _status.error[0]=0;
+  _status.state=OtaState::Writing;
+  _nextProgress=OTAPROGRESS;
+  if (onStart) onStart();
+
+  if (_status.gzip && _status.target==ImageTarget::Filesystem)
+  {
+    _fail("Compressed file system images are not supported");
+    return false;
+  }
+  if (!_writer.begin(_status.target))
+  {
+    _fail(_writer.error());
+    return false;
+  }
+  if (req.param("md5", md5))
+  {
+    char hex[33];
+    if (md5.size()!=32 || copyText(md5, hex, sizeof(hex))!=32 || !_writer.setMd5(hex))
+    {
+      _fail("Invalid MD5");
+      return false;
+    }
+  }
+  if (_status.target==ImageTarget::Firmware) LOGI("ota", "Firmware update started%s", _status.gzip?" (gzip)":"");
+  else LOGI("ota", "File system update started");
+  return true;
+}
+
+void OtaUpdate::_fail(const char *error)
+{
+  LOGE("ota", "Update failed: %s", error);
+  copyText(error, _status.error, sizeof(_status.error));
+  _status.state=OtaState::Failed;
+  _status.failures++;
+  _writer.abort();
+  if (onEnd) onEnd(false);
+}
@@ -0,0 +1,69 @@
+/* Firmware and file system updates over HTTP
+ *
+ * POST /update?target=firmware|fs[&md5=<hex>] with the image as a multipart upload, for example
+ *   curl -F "image=@firmware.bin.gz" "http://<ip>/update?md5=$(md5sum firmware.bin.gz | cut -c1-32)"
+ * GET /update has a form for the same. The chunks go to flash as they arrive (FirmwareWriter of the HAL),
+ * the MD5 of the upload is checked at its end, then onEnd(true) restarts the device.
+ * A firmware image may be gzip compressed (gzip -9 firmware.bin): it is stored as it is and the bootloader
+ * (eboot) inflates it when it copies the new firmware, so only the compressed bytes go over the air.
+ * A file system image must not be: eboot does not inflate it, and inflating it here needs a 32 KB window
+ * the heap does not have, such an upload is refused at its first chunk.
+ * GET /update/status has the progress and throughput of the running or last update as JSON.
+ * It runs on the web server, so unlike ArduinoOTA it works in AP mode and without espota. One update at a
+ * time: a new upload aborts one that got no data for OTATIMEOUT ms, while that one is live it gets 409.
+ */
+
+#ifndef OtaUpdate_h
+#define OtaUpdate_h
+
+#include <functional>
+#include "Http.h"
+#include "hal/Hal.h"
+
+#define OTATIMEOUT 10000    // ms without data before an update counts as abandoned
+#define OTAPROGRESS 65536   // bytes between the progress messages of the log
+#define OTAERRORLEN 48
+
+enum class OtaState : uint8_t { Idle, Writing, Done, Failed };
+
+struct OtaStatus
+{
+  OtaState state=OtaState::Idle;
+  ImageTarget target=ImageTarget::Firmware;
+  bool gzip=false;
+  uint32_t received=0;    // bytes of the image written
+  uint32_t expected=0;    // bytes of the request (with the multipart framing), 0 if unknown
+  uint32_t started=0;     // ms
+  uint32_t last=0;        // ms of the last chunk
+  uint32_t updates=0;
+  uint32_t failures=0;
+  uint32_t refused=0;     // uploads while another one was running
+  char error[OTAERRORLEN]="";
+};
+
+class OtaUpdate
+{
+  public:
+    OtaUpdate(FirmwareWriter &writer, std::function<uint32_t()> millis);
+    void form(HttpRequest &req, HttpResponse &res);
+    void upload(HttpRequest &req, std::string_view filename, size_t index, const uint8_t *data, size_t len, bool final,
+      HttpResponse *res);
+    void status(HttpRequest &req, HttpResponse &res);
+    bool writing();
+    const OtaStatus &stats() const {return _status;}
+
+    std::function<void()> onStart;
+    std::function<void(bool ok)> onEnd;
+
+  private:
+    FirmwareWriter &_writer;
+    std::function<uint32_t()> _millis;
+    OtaStatus _status;
+    const void *_owner=nullptr;   // the request of the update, HttpRequest::id()
+    uint32_t _nextProgress=0;
+
+    bool _begin(HttpRequest &req, const uint8_t *data, size_t len);
+    void _fail(const char *error);
+};
+
+#endif
@@ -0,0 +1,68 @@
+#include "Pages.h"
+
+// page templates and constant strings stay in flash and are copied only while a page is rendered
+
+const char WIFIHTML[] PROGMEM=
+    "<form action='/apsetup' method='POST'>\n"
+    "<table style='background-color:#ffff80;'>\n"
+    "<tr><td>WiFi name (SSID):</td><td><input type='text' size='30' maxlength='80' name='ssid' id='ssid' value='##ssid'></td></tr>\n"
+    "<tr><td>Password:</td><td><input type='text' size='30' maxlength='80' name='pwd' id='pwd' value='##pwd'></td></tr>\n"
+    "<tr><td>Static IP address (empty=DHCP):</td><td><input type='text' size='15' maxlength='15' name='adr' id='adr' value='##ip'></td></tr>\n"
+    "<tr><td>Gateway:</td><td><input type='text' size='15' maxlength='15' name='gateway' id='gateway' value='##gateway'></td></tr>\n"
+    "<tr><td>Netmask:</td><td><input type='text' size='15' maxlength='15' name='mask' id='mask' value='##netmask'></td></tr>"
+    "<tr><td>NTP Update Interval:</td><td><input type='text' size='15' maxlength='15' name='updateinterval' id='updateinterval' value='##updateinterval'></td></tr>"
+    "<tr><td>MQTT broker (empty=none):</td><td><input type='text' size='30' maxlength='63' name='broker' id='broker' value='##broker'></td></tr>\n"
+    "<tr><td>MQTT topic:</td><td><input type='text' size='30' maxlength='63' name='topic' id='topic' value='##topic'></td></tr>\n"
+    "<tr><td>MQTT port:</td><td><input type='text' size='5' maxlength='5' name='port' id='port' value='##port'></td></tr>\n"
+    "<tr><td>Peer time key (empty=off):</td><td><input type='text' size='30' maxlength='63' name='peer' id='peer' value='##peer'></td></tr>\n"
+    "<tr><td>&#160;</td><td>&#160;</td></tr>\n"
+    "</table>\n"
+    "<br><input type='submit' value='ok' name='ok'>\n"
+    "</form>\n";
+
+const char CHIPINFO[] PROGMEM=
+    "<table style='background-color:#d0d0d0';>\n"
+    "<tr><td>Chip real size</td><td>##real</td><tr>\n"
+    "<tr><td>Chip ide size</td><td>##ide</td><tr>\n"
+    "<tr><td>Chip mode</td><td>##mode</td><tr>\n"
+    "<tr><td>SPIFFS total memory</td><td>##total</td><tr>\n"
+    "<tr><td>SPIFFS used memory</td><td>##used</td><tr>\n"
+    "<tr><td>SPIFFS free memory</td><td>##free</td><tr>\n"
+    "</table><br>\n";
+
+const char UPDATEHTML[] PROGMEM=
+    "<form action='/update' method='POST' enctype='multipart/form-data'>\n"
+    "<table style='background-color:#d0d0d0;'>\n"
+    "<tr><td>Image (.bin, firmware also .bin.gz):</td><td><input type='file' name='image'></td></tr>\n"
+    "<tr><td>Target:</td><td><select onchange=\"this.form.action='/update?target='+this.value\">"
+    "<option value='firmware'>firmware</option><option value='fs'>file system</option></select></td></tr>\n"
+    "</table>\n"
+    "<br><input type='submit' value='update'>\n"
+    "</form>\n"
+    "<p><a href='/update/status'>status</a></p>\n";
+
+static const char HTMLHEAD[] PROGMEM="<!DOCTYPE html>\n<html>\n<head>\n<meta charset='UTF-8'>\n<title>\n";
+static const char HTMLBODY[] PROGMEM="\n</title>\n</head>\n<body style=\"font-family:arial,sans-serif,helvetica;\">\n";
+static const char HTMLTAIL[] PROGMEM="</body>\n</html>\n";
+
+void htmlBegin(TextSink &out, std::string_view title, bool citation)
+{
+  out.printP(HTMLHEAD);
+  htmlEscape(out, title);
+  out.printP(HTMLBODY);
+  if (citation) out.print("<pre>\n");
+}
+
+void htmlEnd(TextSink &out, bool citation)
+{
+  if (citation) out.print("</pre>\n");
+  out.printP(HTMLTAIL);
+}
+
+void htmlPage(TextSink &out, std::string_view a, bool citation, std::string_view title)
+{
+  htmlBegin(out, title, citation);
+  if (citation) htmlEscape(out, a);
+  else out.print(a);
+  htmlEnd(out, citation);
+}
@@ -0,0 +1,21 @@
+/* HTML page templates and frame
+ *
+ * The templates stay in flash (see renderTemplate in TextUtil.h for the ##name placeholders).
+ * Host independent, so the pages can be rendered and measured off-device.
+ */
+
+#ifndef Pages_h
+#define Pages_h
+
+#include "TextUtil.h"
+
+extern const char WIFIHTML[];
+extern const char CHIPINFO[];
+extern const char UPDATEHTML[];
+
+void htmlBegin(TextSink &out, std::string_view title, bool citation);
+void htmlEnd(TextSink &out, bool citation);
+// a as a page, escaped inside <pre> if citation
+void htmlPage(TextSink &out, std::string_view a, bool citation, std::string_view title);
+
+#endif
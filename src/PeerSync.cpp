@@ -0,0 +1,396 @@
+#include "PeerSync.h"
+#include <string.h>
+#include "ClockCore.h"
+#include "Logger.h"
+
+#define PEERVERSION 1
+#define PEERPACKET 36           // bytes, the MAC in the last 8
+
+enum PeerType : uint8_t { PEER_BEACON = 1, PEER_REQUEST, PEER_RESPONSE };
+
+static const char *const ROLES[] = { "ntp", "serving", "following" };
+
+//-----------------------------------------------  SipHash-2-4 ------------------------------------------------------------------------
+
+static inline uint64_t rotl(uint64_t x, int b) {
+    return (x << b) | (x >> (64 - b));
+}
+
+static inline void sipRound(uint64_t v[4]) {
+    v[0] += v[1]; v[1] = rotl(v[1], 13); v[1] ^= v[0]; v[0] = rotl(v[0], 32);
+    v[2] += v[3]; v[3] = rotl(v[3], 16); v[3] ^= v[2];
+    v[0] += v[3]; v[3] = rotl(v[3], 21); v[3] ^= v[0];
+    v[2] += v[1]; v[1] = rotl(v[1], 17); v[1] ^= v[2]; v[2] = rotl(v[2], 32);
+}
+
+static uint64_t get64(const uint8_t *p, size_t n = 8) {
+    uint64_t x = 0;
+    for(size_t i = 0; i < n; i++)
+        x |= (uint64_t)p[i] << (8 * i);
+    return x;
+}
+
+static uint64_t sipHash(const uint64_t key[2], const uint8_t *data, size_t len) {
+    uint64_t v[4] = { key[0] ^ 0x736f6d6570736575ULL, key[1] ^ 0x646f72616e646f6dULL,
+        key[0] ^ 0x6c7967656e657261ULL, key[1] ^ 0x7465646279746573ULL };
+    size_t full = len & ~(size_t)7;
+    for(size_t i = 0; i < full; i += 8) {
+        uint64_t m = get64(data + i);
+        v[3] ^= m;
+        sipRound(v);
+        sipRound(v);
+        v[0] ^= m;
+    }
+    uint64_t m = get64(data + full, len - full) | (uint64_t)len << 56;
+    v[3] ^= m;
+    sipRound(v);
+    sipRound(v);
+    v[0] ^= m;
+    v[2] ^= 0xff;
+    for(int i = 0; i < 4; i++)
+        sipRound(v);
+    return v[0] ^ v[1] ^ v[2] ^ v[3];
+}
+
+//-----------------------------------------------  packet ------------------------------------------------------------------------
+
+static void put(uint8_t *p, uint64_t x, size_t n) {
+    for(size_t i = 0; i < n; i++)
+        p[i] = x >> (8 * i);
+}
+
+// ms of the clock, now() and subSecond() of the same second
+static uint64_t clockMs(ClockSource &clock) {
+    uint32_t s;
+    uint16_t ms;
+    do {
+        s = clock.now();
+        ms = clock.subSecond();
+    } while(clock.now() != s);
+    return (uint64_t)s * 1000 + ms;
+}
+
+// ms until period has passed since since, 0 if it has
+static uint32_t until(uint32_t now, uint32_t since, uint32_t period) {
+    return now - since >= period ? 0 : period - (now - since);
+}
+
+PeerSync::PeerSync(ClockSource &clock, UdpPort &udp, TimeSync &upstream)
+    : _clock(clock), _udp(udp), _upstream(upstream) {
+}
+
+// id identifies the clock among its peers, key is the passphrase they share; false if either is missing or
+// the port cannot be opened, then the upstream is used alone
+bool PeerSync::begin(uint32_t id, const char *key) {
+    if(id == 0 || !key || !*key)
+        return false;
+    if(!_udp.begin(PEERPORT) || !_udp.joinGroup(PEERGROUP)) {
+        LOGE("peer", "Cannot open port %u", PEERPORT);
+        return false;
+    }
+
+    const uint64_t zero[2] = {};
+    _key[0] = sipHash(zero, (const uint8_t *)key, strlen(key));
+    const uint64_t salted[2] = { _key[0], 1 };
+    _key[1] = sipHash(salted, (const uint8_t *)key, strlen(key));
+
+    _id = id;
+    _enabled = true;
+    _lastPoll = _clock.millis() - PEERBEACON;
+    LOGI("peer", "Peer sync as clock %08x", (unsigned)_id);
+    return true;
+}
+
+void PeerSync::loop() {
+    if(!_enabled)
+        return;
+
+    uint8_t msg[PEERPACKET + 1];
+    uint32_t at;
+    int n;
+    while((n = _udp.receive(msg, sizeof(msg), nullptr, nullptr, &at)) >= 0)
+        _handle(msg, n, at);
+
+    uint32_t now = _clock.millis();
+
+    // whether this clock could serve the time
+    if(_upstreamOn && now - _lastPoll >= PEERBEACON) {
+        uint16_t ms;
+        bool time = _upstream.getEpochTime(ms) != 0;
+        if(time && !_upstreamTime)
+            _listenSince = now;
+        if(time)
+            _upstreamAt = now;
+        _upstreamTime = time;
+        _lastPoll = now;
+    }
+
+    if(_masterId && now - _masterAt >= PEERTIMEOUT) {
+        LOGW("peer", "Clock %08x silent", (unsigned)_masterId);
+        _masterId = 0;
+        _sampleCount = 0;
+        _requestPending = false;
+        if(!_upstreamOn)
+            _fallBack("no beacon");
+    }
+    if(!_upstreamOn && now - _lastSample >= PEERTIMEOUT)
+        _fallBack("no answer");
+
+    bool serve = _candidate(now)
+        && (!_masterId || _better(1, _error(now), _id, _masterStratum, _masterError, _masterId));
+    if(serve != _beaconing) {
+        if(serve)
+            LOGI("peer", "Serving the time, error %u ms", _error(now));
+        else
+            LOGI("peer", "Stopped serving the time");
+        _beaconing = serve;
+        _lastBeacon = now - PEERBEACON;
+        _requestPending = false;
+    }
+    if(_beaconing && now - _lastBeacon >= PEERBEACON && _send(PEER_BEACON, 0, 0, 0)) {
+        _lastBeacon = now;
+        _stats.beacons++;
+    }
+
+    if(!_beaconing && _masterId && now - _lastRequest >= PEERPOLL && _send(PEER_REQUEST, _masterId, now, 0)) {
+        _lastRequest = now;
+        _requestT1 = now;
+        _requestPending = true;
+        _stats.requests++;
+    }
+}
+
+// ms until loop() has something to do; received packets wake the loop anyway
+uint32_t PeerSync::idleTime() {
+    uint32_t wait = 0xffffffff;
+    if(!_enabled)
+        return wait;
+
+    uint32_t now = _clock.millis();
+    uint32_t due[] = {
+        _upstreamOn ? until(now, _lastPoll, PEERBEACON) : wait,
+        _masterId ? until(now, _masterAt, PEERTIMEOUT) : wait,
+        !_upstreamOn ? until(now, _lastSample, PEERTIMEOUT) : wait,
+        _beaconing ? until(now, _lastBeacon, PEERBEACON) : wait,
+        !_beaconing && _upstreamOn && _upstreamTime ? until(now, _listenSince, PEERLISTEN) : wait,
+        !_beaconing && _masterId ? until(now, _lastRequest, PEERPOLL) : wait,
+    };
+    for(uint32_t d : due)
+        if(d < wait)
+            wait = d;
+    return wait;
+}
+
+// the time of the clock followed, projected from its best answer, otherwise that of the upstream
+uint32_t PeerSync::getEpochTime(uint16_t &ms) {
+    if(_upstreamOn) {
+        uint32_t t = _upstream.getEpochTime(ms);
+        if(t && _enabled) {
+            if(!_upstreamTime)
+                _listenSince = _clock.millis();
+            _upstreamTime = true;
+            _upstreamAt = _clock.millis();
+        }
+        return t;
+    }
+
+    const Sample *best = _best();
+    if(!best)
+        return 0;
+    uint64_t t = best->utc + (_clock.millis() - best->at);
+    ms = t % 1000;
+    return t / 1000;
+}
+
+uint32_t PeerSync::updateInterval() {
+    return _upstreamOn ? _upstream.updateInterval() : PEERPOLL;
+}
+
+void PeerSync::report(JsonObject out) {
+    uint32_t now = _clock.millis();
+    out["enabled"] = _enabled;
+    out["id"] = _id;
+    out["role"] = ROLES[_beaconing ? 1 : _following() ? 2 : 0];
+    out["master"] = _beaconing ? _id : _masterId;
+    out["upstream"] = _upstreamOn;
+
+    const Sample *best = _best();
+    if(_beaconing) {
+        out["stratum"] = 1;
+        out["error"] = _error(now);
+    } else if(_following() && best) {
+        out["stratum"] = _masterStratum + 1;
+        out["error"] = best->error + (uint32_t)((uint64_t)(now - best->at) * PEERDRIFT / 1000000);
+        out["delay"] = best->delay;
+    }
+
+    JsonObject s = out["stats"].to<JsonObject>();
+    s["beacons"] = _stats.beacons;
+    s["requests"] = _stats.requests;
+    s["answers"] = _stats.answers;
+    s["samples"] = _stats.samples;
+    s["dropped"] = _stats.dropped;
+    s["badmac"] = _stats.badMac;
+    s["laststep"] = _stats.lastStep;
+    s["lastdelay"] = _stats.lastDelay;
+}
+
+const PeerStats &PeerSync::stats() const {
+    return _stats;
+}
+
+bool PeerSync::_following() {
+    return !_upstreamOn && _sampleCount > 0;
+}
+
+// has a time of its own and listened long enough to know the clocks serving already
+bool PeerSync::_candidate(uint32_t now) {
+    return _upstreamOn && _upstreamTime && now - _listenSince >= PEERLISTEN;
+}
+
+// the answer with the shortest round trip, its time is the least disturbed
+const PeerSync::Sample *PeerSync::_best() {
+    const Sample *best = nullptr;
+    for(uint8_t i = 0; i < _sampleCount; i++)
+        if(!best || _samples[i].delay < best->delay)
+            best = &_samples[i];
+    return best;
+}
+
+// of the own time: that of NTP, growing with the drift since the upstream had it last
+uint16_t PeerSync::_error(uint32_t now) {
+    return PEERNTPERROR + (uint32_t)((uint64_t)(now - _upstreamAt) * PEERDRIFT / 1000000);
+}
+
+bool PeerSync::_better(uint8_t stratum, uint16_t error, uint32_t id, uint8_t thanStratum, uint16_t thanError,
+    uint32_t thanId) {
+    if(stratum != thanStratum)
+        return stratum < thanStratum;
+    if(error >= thanError + PEERHYSTERESIS || thanError >= error + PEERHYSTERESIS)
+        return error < thanError;
+    return id < thanId;
+}
+
+// beacons and answers carry the upstream time at the moment they are sent, false without one
+bool PeerSync::_send(uint8_t type, uint32_t to, uint32_t t1, uint32_t hold) {
+    uint8_t msg[PEERPACKET] = { 'E', 'C', PEERVERSION, type };
+    if(type != PEER_REQUEST) {
+        uint16_t ms = 0;
+        uint32_t utc = _upstream.getEpochTime(ms);
+        if(utc == 0)
+            return false;
+        msg[4] = 1;
+        put(msg + 6, _error(_clock.millis()), 2);
+        put(msg + 20, utc, 4);
+        put(msg + 24, ms, 2);
+        put(msg + 26, hold > 0xffff ? 0xffff : hold, 2);
+    }
+    put(msg + 8, _id, 4);
+    put(msg + 12, to, 4);
+    put(msg + 16, t1, 4);
+    put(msg + PEERPACKET - 8, sipHash(_key, msg, PEERPACKET - 8), 8);
+    return _udp.sendTo(PEERGROUP, PEERPORT, msg, sizeof(msg));
+}
+
+// at is the arrival, the beacon ages from then
+void PeerSync::_handle(const uint8_t *msg, int len, uint32_t at) {
+    if(len != PEERPACKET || msg[0] != 'E' || msg[1] != 'C' || msg[2] != PEERVERSION)
+        return;
+    if(sipHash(_key, msg, PEERPACKET - 8) != get64(msg + PEERPACKET - 8)) {
+        _stats.badMac++;
+        return;
+    }
+
+    uint8_t type = msg[3];
+    uint8_t stratum = msg[4];
+    uint16_t error = get64(msg + 6, 2);
+    uint32_t from = get64(msg + 8, 4);
+    uint32_t to = get64(msg + 12, 4);
+    uint32_t t1 = get64(msg + 16, 4);
+    if(from == _id)
+        return;
+
+    switch(type) {
+        case PEER_BEACON:
+            if(from != _masterId && _masterId && at - _masterAt < PEERTIMEOUT
+                && !_better(stratum, error, from, _masterStratum, _masterError, _masterId))
+                return;
+            if(from != _masterId) {
+                LOGI("peer", "Clock %08x serves the time, stratum %u, error %u ms", (unsigned)from, stratum, error);
+                _masterId = from;
+                _sampleCount = 0;
+                _requestPending = false;
+                _lastRequest = at - PEERPOLL;
+            }
+            _masterStratum = stratum;
+            _masterError = error;
+            _masterAt = at;
+            break;
+
+        case PEER_REQUEST:
+            if(_beaconing && to == _id && _send(PEER_RESPONSE, from, t1, _clock.millis() - at))
+                _stats.answers++;
+            break;
+
+        case PEER_RESPONSE:
+            if(to != _id)
+                return;
+            if(_beaconing || from != _masterId || !_requestPending || t1 != _requestT1) {
+                _stats.dropped++;
+                return;
+            }
+            _requestPending = false;
+            _sample(get64(msg + 20, 4), get64(msg + 24, 2), t1, get64(msg + 26, 2), at);
+            break;
+    }
+}
+
+// like NTP: the answer left the master half the round trip before it arrived
+void PeerSync::_sample(uint32_t utc, uint16_t ms, uint32_t t1, uint32_t hold, uint32_t at) {
+    uint32_t rtt = at - t1;
+    if(rtt < hold || rtt - hold > PEERMAXDELAY) {
+        LOGD("peer", "Answer dropped, round trip %u ms, held %u ms", (unsigned)rtt, (unsigned)hold);
+        _stats.dropped++;
+        return;
+    }
+
+    Sample &s = _samples[_sampleNext];
+    s.delay = rtt - hold;
+    s.utc = (uint64_t)utc * 1000 + ms + s.delay / 2;
+    s.at = at;
+    s.error = _masterError + s.delay / 2;
+    _sampleNext = (_sampleNext + 1) % PEERSAMPLES;
+    if(_sampleCount < PEERSAMPLES)
+        _sampleCount++;
+    _lastSample = at;
+    _stats.samples++;
+    _stats.lastDelay = s.delay;
+
+    // how far the own clock was off, if it has a time already
+    int64_t step = 0;
+    if(_clock.now() >= CLOCKSET)
+        step = (int64_t)(s.utc + (_clock.millis() - at)) - (int64_t)clockMs(_clock);
+    _stats.lastStep = step > INT32_MAX ? INT32_MAX : step < INT32_MIN ? INT32_MIN : (int32_t)step;
+    LOGD("peer", "Sample from %08x: round trip %u ms, clock off by %d ms", (unsigned)_masterId,
+        (unsigned)s.delay, (int)_stats.lastStep);
+
+    if(_upstreamOn) {
+        LOGI("peer", "Following clock %08x, NTP off", (unsigned)_masterId);
+        _setUpstream(false);
+    }
+}
+
+void PeerSync::_fallBack(const char *why) {
+    LOGW("peer", "Back to NTP: %s", why);
+    _sampleCount = 0;
+    _requestPending = false;
+    _setUpstream(true);
+}
+
+void PeerSync::_setUpstream(bool on) {
+    _upstreamOn = on;
+    _upstreamTime = false;
+    _lastPoll = _clock.millis() - PEERBEACON;
+    if(upstreamActive)
+        upstreamActive(on);
+}
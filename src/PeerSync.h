@@ -0,0 +1,108 @@
+/* Time from a clock on the LAN
+ *
+ * A TimeSync in front of the NTP one (upstream): of the clocks with a fresh NTP time one is elected, it sends
+ * a beacon every PEERBEACON ms to the multicast group PEERGROUP with its stratum and error estimate. The
+ * others follow it: every PEERPOLL ms they ask for its time, the answer carries how long the request was
+ * held, so the round trip of the LAN is measured and half of it added (like NTP). Of the last PEERSAMPLES
+ * answers the one with the shortest round trip counts. While a clock follows, its upstream is switched
+ * off (upstreamActive), so a building of clocks makes the NTP queries of one. Without a beacon or an answer
+ * for PEERTIMEOUT ms it falls back to the upstream and, once that has the time, takes part in the election.
+ *
+ * The election: a clock with an upstream time listens PEERLISTEN ms, then beacons unless it hears a better
+ * one: lower stratum, then lower error (differences below PEERHYSTERESIS ms do not count), then lower id.
+ * All messages carry a SipHash-2-4 MAC keyed from a passphrase shared by the clocks, others are dropped.
+ * Packets are stamped at their arrival by the UdpPort, so the idle sleep of the loop does not count as
+ * network delay. Several host instances on one machine meet through the group as well.
+ */
+
+#ifndef PeerSync_h
+#define PeerSync_h
+
+#include <functional>
+#include <ArduinoJson.h>
+#include "hal/Hal.h"
+
+#define PEERPORT 12123
+#define PEERGROUP 0x030cffef    // 239.255.12.3, first octet in the low byte
+#define PEERBEACON 8000         // ms between the beacons of the elected clock
+#define PEERLISTEN 20000        // ms a clock listens before it beacons itself
+#define PEERPOLL 16000          // ms between the time requests of a follower
+#define PEERTIMEOUT 40000       // ms without a beacon or answer before a follower falls back to NTP
+#define PEERSAMPLES 4           // answers of which the shortest round trip counts
+#define PEERMAXDELAY 250        // ms, answers with a longer round trip are dropped
+#define PEERNTPERROR 50         // ms, error of a fresh NTP time
+#define PEERDRIFT 100           // ppm, the error grows with the age of the time
+#define PEERHYSTERESIS 20       // ms
+
+struct PeerStats {
+    uint32_t beacons = 0;       // sent
+    uint32_t requests = 0;
+    uint32_t answers = 0;       // sent to followers
+    uint32_t samples = 0;       // answers taken
+    uint32_t dropped = 0;       // answers too late or out of turn
+    uint32_t badMac = 0;
+    int32_t lastStep = 0;       // ms the clock was off at the last sample
+    uint32_t lastDelay = 0;     // ms round trip of the last sample
+};
+
+class PeerSync : public TimeSync {
+    public:
+        PeerSync(ClockSource &clock, UdpPort &udp, TimeSync &upstream);
+        bool begin(uint32_t id, const char *key);
+        void loop();
+        uint32_t idleTime();
+        uint32_t getEpochTime(uint16_t &ms) override;
+        uint32_t updateInterval() override;
+        void report(JsonObject out);
+        const PeerStats &stats() const;
+
+        std::function<void(bool active)> upstreamActive;
+
+    private:
+        struct Sample {
+            uint64_t utc = 0;       // ms at the arrival
+            uint32_t at = 0;        // millis() of the arrival
+            uint32_t delay = 0;     // ms round trip
+            uint16_t error = 0;     // ms, of the master and half the round trip
+        };
+
+        ClockSource &_clock;
+        UdpPort &_udp;
+        TimeSync &_upstream;
+        bool _enabled = false;
+        uint32_t _id = 0;
+        uint64_t _key[2] = {};
+        bool _upstreamOn = true;
+        bool _upstreamTime = false; // the upstream has the time since it is on
+        uint32_t _upstreamAt = 0;   // millis() it last had it
+        uint32_t _listenSince = 0;  // millis() the upstream has the time since
+        uint32_t _lastPoll = 0;
+        uint32_t _masterId = 0;     // best other clock beaconing, 0 if none
+        uint8_t _masterStratum = 0;
+        uint16_t _masterError = 0;
+        uint32_t _masterAt = 0;     // millis() of its last beacon
+        bool _beaconing = false;
+        uint32_t _lastBeacon = 0;
+        uint32_t _lastRequest = 0;
+        uint32_t _requestT1 = 0;    // millis() of the request pending
+        bool _requestPending = false;
+        uint32_t _lastSample = 0;   // millis() of the arrival of the newest answer
+        Sample _samples[PEERSAMPLES];
+        uint8_t _sampleCount = 0;
+        uint8_t _sampleNext = 0;
+        PeerStats _stats;
+
+        bool _following();
+        bool _candidate(uint32_t now);
+        const Sample *_best();
+        uint16_t _error(uint32_t now);
+        bool _better(uint8_t stratum, uint16_t error, uint32_t id, uint8_t thanStratum, uint16_t thanError,
+            uint32_t thanId);
+        bool _send(uint8_t type, uint32_t to, uint32_t t1, uint32_t hold);
+        void _handle(const uint8_t *msg, int len, uint32_t at);
+        void _sample(uint32_t utc, uint16_t ms, uint32_t t1, uint32_t hold, uint32_t at);
+        void _fallBack(const char *why);
+        void _setUpstream(bool on);
+};
+
+#endif
@@ -0,0 +1,148 @@
+#include "StallWatch.h"
+#include "Logger.h"
+#include <stddef.h>
+
+StallWatch stallWatch;
+
+static const char *resetReasonName(uint32_t reason)
+{
+  switch (reason)
+  {
+    case REASON_DEFAULT_RST:      return "power on";
+    case REASON_WDT_RST:          return "hardware watchdog";
+    case REASON_EXCEPTION_RST:    return "exception";
+    case REASON_SOFT_WDT_RST:     return "software watchdog";
+    case REASON_SOFT_RESTART:     return "software restart";
+    case REASON_DEEP_SLEEP_AWAKE: return "deep sleep wake";
+    case REASON_EXT_SYS_RST:      return "external reset";
+  }
+  return "unknown";
+}
+
+void StallWatch::begin(uint32_t budget)
+{
+  _budget=budget;
+  _depth=0;
+  uint32_t reason=ESP.getResetInfoPtr()->reason;
+  ESP.rtcUserMemoryRead(STALL_RTCBLOCK, (uint32_t *)&_prev, sizeof(_prev));
+  if (_prev.magic==STALL_MAGIC && reason!=REASON_DEFAULT_RST)
+  {
+    _prev.active[STALL_NAMELEN-1]=0;
+    _prev.stalled[STALL_NAMELEN-1]=0;
+    _prev.resetReason=reason;
+    _hasPrev=_prev.active[0]!=0 || _prev.stallCount>0 || reason==REASON_WDT_RST || reason==REASON_SOFT_WDT_RST || reason==REASON_EXCEPTION_RST;
+    _rec=_prev;
+  }
+  else
+  {
+    memset(&_rec, 0, sizeof(_rec));
+    _rec.magic=STALL_MAGIC;
+    _hasPrev=false;
+  }
+  _rec.active[0]=0;
+  _rec.activeSince=0;
+  _rec.resetReason=reason;
+  _save();
+
+  LOGI("stall", "Reset reason: %s", resetReasonName(reason));
+  if (_hasPrev && _prev.active[0]) LOGW("stall", "Running at reset: %s (entered at %u ms)", _prev.active, _prev.activeSince);
+  if (_hasPrev && _prev.stallCount>0) LOGW("stall", "Last stall: %s %u ms, free heap %u", _prev.stalled, _prev.stallDuration, _prev.stallHeap);
+}
+
+void StallWatch::enter(const char *section)
+{
+  uint32_t now=millis();
+  if (_depth<STALL_DEPTH)
+  {
+    _name[_depth]=section;
+    _start[_depth]=now;
+  }
+  _depth++;
+  _setActive(section, now);
+}
+
+void StallWatch::leave(uint32_t budget)
+{
+  if (_depth==0) return;
+  _depth--;
+  if (_depth>=STALL_DEPTH) return;
+  uint32_t duration=millis()-_start[_depth];
+  if (duration>(budget>0?budget:_budget)) _record(_name[_depth], duration);
+  if (_depth>0) _setActive(_name[_depth-1], _start[_depth-1]);
+  else _setActive("", 0);
+}
+
+void StallWatch::loopStart()
+{
+  _depth=0;
+  enter("loop");
+}
+
+void StallWatch::loopEnd()
+{
+  while (_depth>0) leave();
+}
+
+bool StallWatch::hasReport()
+{
+  return _hasPrev;
+}
+
+String StallWatch::report()
+{
+  String res="Reset reason: "+String(resetReasonName(_rec.resetReason))+"\n";
+  if (_hasPrev)
+  {
+    if (_prev.active[0]) res+="Running at reset: "+String(_prev.active)+" (entered at "+String(_prev.activeSince)+" ms)\n";
+    if (_prev.stallCount>0) res+="Last stall before reset: "+String(_prev.stalled)+" "+String(_prev.stallDuration)+" ms, free heap "+String(_prev.stallHeap)+"\n";
+  }
+  res+="Stalls since power on: "+String(_rec.stallCount)+" (budget "+String(_budget)+" ms)\n";
+  if (_rec.stallCount>0) res+="Last stall: "+String(_rec.stalled)+" "+String(_rec.stallDuration)+" ms, free heap "+String(_rec.stallHeap)+"\n";
+  return res;
+}
+
+uint32_t StallWatch::stallCount()
+{
+  return _rec.stallCount;
+}
+
+uint32_t StallWatch::budget()
+{
+  return _budget;
+}
+
+void StallWatch::_record(const char *section, uint32_t duration)
+{
+  strncpy(_rec.stalled, section, STALL_NAMELEN-1);
+  _rec.stalled[STALL_NAMELEN-1]=0;
+  _rec.stallDuration=duration;
+  _rec.stallHeap=ESP.getFreeHeap();
+  _rec.stallCount++;
+  _save();
+  LOGW("stall", "%s took %u ms, free heap %u", section, duration, _rec.stallHeap);
+}
+
+void StallWatch::_setActive(const char *section, uint32_t since)
+{
+  // only the active part is rewritten, it changes on every section boundary
+  strncpy(_rec.active, section, STALL_NAMELEN-1);
+  _rec.active[STALL_NAMELEN-1]=0;
+  _rec.activeSince=since;
+  ESP.rtcUserMemoryWrite(STALL_RTCBLOCK+offsetof(StallRecord, active)/4, (uint32_t *)_rec.active, STALL_NAMELEN+4);
+}
+
+void StallWatch::_save()
+{
+  ESP.rtcUserMemoryWrite(STALL_RTCBLOCK, (uint32_t *)&_rec, sizeof(_rec));
+}
+
+StallSection::StallSection(const char *section, uint32_t budget)
+{
+  _budget=budget;
+  stallWatch.enter(section);
+}
+
+StallSection::~StallSection()
+{
+  stallWatch.leave(_budget);
+}
@@ -0,0 +1,72 @@
+/* Loop stall watchdog
+ *
+ * Measures every loop iteration and every registered section (StallSection) against a budget.
+ * The innermost running section is mirrored into RTC user memory, so after a watchdog or
+ * exception reset the next boot still knows which code path was running.
+ * Stalls over budget are recorded with duration and free heap and reported after the next boot.
+ *
+ * RTC user memory blocks 0..31 are used by eboot for OTA, the record starts at block 32.
+ */
+
+#ifndef StallWatch_h
+#define StallWatch_h
+
+#include <Arduino.h>
+
+#define STALL_NAMELEN 16
+#define STALL_DEPTH 4
+#define STALL_RTCBLOCK 32
+#define STALL_MAGIC 0x53544c31
+
+struct StallRecord
+{
+  uint32_t magic;
+  char active[STALL_NAMELEN];      // section running at the moment of the reset
+  uint32_t activeSince;            // millis() when the active section was entered
+  char stalled[STALL_NAMELEN];     // last section that went over budget
+  uint32_t stallDuration;          // ms
+  uint32_t stallHeap;              // free heap after the stall
+  uint32_t stallCount;             // stalls since last power on
+  uint32_t resetReason;            // reason of the boot that followed the record
+};
+
+class StallWatch
+{
+  public:
+    void begin(uint32_t budget);
+    void enter(const char *section);
+    void leave(uint32_t budget=0);
+    void loopStart();
+    void loopEnd();
+    bool hasReport();
+    String report();
+    uint32_t stallCount();
+    uint32_t budget();
+
+  private:
+    void _record(const char *section, uint32_t duration);
+    void _setActive(const char *section, uint32_t since);
+    void _save();
+
+    StallRecord _rec;
+    StallRecord _prev;
+    bool _hasPrev=false;
+    uint32_t _budget=250;
+    const char *_name[STALL_DEPTH];
+    uint32_t _start[STALL_DEPTH];
+    uint8_t _depth=0;
+};
+
+class StallSection
+{
+  public:
+    StallSection(const char *section, uint32_t budget=0);
+    ~StallSection();
+
+  private:
+    uint32_t _budget;
+};
+
+extern StallWatch stallWatch;
+
+#endif
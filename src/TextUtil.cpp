@@ -0,0 +1,174 @@
+#include "TextUtil.h"
+
+static const char HEXDIGITS[]="0123456789abcdef";
+
+void TextSink::print(uint32_t n)
+{
+  char buf[11];
+  size_t i=sizeof(buf);
+  do
+  {
+    buf[--i]='0'+n%10;
+    n/=10;
+  } while (n>0);
+  write(buf+i, sizeof(buf)-i);
+}
+
+void TextSink::printP(PGM_P s)
+{
+  char buf[64];
+  size_t len=strlen_P(s);
+  while (len>0)
+  {
+    size_t n=len<sizeof(buf)?len:sizeof(buf);
+    memcpy_P(buf, s, n);
+    write(buf, n);
+    s+=n;
+    len-=n;
+  }
+}
+
+BufferSink::BufferSink(char *buf, size_t size)
+{
+  _buf=buf;
+  _size=size;
+  if (_size>0) _buf[0]=0;
+}
+
+void BufferSink::write(const char *s, size_t len)
+{
+  size_t room=_size>_len?_size-_len-1:0;
+  size_t n=len<room?len:room;
+  memcpy(_buf+_len, s, n);
+  _len+=n;
+  if (_size>0) _buf[_len]=0;
+  overflow+=len-n;
+}
+
+static bool isBlank(char c)
+{
+  return c==' ' || c=='\t' || c=='\r' || c=='\n';
+}
+
+// value of the first line starting with key=
+std::string_view iniValue(std::string_view src, std::string_view key)
+{
+  size_t p=0;
+  while (p<src.size())
+  {
+    size_t e=src.find('\n', p);
+    if (e==std::string_view::npos) e=src.size();
+    std::string_view line=src.substr(p, e-p);
+    if (line.size()>key.size() && line[key.size()]=='=' && line.compare(0, key.size(), key)==0)
+    {
+      std::string_view v=line.substr(key.size()+1);
+      while (!v.empty() && isBlank(v.front())) v.remove_prefix(1);
+      while (!v.empty() && isBlank(v.back())) v.remove_suffix(1);
+      return v;
+    }
+    p=e+1;
+  }
+  return std::string_view();
+}
+
+bool iniHasKey(std::string_view src, std::string_view key)
+{
+  size_t p=0;
+  while (p<src.size())
+  {
+    size_t e=src.find('\n', p);
+    if (e==std::string_view::npos) e=src.size();
+    if (e-p>key.size() && src[p+key.size()]=='=' && src.compare(p, key.size(), key)==0) return true;
+    p=e+1;
+  }
+  return false;
+}
+
+int iniCountKeys(std::string_view src)
+{
+  int n=0;
+  for (char c : src) if (c=='=') n++;
+  return n;
+}
+
+size_t copyText(std::string_view src, char *out, size_t outLen)
+{
+  if (outLen==0) return 0;
+  size_t n=src.size()<outLen-1?src.size():outLen-1;
+  memcpy(out, src.data(), n);
+  out[n]=0;
+  return n;
+}
+
+// one pass, unescaped runs are written in one piece
+void htmlEscape(TextSink &out, std::string_view s)
+{
+  size_t start=0;
+  for (size_t i=0;i<s.size();i++)
+  {
+    const char *rep;
+    switch (s[i])
+    {
+      case '&': rep="&amp;"; break;
+      case '<': rep="&lt;"; break;
+      case '>': rep="&gt;"; break;
+      case '"': rep="&quot;"; break;
+      case '\'': rep="&#39;"; break;
+      default: continue;
+    }
+    out.write(s.data()+start, i-start);
+    out.write(rep, strlen(rep));
+    start=i+1;
+  }
+  out.write(s.data()+start, s.size()-start);
+}
+
+char *hex8(char *out, uint8_t v)
+{
+  out[0]=HEXDIGITS[v>>4];
+  out[1]=HEXDIGITS[v&15];
+  return out+2;
+}
+
+char *hex32(char *out, uint32_t v)
+{
+  for (int i=7;i>=0;i--)
+  {
+    out[i]=HEXDIGITS[v&15];
+    v>>=4;
+  }
+  return out+8;
+}
+
+// "pppppppp: xxxx xxxx ..    ascii" for up to 32 bytes, missing bytes are padded
+void hexDumpLine(TextSink &out, uint32_t pos, const uint8_t *data, size_t n, bool quoted)
+{
+  char line[8+2+32*3+4+32+2];
+  char *p=line;
+  if (quoted) *p++='"';
+  p=hex32(p, pos);
+  *p++=':';
+  *p++=' ';
+  for (size_t i=0;i<32;i++)
+  {
+    if (i<n)
+    {
+      p=hex8(p, data[i]);
+      if (i%2==1) *p++=' ';
+    }
+    else
+    {
+      memcpy(p, "   ", 3);
+      p+=3;
+    }
+  }
+  memcpy(p, "    ", 4);
+  p+=4;
+  for (size_t i=0;i<32;i++)
+  {
+    uint8_t c=i<n?data[i]:46;
+    *p++=(c>32 && c<127 && c!=34 && c!=92)?c:46;
+  }
+  if (quoted) *p++='"';
+  out.write(line, p-line);
+}
@@ -0,0 +1,112 @@
+/* Allocation free text helpers
+ *
+ * Work on non-owning views (std::string_view) into existing text and write into caller supplied
+ * buffers or a TextSink. Nothing here allocates heap memory.
+ *
+ * config files are "key=value" lines, values are trimmed
+ * templates are flash strings with ##name placeholders, names are letters and digits
+ */
+
+#ifndef TextUtil_h
+#define TextUtil_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <string_view>
+
+#include "hal/Platform.h"
+
+class TextSink
+{
+  public:
+    virtual void write(const char *s, size_t len)=0;
+    void print(std::string_view s) {write(s.data(), s.size());}
+    void print(uint32_t n);
+    void printP(PGM_P s);
+};
+
+// fixed buffer, always NUL terminated, text beyond the buffer is counted in overflow
+class BufferSink : public TextSink
+{
+  public:
+    BufferSink(char *buf, size_t size);
+    void write(const char *s, size_t len) override;
+    std::string_view view() const {return std::string_view(_buf, _len);}
+    size_t overflow=0;
+
+  private:
+    char *_buf;
+    size_t _size;
+    size_t _len=0;
+};
+
+#ifdef ARDUINO
+class PrintSink : public TextSink
+{
+  public:
+    PrintSink(Print &out) : _out(out) {}
+    void write(const char *s, size_t len) override {_out.write((const uint8_t *)s, len);}
+
+  private:
+    Print &_out;
+};
+
+class StringSink : public TextSink
+{
+  public:
+    StringSink(String &out) : _out(out) {}
+    void write(const char *s, size_t len) override {_out.concat(s, len);}
+
+  private:
+    String &_out;
+};
+#endif
+
+std::string_view iniValue(std::string_view src, std::string_view key);
+bool iniHasKey(std::string_view src, std::string_view key);
+int iniCountKeys(std::string_view src);
+size_t copyText(std::string_view src, char *out, size_t outLen);
+
+void htmlEscape(TextSink &out, std::string_view s);
+char *hex8(char *out, uint8_t v);
+char *hex32(char *out, uint32_t v);
+void hexDumpLine(TextSink &out, uint32_t pos, const uint8_t *data, size_t n, bool quoted);
+
+// writes tpl to out, every ##name is replaced by what var(out, name) writes
+template<typename F> void renderTemplate(TextSink &out, PGM_P tpl, F var)
+{
+  char run[64];
+  size_t n=0;
+  char name[24];
+  while (true)
+  {
+    char c=pgm_read_byte(tpl);
+    if (c=='#' && pgm_read_byte(tpl+1)=='#')
+    {
+      out.write(run, n);
+      n=0;
+      tpl+=2;
+      size_t k=0;
+      while (true)
+      {
+        char d=pgm_read_byte(tpl);
+        if (!((d>='a' && d<='z') || (d>='A' && d<='Z') || (d>='0' && d<='9')) || k==sizeof(name)) break;
+        name[k++]=d;
+        tpl++;
+      }
+      var(out, std::string_view(name, k));
+      continue;
+    }
+    if (c==0 || n==sizeof(run))
+    {
+      out.write(run, n);
+      n=0;
+      if (c==0) return;
+    }
+    run[n++]=c;
+    tpl++;
+  }
+}
+
+#endif
@@ -0,0 +1,75 @@
+#include "TicklessIdle.h"
+#include <coredecls.h>
+
+TicklessIdle tickless;
+
+void TicklessIdle::sleep(uint32_t ms, bool lightSleep)
+{
+  uint32_t now=millis();
+  _window(now);
+#if FEATURE_IDLE
+  if (ms==0) return;
+  if (ms>IDLEMAX) ms=IDLEMAX;
+
+  WiFiMode_t mode=WiFi.getMode();
+  if (mode==WIFI_AP || mode==WIFI_AP_STA) _setSleepType(WIFI_NONE_SLEEP);
+  else _setSleepType(FEATURE_LIGHTSLEEP && lightSleep?WIFI_LIGHT_SLEEP:WIFI_MODEM_SLEEP);
+
+  _woken=false;
+  uint32_t start=micros();
+  esp_delay(ms, [this]() {return !_woken;});
+  uint32_t us=micros()-start;
+  _idleUs+=us;
+  _windowIdleUs+=us;
+  _sleeps++;
+  if (_woken) _wakes++;
+#endif
+}
+
+// from interrupts and web handlers: the loop has work, end the sleep
+void IRAM_ATTR TicklessIdle::wake()
+{
+  _woken=true;
+  esp_schedule();
+}
+
+void TicklessIdle::report(TextSink &out)
+{
+  uint32_t up=millis();
+  uint32_t idle=_idleUs/1000;
+  out.print("Uptime: ");
+  out.print(up);
+  out.print(" ms\nIdle: ");
+  out.print(idle);
+  out.print(" ms\nActive: ");
+  out.print(up-idle);
+  out.print(" ms\nActive since boot: ");
+  out.print(up>0?(uint32_t)((up-idle)*1000ULL/up):1000);
+  out.print(" per mille\nActive last minute: ");
+  out.print(_lastActive);
+  out.print(" per mille\nSleeps: ");
+  out.print(_sleeps);
+  out.print(", woken early: ");
+  out.print(_wakes);
+  out.print("\nWiFi sleep: ");
+  out.print(_sleepType==WIFI_LIGHT_SLEEP?"light":_sleepType==WIFI_MODEM_SLEEP?"modem":"none");
+  out.print("\n");
+}
+
+// the sleep type is only set on a change, the SDK call reconfigures the radio
+void TicklessIdle::_setSleepType(WiFiSleepType_t type)
+{
+  if (type==_sleepType) return;
+  WiFi.setSleepMode(type);
+  _sleepType=type;
+}
+
+void TicklessIdle::_window(uint32_t now)
+{
+  uint32_t elapsed=now-_windowStart;
+  if (elapsed<IDLEWINDOW) return;
+  uint32_t idle=_windowIdleUs/elapsed;     // per mille, us per ms
+  _lastActive=idle<1000?1000-idle:0;
+  _windowStart=now;
+  _windowIdleUs=0;
+}
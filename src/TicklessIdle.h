@@ -0,0 +1,46 @@
+/* Tickless idle
+ *
+ * Instead of spinning, the loop sleeps from the end of its work to the next deadline. sleep() waits in
+ * esp_delay(), so the WiFi stack, the web server and the Ticker and timer1 callbacks keep running, and
+ * returns early when an interrupt or a web handler calls wake().
+ * In STA mode the WiFi sleep type is light sleep when the caller allows it (nothing on a timer), otherwise
+ * modem sleep. The AP mode cannot sleep.
+ * The waiting time is measured: /idle shows the active and idle time and the duty cycle of the loop since
+ * the boot and in the last IDLEWINDOW ms.
+ */
+
+#ifndef TicklessIdle_h
+#define TicklessIdle_h
+
+#include <ESP8266WiFi.h>
+#include "Features.h"
+#include "TextUtil.h"
+
+#define IDLEMAX 10000       // ms, longest single sleep
+#define IDLEWINDOW 60000    // ms
+
+class TicklessIdle
+{
+  public:
+    void sleep(uint32_t ms, bool lightSleep);
+    void wake();
+    void report(TextSink &out);
+    uint32_t activePermille() const {return _lastActive;}   // of the last complete window
+
+  private:
+    void _setSleepType(WiFiSleepType_t type);
+    void _window(uint32_t now);
+
+    volatile bool _woken=false;
+    WiFiSleepType_t _sleepType=WIFI_NONE_SLEEP;
+    uint64_t _idleUs=0;             // since the boot
+    uint32_t _sleeps=0;
+    uint32_t _wakes=0;              // sleeps ended by wake()
+    uint32_t _windowStart=0;
+    uint32_t _windowIdleUs=0;
+    uint32_t _lastActive=1000;      // per mille of the last complete window
+};
+
+extern TicklessIdle tickless;
+
+#endif
@@ -0,0 +1,274 @@
+#include "TimeZone.h"
+#include "hal/Platform.h"
+
+// POSIX TZ rules with Mm.w.d transitions, evaluated by the compiler only
+
+struct TzRule {
+    int32_t std = 0;        // seconds east of UTC
+    int32_t dst = 0;
+    bool hasDst = false;
+    uint8_t month[2] = {};  // start, end of DST
+    uint8_t week[2] = {};   // 5 is the last
+    uint8_t day[2] = {};    // 0 Sunday
+    int32_t time[2] = { 7200, 7200 };   // local seconds after midnight
+    bool valid = true;
+};
+
+struct TzTable {
+    uint32_t t[TZTRANSITIONS] = {};
+    int32_t std = 0;
+    int32_t dst = 0;
+    bool hasDst = false;
+    bool dstFirst = true;
+    bool valid = true;
+};
+
+static constexpr bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static constexpr const char *skipName(const char *s, bool &ok) {
+    if(*s == '<') {
+        while(*s && *s != '>')
+            s++;
+        if(*s != '>')
+            ok = false;
+        return *s ? s + 1 : s;
+    }
+
+    const char *begin = s;
+    while((*s >= 'A' && *s <= 'Z') || (*s >= 'a' && *s <= 'z'))
+        s++;
+    if(s - begin < 3)
+        ok = false;
+    return s;
+}
+
+static constexpr const char *parseNumber(const char *s, int32_t &v, bool &ok) {
+    if(!isDigit(*s))
+        ok = false;
+    v = 0;
+    while(isDigit(*s))
+        v = v * 10 + (*s++ - '0');
+    return s;
+}
+
+// [+-]hh[:mm[:ss]]
+static constexpr const char *parseTime(const char *s, int32_t &v, bool &ok) {
+    int32_t sign = 1;
+    if(*s == '+' || *s == '-')
+        sign = *s++ == '-' ? -1 : 1;
+
+    int32_t h = 0, m = 0, sec = 0;
+    s = parseNumber(s, h, ok);
+    if(*s == ':')
+        s = parseNumber(s + 1, m, ok);
+    if(*s == ':')
+        s = parseNumber(s + 1, sec, ok);
+    v = sign * (h * 3600 + m * 60 + sec);
+    return s;
+}
+
+static constexpr TzRule parseRule(const char *s) {
+    TzRule r;
+    bool ok = true;
+    int32_t v = 0;
+
+    s = skipName(s, ok);
+    s = parseTime(s, v, ok);
+    r.std = -v;             // POSIX counts west of UTC
+    r.dst = r.std;
+
+    if(*s) {
+        r.hasDst = true;
+        s = skipName(s, ok);
+        r.dst = r.std + 3600;
+        if(*s && *s != ',') {
+            s = parseTime(s, v, ok);
+            r.dst = -v;
+        }
+
+        for(int i = 0; i < 2; i++) {
+            if(s[0] != ',' || s[1] != 'M') {
+                ok = false;
+                break;
+            }
+            s = parseNumber(s + 2, v, ok);
+            r.month[i] = v;
+            if(*s++ != '.')
+                ok = false;
+            s = parseNumber(s, v, ok);
+            r.week[i] = v;
+            if(*s++ != '.')
+                ok = false;
+            s = parseNumber(s, v, ok);
+            r.day[i] = v;
+            if(*s == '/')
+                s = parseTime(s + 1, r.time[i], ok);
+            if(r.month[i] < 1 || r.month[i] > 12 || r.week[i] < 1 || r.week[i] > 5 || r.day[i] > 6)
+                ok = false;
+        }
+    }
+
+    r.valid = ok && *s == 0;
+    return r;
+}
+
+// days since 1.1.1970 of a date of the Gregorian calendar
+static constexpr int32_t daysFromCivil(int32_t y, int32_t m, int32_t d) {
+    y -= m <= 2;
+    int32_t era = y / 400;
+    int32_t yoe = y - era * 400;
+    int32_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    int32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+// UTC of the start (i = 0, given in standard time) or the end (i = 1, in DST) in year
+static constexpr uint32_t transition(const TzRule &r, int i, int32_t year) {
+    int32_t first = daysFromCivil(year, r.month[i], 1);
+    int32_t days = r.month[i] == 12 ? 31 : daysFromCivil(year, r.month[i] + 1, 1) - first;
+    int32_t weekday = (first + 4) % 7;      // 1.1.1970 was a Thursday
+    int32_t day = (r.day[i] - weekday + 7) % 7 + (r.week[i] - 1) * 7;
+    while(day >= days)
+        day -= 7;
+
+    int64_t local = (int64_t)(first + day) * 86400 + r.time[i];
+    return local - (i == 0 ? r.std : r.dst);
+}
+
+static constexpr TzTable makeTable(const char *rule) {
+    TzTable tab;
+    TzRule r = parseRule(rule);
+    tab.valid = r.valid;
+    tab.std = r.std;
+    tab.dst = r.dst;
+    tab.hasDst = r.hasDst;
+    if(!r.hasDst || !r.valid)
+        return tab;
+
+    for(int y = 0; y < TZYEARS; y++) {
+        uint32_t start = transition(r, 0, TZFIRSTYEAR + y);
+        uint32_t end = transition(r, 1, TZFIRSTYEAR + y);
+        tab.dstFirst = start < end;
+        tab.t[2 * y] = tab.dstFirst ? start : end;
+        tab.t[2 * y + 1] = tab.dstFirst ? end : start;
+    }
+    return tab;
+}
+
+#define TZ(id, rule) \
+    static constexpr TzTable id PROGMEM = makeTable(rule); \
+    static_assert(id.valid, "invalid TZ rule " rule);
+
+#define ZONE(name, id) { name, id##_RULE, id.std, id.dst, id.hasDst ? id.t : nullptr, id.dstFirst }
+
+#define UTC_RULE "UTC0"
+#define NEWYORK_RULE "EST5EDT,M3.2.0,M11.1.0"
+#define CHICAGO_RULE "CST6CDT,M3.2.0,M11.1.0"
+#define DENVER_RULE "MST7MDT,M3.2.0,M11.1.0"
+#define PHOENIX_RULE "MST7"
+#define LOSANGELES_RULE "PST8PDT,M3.2.0,M11.1.0"
+#define MEXICO_RULE "CST6"
+#define SAOPAULO_RULE "<-03>3"
+#define LONDON_RULE "GMT0BST,M3.5.0/1,M10.5.0"
+#define BERLIN_RULE "CET-1CEST,M3.5.0,M10.5.0/3"
+#define HELSINKI_RULE "EET-2EEST,M3.5.0/3,M10.5.0/4"
+#define KOLKATA_RULE "IST-5:30"
+#define TOKYO_RULE "JST-9"
+#define SYDNEY_RULE "AEST-10AEDT,M10.1.0,M4.1.0/3"
+#define AUCKLAND_RULE "NZST-12NZDT,M9.5.0,M4.1.0/3"
+
+TZ(UTC, UTC_RULE)
+TZ(NEWYORK, NEWYORK_RULE)
+TZ(CHICAGO, CHICAGO_RULE)
+TZ(DENVER, DENVER_RULE)
+TZ(PHOENIX, PHOENIX_RULE)
+TZ(LOSANGELES, LOSANGELES_RULE)
+TZ(MEXICO, MEXICO_RULE)
+TZ(SAOPAULO, SAOPAULO_RULE)
+TZ(LONDON, LONDON_RULE)
+TZ(BERLIN, BERLIN_RULE)
+TZ(HELSINKI, HELSINKI_RULE)
+TZ(KOLKATA, KOLKATA_RULE)
+TZ(TOKYO, TOKYO_RULE)
+TZ(SYDNEY, SYDNEY_RULE)
+TZ(AUCKLAND, AUCKLAND_RULE)
+
+const TzZone TZZONES[] = {
+    ZONE("UTC", UTC),
+    ZONE("America/New_York", NEWYORK),
+    ZONE("America/Chicago", CHICAGO),
+    ZONE("America/Denver", DENVER),
+    ZONE("America/Phoenix", PHOENIX),
+    ZONE("America/Los_Angeles", LOSANGELES),
+    ZONE("America/Mexico_City", MEXICO),
+    ZONE("America/Sao_Paulo", SAOPAULO),
+    ZONE("Europe/London", LONDON),
+    ZONE("Europe/Berlin", BERLIN),
+    ZONE("Europe/Helsinki", HELSINKI),
+    ZONE("Asia/Kolkata", KOLKATA),
+    ZONE("Asia/Tokyo", TOKYO),
+    ZONE("Australia/Sydney", SYDNEY),
+    ZONE("Pacific/Auckland", AUCKLAND)
+};
+
+const uint8_t TZZONECOUNT = sizeof(TZZONES) / sizeof(TZZONES[0]);
+
+const TzZone *tzZone(std::string_view name) {
+    for(int i = 0; i < TZZONECOUNT; i++) {
+        if(name == TZZONES[i].name)
+            return &TZZONES[i];
+    }
+    return nullptr;
+}
+
+// the next lookup finds the offset of the new zone
+void TimeZone::select(const TzZone *zone) {
+    _zone = zone;
+    _validSpan = 0;
+}
+
+const TzZone &TimeZone::zone() const {
+    return *_zone;
+}
+
+// seconds east of UTC at the last conversion
+int32_t TimeZone::offset() const {
+    return _offset;
+}
+
+bool TimeZone::dst() const {
+    return _dst;
+}
+
+// UTC of the next transition after the last conversion, 0xffffffff if none
+uint32_t TimeZone::validUntil() const {
+    return _validFrom + _validSpan;
+}
+
+void TimeZone::_lookup(uint32_t utc) {
+    const uint32_t *t = _zone->transitions;
+    if(!t) {
+        _offset = _zone->stdOffset;
+        _dst = false;
+        _validFrom = 0;
+        _validSpan = 0xffffffff;
+        return;
+    }
+
+    // n transitions at or before utc, the state alternates from that of the first one of a year
+    int n = 0, hi = TZTRANSITIONS;
+    while(n < hi) {
+        int mid = (n + hi) / 2;
+        if(pgm_read_dword(t + mid) <= utc)
+            n = mid + 1;
+        else
+            hi = mid;
+    }
+
+    _dst = n == 0 ? !_zone->dstFirst : ((n - 1) % 2 == 0) == _zone->dstFirst;
+    _offset = _dst ? _zone->dstOffset : _zone->stdOffset;
+    _validFrom = n == 0 ? 0 : pgm_read_dword(t + n - 1);
+    _validSpan = (n == TZTRANSITIONS ? 0xffffffff : pgm_read_dword(t + n)) - _validFrom;
+}
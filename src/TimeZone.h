@@ -0,0 +1,60 @@
+/* Time zones
+ *
+ * Each zone of TZZONES is a POSIX TZ rule ("CET-1CEST,M3.5.0,M10.5.0/3") that is turned into a table of
+ * its DST transitions at compile time, for the years TZFIRSTYEAR to TZFIRSTYEAR+TZYEARS-1 (UTC instants
+ * in flash, two per year). Before the first and after the last transition the offset next to it holds.
+ * TimeZone::toLocal() keeps the offset and the interval it is valid for, so a conversion is a compare and
+ * an add; the table is searched only when a transition is crossed or the zone changes.
+ */
+
+#ifndef TimeZone_h
+#define TimeZone_h
+
+#include <stdint.h>
+#include <string_view>
+
+#define TZFIRSTYEAR 2024
+#define TZYEARS 32
+#define TZTRANSITIONS (2 * TZYEARS)
+#define TZDEFAULT "America/Chicago"
+
+struct TzZone {
+    const char *name;
+    const char *rule;               // POSIX TZ the table was made from
+    int32_t stdOffset;              // seconds east of UTC
+    int32_t dstOffset;
+    const uint32_t *transitions;    // TZTRANSITIONS in PROGMEM, ascending, nullptr without DST
+    bool dstFirst;                  // the first transition of a year starts DST (northern hemisphere)
+};
+
+extern const TzZone TZZONES[];
+extern const uint8_t TZZONECOUNT;
+
+// nullptr if unknown
+const TzZone *tzZone(std::string_view name);
+
+class TimeZone {
+    public:
+        void select(const TzZone *zone);
+        const TzZone &zone() const;
+        int32_t offset() const;
+        bool dst() const;
+        uint32_t validUntil() const;
+
+        uint32_t toLocal(uint32_t utc) {
+            if(utc - _validFrom >= _validSpan)
+                _lookup(utc);
+            return utc + _offset;
+        }
+
+    private:
+        void _lookup(uint32_t utc);
+
+        const TzZone *_zone = &TZZONES[0];
+        int32_t _offset = 0;
+        bool _dst = false;
+        uint32_t _validFrom = 0;    // UTC, the offset holds from here
+        uint32_t _validSpan = 0;    // seconds, 0 until the first lookup
+};
+
+#endif
@@ -0,0 +1,308 @@
+/* Host micro-benchmarks of the firmware's hot paths
+ *
+ *   program [--filter text] [--time ms] [--json]
+ *
+ * Each benchmark runs in batches of doubling size until a batch takes --time ms (200),
+ * the last batch is reported as ns/op, heap allocations/op and allocated bytes/op.
+ * --json prints one JSON object per line for comparing runs, e.g. with jq or a spreadsheet.
+ *
+ * Allocations are counted by wrapping malloc, calloc and realloc (glibc), which also covers new.
+ * Host times only compare runs with each other, they are not ESP8266 times.
+ */
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../TextUtil.h"
+#include "../Pages.h"
+#include "../ClockCore.h"
+#include "../ClockApi.h"
+#include "../hal/HalLinux.h"
+#include "../sim/SimHal.h"
+#include "../hal/ToneSequencer.h"
+#include "../BuzzerPatterns.h"
+#include "../hal/LedSequencer.h"
+#include "../LedPatterns.h"
+#include "../hal/ButtonDecoder.h"
+#include "../ClockTimer.h"
+
+//-----------------------------------------------  allocation counter ------------------------------------------------------------------------
+
+extern "C" void *__libc_malloc(size_t n);
+extern "C" void *__libc_calloc(size_t n, size_t size);
+extern "C" void *__libc_realloc(void *p, size_t n);
+
+static uint64_t allocs = 0;
+static uint64_t allocBytes = 0;
+
+extern "C" void *malloc(size_t n) {
+  allocs++;
+  allocBytes += n;
+  return __libc_malloc(n);
+}
+
+extern "C" void *calloc(size_t n, size_t size) {
+  allocs++;
+  allocBytes += n * size;
+  return __libc_calloc(n, size);
+}
+
+extern "C" void *realloc(void *p, size_t n) {
+  allocs++;
+  allocBytes += n;
+  return __libc_realloc(p, n);
+}
+
+//-----------------------------------------------  harness ------------------------------------------------------------------------
+
+template<typename T> static inline void keep(T &v) {
+  asm volatile("" : : "g"(&v) : "memory");
+}
+
+static const char *filter = nullptr;
+static uint32_t minTimeMs = 200;
+static bool json = false;
+
+template<typename F> static void bench(const char *name, F fn) {
+  if (filter && !strstr(name, filter)) return;
+
+  fn();   // warm up
+  uint64_t n = 1;
+  while (true) {
+    uint64_t a0 = allocs, b0 = allocBytes;
+    auto t0 = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < n; i++) fn();
+    auto t1 = std::chrono::steady_clock::now();
+    uint64_t a = allocs - a0, b = allocBytes - b0;
+    double ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+
+    if (ns >= minTimeMs * 1e6 || n >= (1ULL << 40)) {
+      if (json)
+        printf("{\"name\":\"%s\",\"iterations\":%llu,\"ns_per_op\":%.2f,\"allocs_per_op\":%.3f,\"bytes_per_op\":%.1f}\n",
+          name, (unsigned long long)n, ns / n, (double)a / n, (double)b / n);
+      else
+        printf("%-28s %12llu %12.2f ns/op %8.3f allocs/op %10.1f B/op\n", name, (unsigned long long)n, ns / n,
+          (double)a / n, (double)b / n);
+      return;
+    }
+    n *= 2;
+  }
+}
+
+//-----------------------------------------------  inputs ------------------------------------------------------------------------
+
+// a typical 'config' file as written by BasicESP8266::saveConfig
+static const char CONFIG[] =
+  "ssid=HomeNetwork-5G\n"
+  "pwd=correct horse battery staple\n"
+  "adr=192.168.1.50\n"
+  "gateway=192.168.1.1\n"
+  "mask=255.255.255.0\n";
+
+static const char LISTING[] =
+  "<b>index.html</b> 4211 bytes\n"
+  "clockconfig.json 84 bytes\n"
+  "config 112 bytes\n"
+  "script & style <v2> \"min\".js 20480 bytes\n";
+
+class NullSink : public TextSink {
+  public:
+    void write(const char *s, size_t len) override {
+      n += len;
+      keep(n);
+    }
+    size_t n = 0;
+};
+
+// keeps the body of the last answer, for the endpoint benchmarks and their check
+class BodyResponse : public HttpResponse {
+  public:
+    void begin(int s, const char *contentType) override {
+      status = s;
+      body.clear();
+    }
+    void header(const char *name, const char *value) override {}
+    void stream(int s, const char *contentType, HttpFiller fill) override {
+      status = s;
+      body.clear();
+    }
+    void write(const char *s, size_t len) override { body.append(s, len); }
+    int status = 0;
+    std::string body;
+};
+
+int main(int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--json")) json = true;
+    else if (!strcmp(argv[i], "--filter") && i + 1 < argc) filter = argv[++i];
+    else if (!strcmp(argv[i], "--time") && i + 1 < argc) minTimeMs = atoi(argv[++i]);
+    else {
+      fprintf(stderr, "usage: %s [--filter text] [--time ms] [--json]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  // BasicESP8266::_setConfig: five getInitValue calls on the config file
+  bench("config/setConfig", [] {
+    static const char *const KEYS[] = { "ssid", "pwd", "adr", "gateway", "mask" };
+    char val[81];
+    for (const char *key : KEYS) {
+      copyText(iniValue(CONFIG, key), val, sizeof(val));
+      keep(val);
+    }
+  });
+
+  bench("config/getInitValue-miss", [] {
+    char val[81];
+    copyText(iniValue(CONFIG, "broker"), val, sizeof(val));
+    keep(val);
+  });
+
+  bench("html/htmlMask-citation", [] {
+    char buf[1024];
+    BufferSink out(buf, sizeof(buf));
+    htmlPage(out, LISTING, true, "Files");
+    keep(buf);
+  });
+
+  bench("html/escape-plain", [] {
+    NullSink out;
+    htmlEscape(out, CONFIG);
+  });
+
+  // /dump: one 32 byte line, hex and ascii
+  bench("dump/hexDumpLine", [] {
+    static uint8_t data[32];
+    static uint32_t pos = 0;
+    char buf[256];
+    BufferSink out(buf, sizeof(buf));
+    data[pos % 32] = pos;
+    hexDumpLine(out, pos, data, sizeof(data), true);
+    pos += 32;
+    keep(buf);
+  });
+
+  // /info: chip info and WiFi form templates
+  bench("info/renderTemplate", [] {
+    NullSink out;
+    renderTemplate(out, CHIPINFO, [](TextSink &o, std::string_view name) {
+      o.print((uint32_t)1048576);
+    });
+    renderTemplate(out, WIFIHTML, [](TextSink &o, std::string_view name) {
+      if (name == "ssid") htmlEscape(o, "HomeNetwork-5G");
+      else if (name == "pwd") o.print("*****");
+      else if (name == "updateinterval") o.print((uint32_t)1800000);
+      else o.print("192.168.1.1");
+    });
+  });
+
+  SimWorld world;
+  world.startEpoch = 1767225600;
+  SimClock clock(world);
+  SimTimeSync timeSync(world, 1800000);
+  SimDisplay display(world);
+  SimButton button;
+  SimBuzzer buzzer(world);
+  SimGpio gpio;
+  MemKeyValueStore kv;
+  MemFileStore files;
+  NullUdpPort udp;
+  Hal hal{clock, timeSync, display, button, buzzer, gpio, kv, files, udp};
+  ClockCore core(hal);
+  core.begin();
+
+  // /clockconfig GET and POST
+  bench("json/serialize-clockconfig", [&] {
+    char buf[256];
+    size_t n = serializeJson(core.config(), buf, sizeof(buf));
+    keep(n);
+  });
+
+  bench("json/deserialize-clockconfig", [] {
+    static const char body[] = "{\"brightness\":5,\"blink\":true,\"alarms\":[{\"time\":715,\"days\":62,\"active\":true,\"once\":false}],\"snooze\":9,\"twelvehours\":false}";
+    JsonDocument doc;
+    DeserializationError err = deserializeJson(doc, body, sizeof(body) - 1);
+    keep(err);
+  });
+
+  // /alarm/status, whose answer is checked once first: timing a wrong one would say nothing
+  ClockApi api(core);
+  HostHttpRequest alarmReq(HttpMethod::Get, "/alarm/status", std::string_view());
+  BodyResponse alarmRes;
+  api.alarm(alarmReq, alarmRes);
+  JsonDocument alarmDoc;
+  if (alarmRes.status != 200 || deserializeJson(alarmDoc, alarmRes.body) || !alarmDoc["alarmon"].is<bool>() ||
+      !alarmDoc["counters"].is<JsonObject>()) {
+    fprintf(stderr, "/alarm/status answered %d %s\n", alarmRes.status, alarmRes.body.c_str());
+    return 1;
+  }
+  bench("api/alarm-status", [&] {
+    api.alarm(alarmReq, alarmRes);
+    keep(alarmRes.body);
+  });
+
+  bench("display/encodeDigit", [] {
+    static uint32_t t = 0;
+    uint8_t data[4];
+    int hours = (t % 86400) / 3600;
+    int minutes = (t % 3600) / 60;
+    data[0] = hours >= 10 ? ClockCore::encodeDigit(hours / 10) : 0;
+    data[1] = ClockCore::encodeDigit(hours % 10) | ClockCore::SEG_COLON;
+    data[2] = ClockCore::encodeDigit(minutes / 10);
+    data[3] = ClockCore::encodeDigit(minutes % 10);
+    t += 61;
+    keep(data);
+  });
+
+  // one 500 ms display tick of the clock, including the minute and NTP checks
+  bench("display/tick", [&] {
+    world.trueMs += 500;
+    core.tick();
+    world.events.clear();
+  });
+
+  // one call of the buzzer timer interrupt, a tone with envelope
+  ToneSequencer tone;
+  tone.start(buzzerPattern("gentle"));
+  bench("buzzer/next-edge", [&] {
+    bool level;
+    uint32_t us = tone.next(level);
+    keep(us);
+  });
+
+  // one LED timer callback with a queue of three patterns
+  LedSequencer led;
+  led.play(&LED_APMODE, LEDSTATE);
+  led.play(&LED_NTPFAIL, LEDFAULT);
+  led.code(3, LEDFAULT);
+  bench("led/next-step", [&] {
+    bool level;
+    uint32_t ms = led.next(level);
+    keep(ms);
+  });
+
+  // the two button interrupts of a long press and the poll that takes the event
+  ButtonDecoder buttonDecoder;
+  uint32_t buttonMs = 0;
+  bench("button/press+poll", [&] {
+    buttonDecoder.edge(buttonMs += 1000, true);
+    buttonDecoder.edge(buttonMs += 1000, false);
+    ButtonEvent e = buttonDecoder.poll(buttonMs);
+    keep(e);
+  });
+
+  // what a running countdown costs the loop per display change: the shown value and the time to the next one
+  ClockTimer timer;
+  uint32_t timerMs = 0;
+  timer.countdown(TIMERMAX, timerMs);
+  bench("timer/shown+untilChange", [&] {
+    uint32_t unit;
+    uint32_t value = timer.shown(timerMs += 7, unit);
+    uint32_t in = timer.untilChange(timerMs);
+    keep(value);
+    keep(in);
+  });
+
+  return 0;
+}
@@ -0,0 +1,584 @@
+#include "EmuServer.h"
+#include <algorithm>
+#include <chrono>
+#include <errno.h>
+#include <fcntl.h>
+#include <malloc.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strings.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include "../hal/HalLinux.h"
+
+//-----------------------------------------------  handler heap ------------------------------------------------------------------------
+
+// glibc malloc family wrapped to measure what a handler allocates while it runs
+extern "C" void *__libc_malloc(size_t n);
+extern "C" void *__libc_calloc(size_t n, size_t size);
+extern "C" void *__libc_realloc(void *p, size_t n);
+extern "C" void __libc_free(void *p);
+
+static bool tracking=false;
+static int64_t trackLive=0;
+static int64_t trackPeak=0;
+
+static void track(int64_t delta)
+{
+  if (!tracking) return;
+  trackLive+=delta;
+  if (trackLive>trackPeak) trackPeak=trackLive;
+}
+
+extern "C" void *malloc(size_t n)
+{
+  void *p=__libc_malloc(n);
+  if (p) track(malloc_usable_size(p));
+  return p;
+}
+
+extern "C" void *calloc(size_t n, size_t size)
+{
+  void *p=__libc_calloc(n, size);
+  if (p) track(malloc_usable_size(p));
+  return p;
+}
+
+extern "C" void *realloc(void *p, size_t n)
+{
+  int64_t old=p?malloc_usable_size(p):0;
+  void *q=__libc_realloc(p, n);
+  if (q) track((int64_t)malloc_usable_size(q)-old);
+  return q;
+}
+
+extern "C" void free(void *p)
+{
+  if (p) track(-(int64_t)malloc_usable_size(p));
+  __libc_free(p);
+}
+
+static uint64_t nowUs()
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//-----------------------------------------------  connections ------------------------------------------------------------------------
+
+struct EmuServer::Route
+{
+  std::string uri;
+  unsigned methods;
+  HttpHandler handler;
+  HttpUploadHandler upload;
+  int admit=-1;                 // route of the admission
+  EmuRouteStats stats;
+
+  bool matches(std::string_view path)
+  {
+    if (!uri.empty() && uri.back()=='*') return path.substr(0, uri.size()-1)==std::string_view(uri).substr(0, uri.size()-1);
+    return path==uri;
+  }
+};
+
+struct EmuServer::Conn
+{
+  int fd;
+  std::string in;
+  std::string out;
+  size_t outPos=0;
+  uint32_t charged=0;           // heap held by this connection
+  uint64_t started=0;           // first byte of the current request
+  EmuRouteStats *stats=nullptr;
+  HttpFiller filler;
+  size_t fillIndex=0;
+  bool streaming=false;
+  bool responding=false;
+  bool close=false;
+  enum {ADMIT, WAITING, RUN, REJECT} admission=ADMIT;    // of the current request
+};
+
+class EmuResponse : public HttpResponse
+{
+  public:
+    EmuResponse(EmuServer &server, EmuServer::Conn &conn) : _server(server), _conn(conn) {}
+
+    void begin(int status, const char *contentType) override
+    {
+      _status=status;
+      _type=contentType;
+    }
+
+    void header(const char *name, const char *value) override
+    {
+      _headers+=name;
+      _headers+=": ";
+      _headers+=value;
+      _headers+="\r\n";
+    }
+
+    void write(const char *s, size_t len) override
+    {
+      if (_status==0 || cut) return;
+      if (!_server._charge(len))
+      {
+        cut=true;
+        return;
+      }
+      _conn.charged+=len;
+      bool t=tracking;
+      tracking=false;      // charged above, not handler heap
+      _body.append(s, len);
+      tracking=t;
+    }
+
+    void stream(int status, const char *contentType, HttpFiller fill) override
+    {
+      begin(status, contentType);
+      _fill=fill;
+    }
+
+    // status line, headers and the written body into the output of the connection
+    void finish(bool keepAlive)
+    {
+      char head[160];
+      if (_status==0)
+      {
+        _status=500;
+        _type="text/plain";
+        _body.clear();
+      }
+      snprintf(head, sizeof(head), "HTTP/1.1 %d %s\r\nContent-Type: %s\r\n", _status, reason(_status), _type.c_str());
+      _conn.out+=head;
+      _conn.out+=_headers;
+      if (_fill)
+      {
+        _conn.out+="Transfer-Encoding: chunked\r\n";
+        _conn.filler=_fill;
+        _conn.fillIndex=0;
+        _conn.streaming=true;
+      }
+      else
+      {
+        snprintf(head, sizeof(head), "Content-Length: %u\r\n", (unsigned)_body.size());
+        _conn.out+=head;
+      }
+      _conn.out+=keepAlive?"Connection: keep-alive\r\n\r\n":"Connection: close\r\n\r\n";
+      _conn.out+=_body;
+    }
+
+    static const char *reason(int status)
+    {
+      switch (status)
+      {
+        case 200: return "OK";
+        case 304: return "Not Modified";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 409: return "Conflict";
+        case 413: return "Payload Too Large";
+        case 431: return "Request Header Fields Too Large";
+        case 503: return "Service Unavailable";
+        default: return status<400?"OK":"Error";
+      }
+    }
+
+    bool cut=false;
+
+  private:
+    EmuServer &_server;
+    EmuServer::Conn &_conn;
+    int _status=0;
+    std::string _type;
+    std::string _headers;
+    std::string _body;
+    HttpFiller _fill;
+};
+
+EmuServer::EmuServer(const EmuLimits &limits)
+  : admission([this]() -> uint32_t {return _limits.heap-_heapUsed;}), _limits(limits)
+{
+  _notFound.name="(not found)";
+}
+
+EmuServer::~EmuServer()
+{
+  while (!_conns.empty()) _close(_conns.size()-1);
+  if (_listen>=0) ::close(_listen);
+}
+
+bool EmuServer::begin(uint16_t port)
+{
+  _listen=socket(AF_INET, SOCK_STREAM, 0);
+  if (_listen<0) return false;
+  int on=1;
+  setsockopt(_listen, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  sockaddr_in a={};
+  a.sin_family=AF_INET;
+  a.sin_port=htons(port);
+  a.sin_addr.s_addr=htonl(INADDR_ANY);
+  if (bind(_listen, (sockaddr *)&a, sizeof(a))!=0 || listen(_listen, 128)!=0) return false;
+  fcntl(_listen, F_SETFL, fcntl(_listen, F_GETFL)|O_NONBLOCK);
+  return true;
+}
+
+void EmuServer::on(const char *uri, unsigned methods, HttpHandler handler, const HttpBudget &budget)
+{
+  Route r;
+  r.uri=uri;
+  r.methods=methods;
+  r.handler=handler;
+  r.stats.name=uri;
+  r.admit=_limits.admission?admission.route(uri, budget):-1;
+  _routes.push_back(r);
+}
+
+void EmuServer::onUpload(const char *uri, HttpUploadHandler handler, const HttpBudget &budget)
+{
+  Route r;
+  r.uri=uri;
+  r.methods=method(HttpMethod::Post);
+  r.upload=handler;
+  r.stats.name=uri;
+  r.admit=_limits.admission?admission.route(uri, budget):-1;
+  _routes.push_back(r);
+}
+
+bool EmuServer::_charge(uint32_t n)
+{
+  if (_heapUsed+n>_limits.heap)
+  {
+    _heapFailures++;
+    return false;
+  }
+  _heapUsed+=n;
+  if (_heapUsed>_heapPeak) _heapPeak=_heapUsed;
+  return true;
+}
+
+void EmuServer::_release(uint32_t n)
+{
+  _heapUsed-=n;
+}
+
+void EmuServer::run(void (*idle)(void *ctx), void *ctx, uint32_t idleMs, volatile bool &stop)
+{
+  uint64_t nextIdle=nowUs();
+  std::vector<pollfd> fds;
+  while (!stop)
+  {
+    uint64_t t=nowUs();
+    if (t>=nextIdle)
+    {
+      idle(ctx);
+      nextIdle=t+idleMs*1000ULL;
+    }
+    admission.poll(t/1000, [this](void *c, int route, bool admitted) {_admitted((Conn *)c, admitted);});
+
+    fds.clear();
+    fds.push_back({_listen, POLLIN, 0});
+    for (Conn *c : _conns)
+    {
+      short ev=c->responding?0:POLLIN;
+      if (c->outPos<c->out.size() || c->streaming) ev|=POLLOUT;
+      fds.push_back({c->fd, ev, 0});
+    }
+    int timeout=(int)((nextIdle-std::min(nextIdle, nowUs()))/1000);
+    if (poll(fds.data(), fds.size(), timeout)<=0) continue;
+
+    if (fds[0].revents&POLLIN) _accept();
+    // from the back, so closing keeps the earlier indices valid
+    for (size_t i=fds.size()-1;i>=1;i--)
+    {
+      Conn &c=*_conns[i-1];
+      bool ok=true;
+      if (fds[i].revents&(POLLERR|POLLHUP|POLLNVAL) && !(fds[i].revents&POLLIN)) ok=false;
+      if (ok && fds[i].revents&POLLIN) ok=_read(c);
+      if (ok && fds[i].revents&POLLOUT) ok=_write(c);
+      if (!ok) _close(i-1);
+    }
+  }
+}
+
+void EmuServer::_accept()
+{
+  while (true)
+  {
+    int fd=accept(_listen, nullptr, nullptr);
+    if (fd<0) return;
+    if ((int)_conns.size()>=_limits.maxConn || !_charge(_limits.connCost))
+    {
+      _refused++;
+      ::close(fd);
+      continue;
+    }
+    _accepted++;
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL)|O_NONBLOCK);
+    int on=1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    Conn *c=new Conn();
+    c->fd=fd;
+    c->charged=_limits.connCost;
+    _conns.push_back(c);
+  }
+}
+
+bool EmuServer::_read(Conn &c)
+{
+  char buf[4096];
+  ssize_t n=recv(c.fd, buf, sizeof(buf), 0);
+  if (n==0) return false;
+  if (n<0) return errno==EAGAIN || errno==EWOULDBLOCK;
+  if (c.in.empty()) c.started=nowUs();
+  c.in.append(buf, n);
+  return _handle(c);
+}
+
+static std::string_view headerValue(std::string_view head, const char *name)
+{
+  std::string_view v;
+  HostHttpRequest(HttpMethod::Other, std::string_view(), std::string_view(), head).header(name, v);
+  return v;
+}
+
+// runs the handler once the request is complete
+bool EmuServer::_handle(Conn &c)
+{
+  size_t headEnd=c.in.find("\r\n\r\n");
+  if (headEnd==std::string::npos) return c.in.size()<4096;
+  std::string_view head(c.in.data(), headEnd+2);
+  size_t bodyLen=strtoul(std::string(headerValue(head, "Content-Length")).c_str(), nullptr, 10);
+  if (c.in.size()<headEnd+4+bodyLen)
+  {
+    return bodyLen<=1024*1024;
+  }
+
+  std::string_view line=head.substr(0, head.find("\r\n"));
+  size_t s1=line.find(' ');
+  size_t s2=line.find(' ', s1+1);
+  if (s1==std::string_view::npos || s2==std::string_view::npos) return false;
+  std::string_view target=line.substr(s1+1, s2-s1-1);
+  std::string_view body(c.in.data()+headEnd+4, bodyLen);
+  std::string_view connection=headerValue(head, "Connection");
+  c.close=!_limits.keepAlive || connection=="close";
+  c.responding=true;
+
+  HttpMethod m=HostHttpRequest::parseMethod(line.substr(0, s1));
+  std::string_view path=target.substr(0, target.find('?'));
+  Route *route=nullptr;
+  for (Route &r : _routes) if ((r.methods&method(m)) && r.matches(path))
+  {
+    route=&r;
+    break;
+  }
+  c.stats=route?&route->stats:&_notFound;
+
+  if (route && c.admission==Conn::ADMIT)
+  {
+    switch (admission.admit(route->admit, &c, nowUs()/1000, route->handler!=nullptr))
+    {
+      case HttpAdmit::Run: c.admission=Conn::RUN; break;
+      case HttpAdmit::Wait: c.admission=Conn::WAITING; return true;
+      case HttpAdmit::Reject: c.admission=Conn::REJECT; break;
+    }
+  }
+
+  EmuResponse res(*this, c);
+  uint32_t charge=head.size()+(route && route->handler && bodyLen>0 && bodyLen<=HTTPBODYMAX?bodyLen+1:0);
+  if (!_charge(charge))
+  {
+    c.stats->heapFailures++;
+    return false;
+  }
+  c.charged+=charge;
+
+  trackLive=0;
+  trackPeak=0;
+  tracking=true;
+  if (!route)
+  {
+    res.begin(404, "text/plain");
+    res.print("Not found");
+  }
+  else if (c.admission==Conn::REJECT) HttpAdmission::reject(res);
+  else if (route->handler)
+  {
+    HostHttpRequest req(m, target, bodyLen<=HTTPBODYMAX?body:std::string_view(), head);
+    route->handler(req, res);
+  }
+  else
+  {
+    // multipart/form-data, the first part with a filename, passed on in TCP segment sized chunks
+    std::string_view type=headerValue(head, "Content-Type");
+    size_t b=type.find("boundary=");
+    std::string delim=b==std::string_view::npos?std::string():"\r\n--"+std::string(type.substr(b+9));
+    size_t fn=body.find("filename=\"");
+    size_t dataStart=body.find("\r\n\r\n", fn);
+    size_t dataEnd=delim.empty() || dataStart==std::string_view::npos?std::string_view::npos:body.find(delim, dataStart);
+    HostHttpRequest req(m, target, std::string_view(), head);
+    if (fn==std::string_view::npos || dataEnd==std::string_view::npos)
+    {
+      res.begin(400, "text/plain");
+      res.print("no file");
+    }
+    else if (!_charge(TCPSEGMENT))
+    {
+      c.stats->heapFailures++;
+      tracking=false;
+      return false;
+    }
+    else
+    {
+      std::string_view name=body.substr(fn+10, body.find('"', fn+10)-fn-10);
+      std::string_view data=body.substr(dataStart+4, dataEnd-dataStart-4);
+      size_t index=0;
+      do
+      {
+        size_t n=std::min(data.size()-index, (size_t)TCPSEGMENT);
+        bool final=index+n>=data.size();
+        route->upload(req, name, index, (const uint8_t *)data.data()+index, n, final, final?&res:nullptr);
+        index+=n;
+      } while (index<data.size());
+      _release(TCPSEGMENT);
+    }
+  }
+  tracking=false;
+  if (trackPeak>c.stats->handlerHeapPeak) c.stats->handlerHeapPeak=trackPeak;
+  if (_heapUsed+trackPeak>_limits.heap)
+  {
+    _heapFailures++;
+    c.stats->heapFailures++;
+  }
+  if (res.cut) c.stats->heapFailures++;
+
+  res.finish(!c.close);
+  c.in.erase(0, headEnd+4+bodyLen);
+  if (c.streaming)
+  {
+    if (!_charge(_limits.chunkBuf))
+    {
+      c.stats->heapFailures++;
+      return false;
+    }
+    c.charged+=_limits.chunkBuf;
+  }
+  return _write(c);
+}
+
+bool EmuServer::_write(Conn &c)
+{
+  while (true)
+  {
+    if (c.outPos<c.out.size())
+    {
+      ssize_t n=send(c.fd, c.out.data()+c.outPos, c.out.size()-c.outPos, MSG_NOSIGNAL);
+      if (n<0) return errno==EAGAIN || errno==EWOULDBLOCK;
+      c.stats->bytes+=n;
+      c.outPos+=n;
+      if (c.outPos<c.out.size()) return true;
+    }
+    c.out.clear();
+    c.outPos=0;
+
+    if (!c.streaming) break;
+    // the next chunk, like AsyncChunkedResponse when the socket has room
+    std::vector<uint8_t> buf(_limits.chunkBuf-16);
+    size_t n=c.filler(buf.data(), buf.size(), c.fillIndex);
+    char size[16];
+    snprintf(size, sizeof(size), "%zx\r\n", n);
+    c.out+=size;
+    c.out.append((const char *)buf.data(), n);
+    c.out+="\r\n";
+    c.fillIndex+=n;
+    if (n==0) c.streaming=false;
+  }
+
+  if (c.responding)
+  {
+    _finish(c);
+    if (c.close) return false;
+    if (!c.in.empty()) return _handle(c);
+  }
+  return true;
+}
+
+// response sent, the latency and heap of the request are settled
+void EmuServer::_finish(Conn &c)
+{
+  c.stats->requests++;
+  c.stats->latencyUs.push_back(nowUs()-c.started);
+  c.responding=false;
+  c.filler=nullptr;
+  admission.finish(&c);
+  c.admission=Conn::ADMIT;
+  _release(c.charged-_limits.connCost);
+  c.charged=_limits.connCost;
+  if (!c.in.empty()) c.started=nowUs();
+}
+
+void EmuServer::_close(size_t i)
+{
+  Conn *c=_conns[i];
+  admission.finish(c);
+  _release(c->charged);
+  ::close(c->fd);
+  delete c;
+  _conns.erase(_conns.begin()+i);
+}
+
+// a waiting request runs or is rejected from the event loop
+void EmuServer::_admitted(Conn *c, bool run)
+{
+  c->admission=run?Conn::RUN:Conn::REJECT;
+  if (_handle(*c)) return;
+  for (size_t i=0;i<_conns.size();i++) if (_conns[i]==c)
+  {
+    _close(i);
+    break;
+  }
+}
+
+static uint32_t percentile(std::vector<uint32_t> &v, double p)
+{
+  if (v.empty()) return 0;
+  size_t k=(size_t)(p*(v.size()-1));
+  std::nth_element(v.begin(), v.begin()+k, v.end());
+  return v[k];
+}
+
+void EmuServer::report(TextSink &out, bool json)
+{
+  char line[256];
+  std::vector<EmuRouteStats *> all;
+  for (Route &r : _routes) all.push_back(&r.stats);
+  all.push_back(&_notFound);
+
+  if (json) snprintf(line, sizeof(line), "{\"heap\":{\"cap\":%u,\"used\":%u,\"peak\":%u,\"failures\":%llu},"
+    "\"connections\":{\"open\":%zu,\"accepted\":%llu,\"refused\":%llu},\"routes\":[", _limits.heap, _heapUsed, _heapPeak,
+    (unsigned long long)_heapFailures, _conns.size(), (unsigned long long)_accepted, (unsigned long long)_refused);
+  else snprintf(line, sizeof(line), "heap cap %u used %u peak %u failures %llu, connections open %zu accepted %llu refused %llu\n",
+    _limits.heap, _heapUsed, _heapPeak, (unsigned long long)_heapFailures, _conns.size(), (unsigned long long)_accepted,
+    (unsigned long long)_refused);
+  out.print(line);
+
+  bool first=true;
+  for (EmuRouteStats *s : all)
+  {
+    if (s->requests==0) continue;
+    std::vector<uint32_t> v=s->latencyUs;
+    uint32_t p50=percentile(v, 0.5), p90=percentile(v, 0.9), p99=percentile(v, 0.99), max=percentile(v, 1.0);
+    if (json) snprintf(line, sizeof(line), "%s{\"route\":\"%s\",\"requests\":%llu,\"bytes\":%llu,\"p50_us\":%u,\"p90_us\":%u,"
+      "\"p99_us\":%u,\"max_us\":%u,\"handler_heap_peak\":%u,\"heap_failures\":%llu}", first?"":",", s->name.c_str(),
+      (unsigned long long)s->requests, (unsigned long long)s->bytes, p50, p90, p99, max, s->handlerHeapPeak,
+      (unsigned long long)s->heapFailures);
+    else snprintf(line, sizeof(line), "  %-14s %8llu req  p50 %6u  p90 %6u  p99 %6u  max %7u us  handler heap %6u  heap failures %llu\n",
+      s->name.c_str(), (unsigned long long)s->requests, p50, p90, p99, max, s->handlerHeapPeak,
+      (unsigned long long)s->heapFailures);
+    out.print(line);
+    first=false;
+  }
+  if (json) out.print("]}\n");
+}
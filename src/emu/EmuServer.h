@@ -0,0 +1,95 @@
+/* HTTP server emulating ESPAsyncWebServer on the device
+ *
+ * Single threaded and callback driven like the device: one poll() loop accepts, parses, runs the
+ * handlers of Http.h to completion and writes the responses, idle() runs between the events (loop()).
+ * Like the device it answers with "Connection: close" unless keepAlive is set, written responses get
+ * a Content-Length, streamed ones are sent chunked as the socket takes them.
+ *
+ * Heap model: every connection, request and response buffer is charged against a simulated heap of
+ * limits.heap bytes, like the free heap of the ESP8266 after setup:
+ *   connection       limits.connCost (lwIP pcb, AsyncClient, request object)
+ *   request          header bytes, body+1 (_tempObject) for bodies up to HTTPBODYMAX
+ *   upload           one TCP segment per chunk
+ *   response         written bytes (AsyncResponseStream) or limits.chunkBuf while streaming
+ * A connection that can't be charged is closed at once, a response that can't grow is cut,
+ * both are counted as heap failures. Connections beyond limits.maxConn are closed like a full lwIP pcb pool.
+ * Heap allocated by the handlers themselves (e.g. ArduinoJson) is measured per request as well.
+ *
+ * Unless limits.admission is off, requests pass admission (see HttpAdmission.h) against the free simulated
+ * heap like on the device: waiting ones are run from the event loop after idle(), rejected ones get a 503.
+ */
+
+#ifndef EmuServer_h
+#define EmuServer_h
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "../Http.h"
+#include "../HttpAdmission.h"
+
+#define TCPSEGMENT 1460
+
+struct EmuLimits
+{
+  uint32_t heap=40000;
+  uint32_t connCost=1200;
+  uint32_t chunkBuf=2*TCPSEGMENT;
+  int maxConn=5;
+  bool keepAlive=false;
+  bool admission=true;
+};
+
+struct EmuRouteStats
+{
+  std::string name;
+  uint64_t requests=0;
+  uint64_t bytes=0;
+  uint64_t heapFailures=0;
+  uint32_t handlerHeapPeak=0;      // bytes allocated by the handler itself, highest of all requests
+  std::vector<uint32_t> latencyUs;
+};
+
+class EmuServer
+{
+  public:
+    EmuServer(const EmuLimits &limits);
+    ~EmuServer();
+    bool begin(uint16_t port);
+    void on(const char *uri, unsigned methods, HttpHandler handler, const HttpBudget &budget=HTTPNORMAL);
+    void onUpload(const char *uri, HttpUploadHandler handler, const HttpBudget &budget=HTTPHEAVY);
+    void run(void (*idle)(void *ctx), void *ctx, uint32_t idleMs, volatile bool &stop);
+    void report(TextSink &out, bool json);
+
+    static unsigned method(HttpMethod m) {return 1u<<(int)m;}
+
+    HttpAdmission admission;
+
+  private:
+    struct Route;
+    struct Conn;
+    friend class EmuResponse;
+
+    bool _charge(uint32_t n);
+    void _release(uint32_t n);
+    void _accept();
+    bool _read(Conn &c);
+    bool _handle(Conn &c);
+    bool _write(Conn &c);
+    void _finish(Conn &c);
+    void _close(size_t i);
+    void _admitted(Conn *c, bool run);
+
+    EmuLimits _limits;
+    int _listen=-1;
+    std::vector<Route> _routes;
+    std::vector<Conn *> _conns;
+    EmuRouteStats _notFound;
+    uint32_t _heapUsed=0;
+    uint32_t _heapPeak=0;
+    uint64_t _heapFailures=0;
+    uint64_t _refused=0;
+    uint64_t _accepted=0;
+};
+
+#endif
@@ -0,0 +1,182 @@
+/* HTTP emulator for load tests of the web endpoints
+ *
+ *   program [--port 8080] [--heap bytes] [--conn-cost bytes] [--max-conn n] [--keepalive] [--no-admission] [--root dir]
+ *           [--report s]
+ *
+ * Serves /clock, /alarm/..., /currenttime, /clockconfig, /info, /files, /mem, /dump, /upload and /update with the
+ * handlers of the firmware on a local socket, e.g. for  wrk -t2 -c8 -d30s http://localhost:8080/currenttime
+ * Every --report seconds (10) the latencies and the simulated heap go to stderr, /emu/stats returns them
+ * as JSON, and so does stdout on exit (Ctrl-C). /admission shows the admission control of the routes, with the
+ * budgets of the device; --no-admission runs every request at once. Files live in --root (native_fs), so do the
+ * images of /update (firmware.bin, filesystem.bin), which does not restart.
+ * The clock runs in real time and ticks at the start and middle of every second between the requests, like
+ * loop() on the device.
+ */
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "EmuServer.h"
+#include "../hal/HalLinux.h"
+#include "../ClockCore.h"
+#include "../ClockApi.h"
+#include "../FileApi.h"
+#include "../OtaUpdate.h"
+#include "../Pages.h"
+
+static volatile bool stop = false;
+
+class FileSink : public TextSink {
+  public:
+    FileSink(FILE *out) : _out(out) {}
+    void write(const char *s, size_t len) override {
+      fwrite(s, 1, len, _out);
+    }
+
+  private:
+    FILE *_out;
+};
+
+struct Emulator {
+  ClockCore &core;
+  EmuServer &server;
+  uint32_t reportMs;
+  uint32_t lastReport;
+  ClockSource &clock;
+};
+
+static void idle(void *ctx) {
+  Emulator &emu = *(Emulator *)ctx;
+  emu.core.pollButton();
+  emu.core.pollTimer();
+  if (emu.core.tickDue()) emu.core.tick();
+  if (emu.reportMs && emu.clock.millis() - emu.lastReport >= emu.reportMs) {
+    emu.lastReport = emu.clock.millis();
+    FileSink err(stderr);
+    emu.server.report(err, false);
+  }
+}
+
+int main(int argc, char **argv) {
+  EmuLimits limits;
+  uint16_t port = 8080;
+  const char *root = "native_fs";
+  uint32_t reportS = 10;
+
+  for (int i = 1; i < argc; i++) {
+    const char *o = argv[i];
+    const char *v = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (!strcmp(o, "--keepalive")) limits.keepAlive = true;
+    else if (!strcmp(o, "--no-admission")) limits.admission = false;
+    else if (v && !strcmp(o, "--port")) port = atoi(argv[++i]);
+    else if (v && !strcmp(o, "--heap")) limits.heap = atoi(argv[++i]);
+    else if (v && !strcmp(o, "--conn-cost")) limits.connCost = atoi(argv[++i]);
+    else if (v && !strcmp(o, "--max-conn")) limits.maxConn = atoi(argv[++i]);
+    else if (v && !strcmp(o, "--root")) root = argv[++i];
+    else if (v && !strcmp(o, "--report")) reportS = atoi(argv[++i]);
+    else {
+      fprintf(stderr, "usage: %s [--port n] [--heap bytes] [--conn-cost bytes] [--max-conn n] [--keepalive] [--no-admission] "
+        "[--root dir] [--report s]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  HostClock clock;
+  HostTimeSync timeSync(1800000);
+  TerminalDisplay display(stderr);
+  StdinButton button(false);
+  TerminalBuzzer buzzer(stderr);
+  MemoryGpio gpio;
+  FileKeyValueStore kv("native_fs.eeprom");
+  DirFileStore dir(root);
+  FileIndex files(dir, []() -> uint32_t { return time(nullptr); });
+  files.begin();
+  PosixUdpPort udp;
+  Hal hal{clock, timeSync, display, button, buzzer, gpio, kv, files, udp};
+
+  ClockCore core(hal);
+  ClockApi clockApi(core);
+  FileApi fileApi(files, false);
+  FileFirmwareWriter firmware(root);
+  OtaUpdate ota(firmware, [&clock]() { return clock.millis(); });
+  core.begin();
+
+  fileApi.infoExtra = [&files](TextSink &out) {
+    renderTemplate(out, CHIPINFO, [&files](TextSink &o, std::string_view name) {
+      uint32_t total = 0, used = 0;
+      files.usage(total, used);
+      if (name == "real" || name == "ide") o.print((uint32_t)1048576);
+      else if (name == "mode") o.print("DOUT");
+      else if (name == "total") o.print(total);
+      else if (name == "used") o.print(used);
+      else if (name == "free") o.print(total - used);
+    });
+    renderTemplate(out, WIFIHTML, [](TextSink &o, std::string_view name) {
+      if (name == "ssid") o.print("emulator");
+      else if (name == "pwd") o.print("*****");
+      else if (name == "netmask") o.print("255.255.255.0");
+      else if (name == "updateinterval") o.print((uint32_t)1800000);
+    });
+  };
+
+  EmuServer server(limits);
+  unsigned get = EmuServer::method(HttpMethod::Get);
+
+  server.on("/clock", get, [&](HttpRequest &req, HttpResponse &res) {
+    if (clockApi.clockPage(req, res)) return;
+    if (!files.exists("/index.html")) {
+      res.begin(404, "text/plain");
+      res.print("No index.html file");
+      return;
+    }
+    res.stream(200, "text/html", [&files](uint8_t *buf, size_t maxLen, size_t index) -> size_t {
+      int n = files.read("/index.html", index, (char *)buf, maxLen);
+      return n > 0 ? n : 0;
+    });
+  });
+  server.on("/alarm/*", get, [&](HttpRequest &req, HttpResponse &res) { clockApi.alarm(req, res); }, HTTPLIGHT);
+  server.on("/timer/*", get, [&](HttpRequest &req, HttpResponse &res) { clockApi.timer(req, res); }, HTTPLIGHT);
+  server.on("/currenttime", get, [&](HttpRequest &req, HttpResponse &res) { clockApi.currentTime(req, res); }, HTTPLIGHT);
+  server.on("/timezones", get, [&](HttpRequest &req, HttpResponse &res) { clockApi.timeZones(req, res); });
+  server.on("/clockconfig", get | EmuServer::method(HttpMethod::Post) | EmuServer::method(HttpMethod::Put),
+    [&](HttpRequest &req, HttpResponse &res) { clockApi.clockConfig(req, res); });
+  server.on("/info", get, [&](HttpRequest &req, HttpResponse &res) { fileApi.info(req, res); }, HTTPHEAVY);
+  server.on("/files", get, [&](HttpRequest &req, HttpResponse &res) { fileApi.files(req, res); }, HTTPLIGHT);
+  server.on("/mem", get, [&](HttpRequest &req, HttpResponse &res) { fileApi.mem(req, res); }, HTTPHEAVY);
+  server.on("/dump", get, [&](HttpRequest &req, HttpResponse &res) { fileApi.dump(req, res); },
+    HttpBudget{HttpClass::Heavy, 1, 4000});
+  server.onUpload("/upload", [&](HttpRequest &req, std::string_view filename, size_t index, const uint8_t *data, size_t len,
+    bool final, HttpResponse *res) { fileApi.upload(req, filename, index, data, len, final, res); });
+  server.on("/update", get, [&](HttpRequest &req, HttpResponse &res) { ota.form(req, res); });
+  server.on("/update/status", get, [&](HttpRequest &req, HttpResponse &res) { ota.status(req, res); }, HTTPLIGHT);
+  server.onUpload("/update", [&](HttpRequest &req, std::string_view filename, size_t index, const uint8_t *data, size_t len,
+    bool final, HttpResponse *res) { ota.upload(req, filename, index, data, len, final, res); });
+  server.on("/emu/stats", get, [&server](HttpRequest &req, HttpResponse &res) {
+    res.begin(200, "application/json");
+    server.report(res, true);
+  }, HTTPLIGHT);
+  server.on("/admission", get, [&server](HttpRequest &req, HttpResponse &res) {
+    res.begin(200, "text/plain");
+    server.admission.report(res);
+  }, HTTPLIGHT);
+  server.admission.clockBusy = [&core]() { return core.tickDue(); };
+
+  if (!server.begin(port)) {
+    perror("listen");
+    return 1;
+  }
+  fprintf(stderr, "listening on port %u, heap %u bytes, %d connections\n", port, limits.heap, limits.maxConn);
+
+  signal(SIGINT, [](int) { stop = true; });
+  signal(SIGTERM, [](int) { stop = true; });
+  signal(SIGPIPE, SIG_IGN);
+
+  Emulator emu{core, server, reportS * 1000, clock.millis(), clock};
+  server.run(idle, &emu, 10, stop);
+
+  FileSink out(stdout);
+  server.report(out, true);
+  return 0;
+}
@@ -0,0 +1,71 @@
+#include "ButtonDecoder.h"
+
+// from the interrupt, edges within BUTTONDEBOUNCE ms of the last accepted one are bounces
+void IRAM_ATTR ButtonDecoder::edge(uint32_t ms, bool pressed)
+{
+  if (pressed==_pressed || ms-_edgeMs<BUTTONDEBOUNCE) return;
+  _edgeMs=ms;
+  if (pressed)
+  {
+    _pressMs=ms;
+    _pressed=true;
+    return;
+  }
+  _pressed=false;
+
+  if (ms-_pressMs>=BUTTONLONG)
+  {
+    _clicked=false;
+    _push(BUTTON_LONGPRESS, ms);
+  }
+  else if (_clicked && _pressMs-_clickMs<=BUTTONDOUBLE)
+  {
+    _clicked=false;
+    _push(BUTTON_DOUBLECLICK, ms);
+  }
+  else
+  {
+    _clicked=true;
+    _clickMs=ms;
+    _push(BUTTON_CLICK, ms);
+  }
+}
+
+void IRAM_ATTR ButtonDecoder::_push(ButtonEvent type, uint32_t ms)
+{
+  uint8_t head=_head;
+  if ((uint8_t)(head-_tail)>=BUTTONQUEUE)
+  {
+    _dropped++;
+    return;
+  }
+  _events[head%BUTTONQUEUE]={ms, (uint8_t)type};
+  _head=head+1;               // publishes the event
+}
+
+// from the loop, one event per call
+ButtonEvent ButtonDecoder::poll(uint32_t ms)
+{
+  uint8_t tail=_tail;
+  uint8_t head=_head;
+  if (tail==head) return BUTTON_NONE;
+
+  const Event &e=_events[tail%BUTTONQUEUE];
+  if (e.type==BUTTON_CLICK)
+  {
+    if ((uint8_t)(tail+1)!=head)
+    {
+      if (_events[(tail+1)%BUTTONQUEUE].type==BUTTON_DOUBLECLICK)
+      {
+        _tail=tail+2;
+        return BUTTON_DOUBLECLICK;
+      }
+    }
+    else if (ms-e.ms<BUTTONDOUBLE || (_pressed && _pressMs-e.ms<=BUTTONDOUBLE))
+      return BUTTON_NONE;     // may still become a double click
+  }
+
+  ButtonEvent type=(ButtonEvent)e.type;
+  _tail=tail+1;
+  return type;
+}
@@ -0,0 +1,55 @@
+/* Button decoder
+ *
+ * edge() is called from the GPIO interrupt with the time of every change of the button. It debounces and
+ * classifies from these timestamps alone: a press of BUTTONLONG ms or more is a long press, a click that
+ * follows another within BUTTONDOUBLE ms makes a double click. The events go into a ring written only by
+ * the interrupt and read only by poll() in the loop, so neither side locks; a stalled loop finds the events
+ * with the timing they really had.
+ * A click is held back by poll() until BUTTONDOUBLE ms have passed without a second one, a double click
+ * replaces it. Works on the host as well (bench).
+ */
+
+#ifndef ButtonDecoder_h
+#define ButtonDecoder_h
+
+#include "Hal.h"
+#include "Platform.h"
+
+#define BUTTONDEBOUNCE 50   // ms
+#define BUTTONDOUBLE 400    // ms from the release of a click to the next press
+#define BUTTONLONG 800      // ms
+#define BUTTONQUEUE 8       // power of 2
+
+class ButtonDecoder
+{
+  public:
+    void edge(uint32_t ms, bool pressed);
+    ButtonEvent poll(uint32_t ms);
+    bool pressed() const {return _pressed;}
+    bool pending() const {return _head!=_tail;}
+    uint32_t lastEdge() const {return _edgeMs;}
+    uint32_t dropped() const {return _dropped;}
+
+  private:
+    struct Event
+    {
+      uint32_t ms;
+      uint8_t type;         // ButtonEvent
+    };
+
+    void _push(ButtonEvent type, uint32_t ms);
+
+    // written by the interrupt
+    volatile bool _pressed=false;
+    volatile uint32_t _edgeMs=0;
+    volatile uint32_t _pressMs=0;
+    uint32_t _clickMs=0;
+    bool _clicked=false;
+    volatile uint32_t _dropped=0;
+    Event _events[BUTTONQUEUE];
+    volatile uint8_t _head=0;
+    // written by poll()
+    volatile uint8_t _tail=0;
+};
+
+#endif
@@ -0,0 +1,41 @@
+/* Epoch seconds counted on the ms clock
+ *
+ * Like TimeLib, but the phase of the second is kept: set() takes how many ms of the second t have already
+ * passed, subSecond() tells how far the current second is. The start of the second moves on in whole
+ * seconds, so the count survives the wrap of millis() as long as it is read at least every 49 days.
+ */
+
+#ifndef EpochCounter_h
+#define EpochCounter_h
+
+#include <stdint.h>
+
+class EpochCounter
+{
+  public:
+    uint32_t now(uint32_t ms)
+    {
+      uint32_t n=(ms-_start)/1000;
+      _epoch+=n;
+      _start+=n*1000;
+      return _epoch;
+    }
+
+    uint16_t subSecond(uint32_t ms)
+    {
+      now(ms);
+      return ms-_start;
+    }
+
+    void set(uint32_t t, uint16_t passed, uint32_t ms)
+    {
+      _epoch=t;
+      _start=ms-passed;
+    }
+
+  private:
+    uint32_t _epoch=0;
+    uint32_t _start=0;      // ms at which the second _epoch began
+};
+
+#endif
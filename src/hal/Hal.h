@@ -0,0 +1,160 @@
+/* Hardware abstraction layer
+ *
+ * The clock logic talks to the hardware only through these interfaces.
+ * HalEsp8266 implements them with TM1637Display, a GPIO interrupt, LittleFS, EEPROM, lwIP UDP, SNTP and timer1,
+ * HalLinux with the host clock, the terminal, a directory and POSIX sockets.
+ * TcpStream never blocks: connect() only starts the connection, read() and write() take what is there.
+ * The clock keeps the phase of its second (see EpochCounter.h), the time sources report theirs, so the
+ * displays of several clocks change the minute together.
+ *
+ * IP addresses are uint32_t with the first octet in the lowest byte, like IPAddress.
+ */
+
+#ifndef Hal_h
+#define Hal_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+class ClockSource
+{
+  public:
+    virtual uint32_t millis()=0;              // monotonic
+    virtual uint32_t now()=0;                 // epoch seconds, UTC
+    virtual uint16_t subSecond()=0;           // ms since the second of now() began
+    virtual void setTime(uint32_t t, uint16_t ms)=0;  // ms of t have passed
+};
+
+class TimeSync
+{
+  public:
+    virtual uint32_t getEpochTime(uint16_t &ms)=0;  // UTC and ms into that second, 0 if no time available
+    virtual uint32_t updateInterval()=0;      // ms
+};
+
+class DisplaySink
+{
+  public:
+    virtual void setSegments(const uint8_t segments[4])=0;
+    virtual void setBrightness(uint8_t brightness)=0;
+    virtual void clear()=0;
+};
+
+enum ButtonEvent { BUTTON_NONE, BUTTON_CLICK, BUTTON_LONGPRESS, BUTTON_DOUBLECLICK };
+
+class ButtonSource
+{
+  public:
+    virtual ButtonEvent poll()=0;
+};
+
+#define TONE_DC 0xffff     // frequency of a step that holds the pin on, for active buzzers
+
+// freq 0 is silence, the duty in % changes linearly from duty to dutyEnd over the step (envelope)
+struct ToneStep
+{
+  uint16_t freq;      // Hz
+  uint16_t ms;
+  uint8_t duty;
+  uint8_t dutyEnd;
+};
+
+// steps and pattern are read from the timer interrupt on the ESP8266, so they must not be PROGMEM
+struct TonePattern
+{
+  const char *name;
+  const ToneStep *steps;
+  uint8_t count;
+  bool repeat;        // else it stops after the last step
+};
+
+// plays a pattern on its own until stop(), independent of loop()
+class Buzzer
+{
+  public:
+    virtual void play(const TonePattern &pattern)=0;
+    virtual void stop()=0;
+    virtual bool playing()=0;
+};
+
+class Gpio
+{
+  public:
+    virtual void pinMode(int pin, bool output)=0;
+    virtual void write(int pin, bool high)=0;
+    virtual bool read(int pin)=0;
+};
+
+class KeyValueStore
+{
+  public:
+    virtual void begin(size_t size)=0;
+    virtual uint8_t read(int adr)=0;
+    virtual void write(int adr, uint8_t val)=0;
+    virtual bool commit()=0;
+};
+
+class FileStore
+{
+  public:
+    virtual bool exists(const char *path)=0;
+    virtual int size(const char *path)=0;                                         // -1 if missing
+    virtual int read(const char *path, uint32_t offset, char *buf, size_t len)=0; // bytes read, -1 if missing
+    virtual bool write(const char *path, const char *data, size_t len)=0;         // replaces the file
+    virtual bool append(const char *path, const char *data, size_t len)=0;
+    virtual bool remove(const char *path)=0;
+    // mtime in epoch seconds, 0 if unknown
+    virtual void list(void (*fn)(void *ctx, const char *name, uint32_t size, uint32_t mtime), void *ctx)=0;
+    virtual bool usage(uint32_t &total, uint32_t &used)=0;
+};
+
+class UdpPort
+{
+  public:
+    virtual bool begin(uint16_t port)=0;
+    virtual bool joinGroup(uint32_t group)=0;     // also receives what is sent to this multicast group
+    virtual bool sendTo(uint32_t ip, uint16_t port, const uint8_t *data, size_t len)=0;
+    // -1 if nothing pending, at is the ClockSource::millis() the packet arrived
+    virtual int receive(uint8_t *buf, size_t len, uint32_t *ip, uint16_t *port, uint32_t *at)=0;
+};
+
+enum class ImageTarget { Firmware, Filesystem };
+
+// writes an update image to flash as it arrives, it takes effect at the next restart
+class FirmwareWriter
+{
+  public:
+    virtual bool begin(ImageTarget target)=0;     // up to the whole partition
+    virtual bool setMd5(const char *hex)=0;       // of all bytes written, checked by end()
+    virtual size_t write(const uint8_t *data, size_t len)=0;
+    virtual bool end()=0;                         // false if the image or its MD5 is bad
+    virtual void abort()=0;
+    virtual const char *error()=0;                // of the last call that failed
+};
+
+enum TcpState { TCP_CLOSED, TCP_CONNECTING, TCP_CONNECTED };
+
+class TcpStream
+{
+  public:
+    virtual bool connect(const char *host, uint16_t port)=0;  // false if it cannot even start
+    virtual TcpState state()=0;
+    virtual size_t write(const uint8_t *data, size_t len)=0;  // bytes taken, 0 if the send buffer is full
+    virtual int read(uint8_t *buf, size_t len)=0;             // bytes read, 0 if nothing pending, -1 if closed
+    virtual void close()=0;
+};
+
+struct Hal
+{
+  ClockSource &clock;
+  TimeSync &timeSync;
+  DisplaySink &display;
+  ButtonSource &button;
+  Buzzer &buzzer;
+  Gpio &gpio;
+  KeyValueStore &kv;
+  FileStore &fs;
+  UdpPort &udp;
+};
+
+#endif
@@ -0,0 +1,563 @@
+#ifdef ARDUINO
+
+#include "HalEsp8266.h"
+#include <Updater.h>
+#include <flash_hal.h>
+#include "ToneSequencer.h"
+
+uint32_t EspClockSource::millis()
+{
+  return ::millis();
+}
+
+uint32_t EspClockSource::now()
+{
+  return _epoch.now(::millis());
+}
+
+uint16_t EspClockSource::subSecond()
+{
+  return _epoch.subSecond(::millis());
+}
+
+void EspClockSource::setTime(uint32_t t, uint16_t ms)
+{
+  _epoch.set(t, ms, ::millis());
+}
+
+uint32_t EspTimeSync::getEpochTime(uint16_t &ms)
+{
+#if FEATURE_NTP
+  return _esp.getEpochTime(ms);
+#else
+  return 0;
+#endif
+}
+
+uint32_t EspTimeSync::updateInterval()
+{
+  return _esp.getUpdateInterval();
+}
+
+void Tm1637Sink::setSegments(const uint8_t segments[4])
+{
+  _display.setSegments(segments);
+}
+
+void Tm1637Sink::setBrightness(uint8_t brightness)
+{
+  _display.setBrightness(brightness);
+}
+
+void Tm1637Sink::clear()
+{
+  _display.clear();
+}
+
+IsrButton::IsrButton(int pin) : _pin(pin)
+{
+  pinMode(_pin, INPUT);
+  attachInterruptArg(digitalPinToInterrupt(_pin), _isr, this, CHANGE);
+}
+
+void IRAM_ATTR IsrButton::_isr(void *arg)
+{
+  IsrButton *button=(IsrButton *)arg;
+  button->_decoder.edge(millis(), GPIP(button->_pin)==0);
+  tickless.wake();
+}
+
+ButtonEvent IsrButton::poll()
+{
+  // a change hidden in a bounce leaves the decoder on the wrong level, taken over once the pin is stable
+  uint32_t ms=millis();
+  bool pressed=digitalRead(_pin)==LOW;
+  if (pressed!=_decoder.pressed() && ms-_decoder.lastEdge()>=2*BUTTONDEBOUNCE)
+  {
+    noInterrupts();
+    _decoder.edge(ms, pressed);
+    interrupts();
+  }
+  return _decoder.poll(ms);
+}
+
+static ToneSequencer timerTone;
+static uint32_t timerPinMask=0;
+
+// sets the pin and rearms the timer for the next edge, 5 ticks per us with TIM_DIV16
+static void IRAM_ATTR timerToneIsr()
+{
+  bool level;
+  uint32_t us=timerTone.next(level);
+  if (level) GPOS=timerPinMask;
+  else GPOC=timerPinMask;
+  if (us) timer1_write(us*5);
+  else timer1_disable();
+}
+
+Timer1Buzzer::Timer1Buzzer(int pin)
+{
+  ::pinMode(pin, OUTPUT);
+  digitalWrite(pin, LOW);
+  timerPinMask=1UL<<pin;
+}
+
+void Timer1Buzzer::play(const TonePattern &pattern)
+{
+  timer1_disable();
+  timerTone.start(&pattern);
+  timer1_attachInterrupt(timerToneIsr);
+  timer1_enable(TIM_DIV16, TIM_EDGE, TIM_SINGLE);
+  timer1_write(50);
+}
+
+void Timer1Buzzer::stop()
+{
+  timer1_disable();
+  timerTone.stop();
+  GPOC=timerPinMask;
+}
+
+bool Timer1Buzzer::playing()
+{
+  return timerTone.playing();
+}
+
+void ArduinoGpio::pinMode(int pin, bool output)
+{
+  ::pinMode(pin, output?OUTPUT:INPUT);
+}
+
+void ArduinoGpio::write(int pin, bool high)
+{
+  digitalWrite(pin, high?HIGH:LOW);
+}
+
+bool ArduinoGpio::read(int pin)
+{
+  return digitalRead(pin)==HIGH;
+}
+
+void EepromStore::begin(size_t size)
+{
+  EEPROM.begin(size);
+}
+
+uint8_t EepromStore::read(int adr)
+{
+  return EEPROM.read(adr);
+}
+
+void EepromStore::write(int adr, uint8_t val)
+{
+  EEPROM.write(adr, val);
+}
+
+bool EepromStore::commit()
+{
+  return EEPROM.commit();
+}
+
+static LittleFsStore littleFs;
+FileIndex fileIndex(littleFs, []() -> uint32_t {return time(nullptr);});
+
+bool LittleFsStore::exists(const char *path)
+{
+  return LittleFS.exists(path);
+}
+
+int LittleFsStore::size(const char *path)
+{
+  File f=LittleFS.open(path, "r");
+  if (!f) return -1;
+  int n=f.size();
+  f.close();
+  return n;
+}
+
+int LittleFsStore::read(const char *path, uint32_t offset, char *buf, size_t len)
+{
+  File f=LittleFS.open(path, "r");
+  if (!f) return -1;
+  int n=0;
+  if (f.seek(offset)) n=f.read((uint8_t *)buf, len);
+  f.close();
+  return n;
+}
+
+bool LittleFsStore::write(const char *path, const char *data, size_t len)
+{
+  File f=LittleFS.open(path, "w");
+  if (!f) return false;
+  bool ok=f.write((const uint8_t *)data, len)==len;
+  f.close();
+  return ok;
+}
+
+bool LittleFsStore::append(const char *path, const char *data, size_t len)
+{
+  File f=LittleFS.open(path, "a");
+  if (!f) return false;
+  bool ok=f.write((const uint8_t *)data, len)==len;
+  f.close();
+  return ok;
+}
+
+bool LittleFsStore::remove(const char *path)
+{
+  return LittleFS.remove(path);
+}
+
+void LittleFsStore::list(void (*fn)(void *ctx, const char *name, uint32_t size, uint32_t mtime), void *ctx)
+{
+  Dir dir=LittleFS.openDir("/");
+  while (dir.next())
+  {
+    if (dir.isFile()) fn(ctx, dir.fileName().c_str(), dir.fileSize(), dir.fileTime());
+  }
+}
+
+bool LittleFsStore::usage(uint32_t &total, uint32_t &used)
+{
+  FSInfo info;
+  if (!LittleFS.info(info)) return false;
+  total=info.totalBytes;
+  used=info.usedBytes;
+  return true;
+}
+
+// the whole free space, end() takes an image that is smaller
+bool EspFirmwareWriter::begin(ImageTarget target)
+{
+  _error="";
+  Update.runAsync(true);
+  bool ok=target==ImageTarget::Firmware
+    ?Update.begin((ESP.getFreeSketchSpace()-0x1000)&0xfffff000, U_FLASH)
+    :Update.begin(FS_PHYS_SIZE, U_FS);
+  return ok || _failed();
+}
+
+bool EspFirmwareWriter::setMd5(const char *hex)
+{
+  return Update.setMD5(hex) || _failed();
+}
+
+size_t EspFirmwareWriter::write(const uint8_t *data, size_t len)
+{
+  size_t n=Update.write(const_cast<uint8_t *>(data), len);
+  if (n!=len) _failed();
+  return n;
+}
+
+bool EspFirmwareWriter::end()
+{
+  return Update.end(true) || _failed();
+}
+
+void EspFirmwareWriter::abort()
+{
+  if (Update.isRunning()) Update.end(false);
+  Update.clearError();
+}
+
+bool EspFirmwareWriter::_failed()
+{
+  _error=Update.getErrorString();
+  if (_error.length()==0) _error="Update failed";
+  Update.clearError();
+  return false;
+}
+
+WifiUdpPort::~WifiUdpPort()
+{
+  if (_pcb) udp_remove(_pcb);
+}
+
+bool WifiUdpPort::begin(uint16_t port)
+{
+  if (_pcb) udp_remove(_pcb);
+  _pcb=udp_new();
+  if (!_pcb) return false;
+  if (udp_bind(_pcb, IP_ADDR_ANY, port)!=ERR_OK)
+  {
+    udp_remove(_pcb);
+    _pcb=nullptr;
+    return false;
+  }
+  udp_recv(_pcb, &WifiUdpPort::_received, this);
+  return true;
+}
+
+// lwIP stores the address with the first octet in the low byte too
+bool WifiUdpPort::joinGroup(uint32_t group)
+{
+  ip4_addr_t g;
+  g.addr=group;
+  return igmp_joingroup(IP4_ADDR_ANY4, &g)==ERR_OK;
+}
+
+bool WifiUdpPort::sendTo(uint32_t ip, uint16_t port, const uint8_t *data, size_t len)
+{
+  if (!_pcb) return false;
+  pbuf *p=pbuf_alloc(PBUF_TRANSPORT, len, PBUF_RAM);
+  if (!p) return false;
+  pbuf_take(p, data, len);
+  ip_addr_t a;
+  IP_ADDR4(&a, ip&0xff, (ip>>8)&0xff, (ip>>16)&0xff, ip>>24);
+  err_t err=udp_sendto(_pcb, p, &a, port);
+  pbuf_free(p);
+  return err==ERR_OK;
+}
+
+int WifiUdpPort::receive(uint8_t *buf, size_t len, uint32_t *ip, uint16_t *port, uint32_t *at)
+{
+  if (_tail==_head) return -1;
+  Packet &k=_queue[_tail];
+  size_t n=k.len<len?k.len:len;
+  memcpy(buf, k.data, n);
+  if (ip) *ip=k.ip;
+  if (port) *port=k.port;
+  if (at) *at=k.at;
+  _tail=(_tail+1)%UDPQUEUE;
+  return n;
+}
+
+// runs in the context of lwIP, a full queue drops the packet
+void WifiUdpPort::_received(void *arg, udp_pcb *pcb, pbuf *p, const ip_addr_t *addr, u16_t port)
+{
+  WifiUdpPort *self=(WifiUdpPort *)arg;
+  uint8_t next=(self->_head+1)%UDPQUEUE;
+  if (next!=self->_tail)
+  {
+    Packet &k=self->_queue[self->_head];
+    k.at=millis();
+    k.len=pbuf_copy_partial(p, k.data, sizeof(k.data), 0);
+    k.ip=ip4_addr_get_u32(ip_2_ip4(addr));
+    k.port=port;
+    self->_head=next;
+  }
+  pbuf_free(p);
+  tickless.wake();
+}
+
+//-----------------------------------------------  TCP ------------------------------------------------------------------------
+
+AsyncTcpStream::AsyncTcpStream()
+{
+  _client.onConnect([this](void *, AsyncClient *) {_state=TCP_CONNECTED; tickless.wake();});
+  _client.onDisconnect([this](void *, AsyncClient *) {_state=TCP_CLOSED; tickless.wake();});
+  _client.onError([this](void *, AsyncClient *, int8_t) {_state=TCP_CLOSED; tickless.wake();});
+  _client.onData([this](void *, AsyncClient *, void *data, size_t len) {_received((const uint8_t *)data, len);});
+}
+
+// host names are resolved by lwIP in the background
+bool AsyncTcpStream::connect(const char *host, uint16_t port)
+{
+  close();
+  _head=_tail=0;
+  _state=TCP_CONNECTING;
+  if (!_client.connect(host, port)) _state=TCP_CLOSED;
+  return _state!=TCP_CLOSED;
+}
+
+TcpState AsyncTcpStream::state()
+{
+  return _state;
+}
+
+size_t AsyncTcpStream::write(const uint8_t *data, size_t len)
+{
+  if (_state!=TCP_CONNECTED) return 0;
+  size_t n=_client.add((const char *)data, len<_client.space()?len:_client.space());
+  if (n>0) _client.send();
+  return n;
+}
+
+int AsyncTcpStream::read(uint8_t *buf, size_t len)
+{
+  size_t n=0;
+  while (n<len && _tail!=_head)
+  {
+    buf[n++]=_rx[_tail];
+    _tail=(_tail+1)%TCPRXBUFFER;
+  }
+  if (n==0 && _state==TCP_CLOSED) return -1;
+  return n;
+}
+
+void AsyncTcpStream::close()
+{
+  if (_state!=TCP_CLOSED) _client.close(true);
+  _state=TCP_CLOSED;
+}
+
+// runs in the context of lwIP, the data is acknowledged when this returns, so what does not fit ends the connection
+void AsyncTcpStream::_received(const uint8_t *data, size_t len)
+{
+  for (size_t i=0;i<len;i++)
+  {
+    uint16_t next=(_head+1)%TCPRXBUFFER;
+    if (next==_tail)
+    {
+      LOGW("tcp", "receive buffer full, closing");
+      _client.close(true);
+      break;
+    }
+    _rx[_head]=data[i];
+    _head=next;
+  }
+  tickless.wake();
+}
+
+//-----------------------------------------------  HTTP adapter ------------------------------------------------------------------------
+
+HttpMethod EspHttpRequest::method()
+{
+  if (_req->method()==HTTP_GET) return HttpMethod::Get;
+  if (_req->method()==HTTP_POST) return HttpMethod::Post;
+  if (_req->method()==HTTP_PUT) return HttpMethod::Put;
+  if (_req->method()==HTTP_DELETE) return HttpMethod::Delete;
+  return HttpMethod::Other;
+}
+
+std::string_view EspHttpRequest::path()
+{
+  const String &url=_req->url();
+  return std::string_view(url.c_str(), url.length());
+}
+
+bool EspHttpRequest::param(const char *name, std::string_view &value)
+{
+  if (!_req->hasParam(name)) return false;
+  const String &v=_req->getParam(name)->value();
+  value=std::string_view(v.c_str(), v.length());
+  return true;
+}
+
+bool EspHttpRequest::header(const char *name, std::string_view &value)
+{
+  const AsyncWebHeader *h=_req->getHeader(name);
+  if (!h) return false;
+  const String &v=h->value();
+  value=std::string_view(v.c_str(), v.length());
+  return true;
+}
+
+std::string_view EspHttpRequest::body()
+{
+  if (!_req->_tempObject) return std::string_view();
+  return std::string_view((const char *)_req->_tempObject);
+}
+
+void EspHttpResponse::begin(int status, const char *contentType)
+{
+  _stream=_req->beginResponseStream(contentType);
+  _stream->setCode(status);
+  _response=_stream;
+}
+
+void EspHttpResponse::header(const char *name, const char *value)
+{
+  if (_response) _response->addHeader(name, value);
+}
+
+void EspHttpResponse::write(const char *s, size_t len)
+{
+  if (_stream) _stream->write((const uint8_t *)s, len);
+}
+
+void EspHttpResponse::stream(int status, const char *contentType, HttpFiller fill)
+{
+  _response=_req->beginChunkedResponse(contentType, fill);
+  _response->setCode(status);
+}
+
+void EspHttpResponse::send()
+{
+  if (_response) _req->send(_response);
+  else _req->send(500);
+}
+
+HttpAdmission httpAdmission([]() -> uint32_t {return ESP.getFreeHeap();});
+static HttpHandler admitHandlers[ADMITROUTES];    // by route, for the requests that waited
+
+static void runHttp(AsyncWebServerRequest *request, const HttpHandler &handler)
+{
+  EspHttpRequest req(request);
+  EspHttpResponse res(request);
+  handler(req, res);
+  res.send();
+}
+
+static void rejectHttp(AsyncWebServerRequest *request)
+{
+  EspHttpResponse res(request);
+  HttpAdmission::reject(res);
+  res.send();
+}
+
+// a request that has to wait is kept without an answer until pollHttp(), its disconnect takes it out
+void serveHttp(AsyncWebServer *server, const char *uri, WebRequestMethodComposite method, HttpHandler handler,
+  const HttpBudget &budget)
+{
+  int route=httpAdmission.route(uri, budget);
+  if (route>=0) admitHandlers[route]=handler;
+  server->on(uri, method, [handler, route](AsyncWebServerRequest *request)
+  {
+    request->onDisconnect([request]() {httpAdmission.finish(request);});
+    switch (httpAdmission.admit(route, request, millis()))
+    {
+      case HttpAdmit::Run: runHttp(request, handler); break;
+      case HttpAdmit::Wait: tickless.wake(); break;
+      case HttpAdmit::Reject: rejectHttp(request); break;
+    }
+  }, nullptr, [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total)
+  {
+    if (total>HTTPBODYMAX) return;
+    if (index==0) request->_tempObject=calloc(total+1, 1);
+    if (request->_tempObject) memcpy((char *)request->_tempObject+index, data, len);
+  });
+}
+
+// a rejected upload is marked by a _tempObject (freed with the request), read to its end and answered with 503
+void serveUpload(AsyncWebServer *server, const char *uri, HttpUploadHandler handler, const HttpBudget &budget)
+{
+  int route=httpAdmission.route(uri, budget);
+  server->on(uri, HTTP_POST, [](AsyncWebServerRequest *request) {},
+    [handler, route](AsyncWebServerRequest *request, String filename, size_t index, uint8_t *data, size_t len, bool final)
+  {
+    if (index==0)
+    {
+      request->onDisconnect([request]() {httpAdmission.finish(request);});
+      if (httpAdmission.admit(route, request, millis(), false)!=HttpAdmit::Run) request->_tempObject=calloc(1, 1);
+    }
+    if (request->_tempObject)
+    {
+      if (final) rejectHttp(request);
+      return;
+    }
+
+    EspHttpRequest req(request);
+    std::string_view name(filename.c_str(), filename.length());
+    if (!final)
+    {
+      handler(req, name, index, data, len, false, nullptr);
+      return;
+    }
+    EspHttpResponse res(request);
+    handler(req, name, index, data, len, true, &res);
+    res.send();
+  });
+}
+
+void pollHttp()
+{
+  httpAdmission.poll(millis(), [](void *ctx, int route, bool admitted)
+  {
+    AsyncWebServerRequest *request=(AsyncWebServerRequest *)ctx;
+    if (admitted) runHttp(request, admitHandlers[route]);
+    else rejectHttp(request);
+  });
+}
+
+#endif
@@ -0,0 +1,235 @@
+/* ESP8266 backend of the HAL
+ *
+ * Epoch counted on millis(), NTP through BasicESP8266, TM1637 display, EEPROM, LittleFS, UDP and
+ * ESPAsyncTCP: AsyncTcpStream collects the received bytes in a ring buffer of TCPRXBUFFER for the loop.
+ * WifiUdpPort is on the raw UDP of lwIP rather than WiFiUDP: its callback stamps every packet with the
+ * millis() of its arrival and wakes the loop, so time messages are not delayed by the idle sleep.
+ * Requests of serveHttp() and serveUpload() pass httpAdmission first; those that have to wait are run by
+ * pollHttp() from the loop, after the clock.
+ * The button is read by a GPIO interrupt, the loop only takes the decoded events (see ButtonDecoder),
+ * the interrupt wakes the loop from its idle sleep.
+ * EspFirmwareWriter is the Updater of the core, asynchronous (no yield()), as the chunks of an upload arrive
+ * in the context of the TCP stack; a gzip firmware image is stored as it is and inflated by eboot.
+ * The buzzer is played from the timer1 interrupt, which it owns: no tone(), analogWrite() or Servo beside it.
+ * EspHttp adapts ESPAsyncWebServer requests to the handlers of Http.h,
+ * a request body is collected in _tempObject (freed by the server) up to HTTPBODYMAX bytes,
+ * written responses are buffered in an AsyncResponseStream, streamed ones are chunked.
+ */
+
+#ifndef HalEsp8266_h
+#define HalEsp8266_h
+
+#include <TM1637Display.h>
+#include <ESPAsyncTCP.h>
+#include <lwip/udp.h>
+#include <lwip/igmp.h>
+#include "../BasicESP8266.h"
+#include "../Http.h"
+#include "../HttpAdmission.h"
+#include "Hal.h"
+#include "ButtonDecoder.h"
+#include "EpochCounter.h"
+
+#define TCPRXBUFFER 1024    // bytes received and not yet read
+#define UDPQUEUE 4          // packets received and not yet read
+#define UDPPACKETMAX 128    // longer ones are cut
+
+class EspClockSource : public ClockSource
+{
+  public:
+    uint32_t millis() override;
+    uint32_t now() override;
+    uint16_t subSecond() override;
+    void setTime(uint32_t t, uint16_t ms) override;
+
+  private:
+    EpochCounter _epoch;
+};
+
+class EspTimeSync : public TimeSync
+{
+  public:
+    EspTimeSync(BasicESP8266 &esp) : _esp(esp) {}
+    uint32_t getEpochTime(uint16_t &ms) override;
+    uint32_t updateInterval() override;
+
+  private:
+    BasicESP8266 &_esp;
+};
+
+class Tm1637Sink : public DisplaySink
+{
+  public:
+    Tm1637Sink(int clk_pin, int dio_pin) : _display(clk_pin, dio_pin) {}
+    void setSegments(const uint8_t segments[4]) override;
+    void setBrightness(uint8_t brightness) override;
+    void clear() override;
+
+  private:
+    TM1637Display _display;
+};
+
+// active low, pin 0..15, long press is reported when the button is released
+class IsrButton : public ButtonSource
+{
+  public:
+    IsrButton(int pin);
+    ButtonEvent poll() override;
+    bool pending() const {return _decoder.pending();}
+
+  private:
+    static void _isr(void *arg);
+
+    int _pin;
+    ButtonDecoder _decoder;
+};
+
+// pin 0..15, one instance
+class Timer1Buzzer : public Buzzer
+{
+  public:
+    Timer1Buzzer(int pin);
+    void play(const TonePattern &pattern) override;
+    void stop() override;
+    bool playing() override;
+};
+
+class ArduinoGpio : public Gpio
+{
+  public:
+    void pinMode(int pin, bool output) override;
+    void write(int pin, bool high) override;
+    bool read(int pin) override;
+};
+
+class EepromStore : public KeyValueStore
+{
+  public:
+    void begin(size_t size) override;
+    uint8_t read(int adr) override;
+    void write(int adr, uint8_t val) override;
+    bool commit() override;
+};
+
+class LittleFsStore : public FileStore
+{
+  public:
+    bool exists(const char *path) override;
+    int size(const char *path) override;
+    int read(const char *path, uint32_t offset, char *buf, size_t len) override;
+    bool write(const char *path, const char *data, size_t len) override;
+    bool append(const char *path, const char *data, size_t len) override;
+    bool remove(const char *path) override;
+    void list(void (*fn)(void *ctx, const char *name, uint32_t size, uint32_t mtime), void *ctx) override;
+    bool usage(uint32_t &total, uint32_t &used) override;
+};
+
+class EspFirmwareWriter : public FirmwareWriter
+{
+  public:
+    bool begin(ImageTarget target) override;
+    bool setMd5(const char *hex) override;
+    size_t write(const uint8_t *data, size_t len) override;
+    bool end() override;
+    void abort() override;
+    const char *error() override {return _error.c_str();}
+
+  private:
+    String _error;
+
+    bool _failed();
+};
+
+// the files of LittleFS, listed from RAM after BasicESP8266::begin() (FileIndex)
+extern FileIndex fileIndex;
+
+class WifiUdpPort : public UdpPort
+{
+  public:
+    ~WifiUdpPort();
+    bool begin(uint16_t port) override;
+    bool joinGroup(uint32_t group) override;
+    bool sendTo(uint32_t ip, uint16_t port, const uint8_t *data, size_t len) override;
+    int receive(uint8_t *buf, size_t len, uint32_t *ip, uint16_t *port, uint32_t *at) override;
+
+  private:
+    struct Packet
+    {
+      uint8_t data[UDPPACKETMAX];
+      uint16_t len;
+      uint16_t port;
+      uint32_t ip;
+      uint32_t at;
+    };
+
+    udp_pcb *_pcb=nullptr;
+    Packet _queue[UDPQUEUE];
+    volatile uint8_t _head=0;       // written by _received
+    uint8_t _tail=0;
+
+    static void _received(void *arg, udp_pcb *pcb, pbuf *p, const ip_addr_t *addr, u16_t port);
+};
+
+class AsyncTcpStream : public TcpStream
+{
+  public:
+    AsyncTcpStream();
+    bool connect(const char *host, uint16_t port) override;
+    TcpState state() override;
+    size_t write(const uint8_t *data, size_t len) override;
+    int read(uint8_t *buf, size_t len) override;
+    void close() override;
+
+  private:
+    AsyncClient _client;
+    volatile TcpState _state=TCP_CLOSED;
+    uint8_t _rx[TCPRXBUFFER];
+    volatile uint16_t _head=0;      // written by the callbacks
+    uint16_t _tail=0;
+
+    void _received(const uint8_t *data, size_t len);
+};
+
+class EspHttpRequest : public HttpRequest
+{
+  public:
+    EspHttpRequest(AsyncWebServerRequest *req) : _req(req) {}
+    HttpMethod method() override;
+    std::string_view path() override;
+    bool param(const char *name, std::string_view &value) override;
+    bool header(const char *name, std::string_view &value) override;
+    std::string_view body() override;
+    const void *id() override {return _req;}
+
+  private:
+    AsyncWebServerRequest *_req;
+};
+
+class EspHttpResponse : public HttpResponse
+{
+  public:
+    EspHttpResponse(AsyncWebServerRequest *req) : _req(req) {}
+    void begin(int status, const char *contentType) override;
+    void header(const char *name, const char *value) override;
+    void write(const char *s, size_t len) override;
+    void stream(int status, const char *contentType, HttpFiller fill) override;
+    void send();
+
+  private:
+    AsyncWebServerRequest *_req;
+    AsyncWebServerResponse *_response=nullptr;
+    AsyncResponseStream *_stream=nullptr;
+};
+
+// free heap of the ESP, requests of the routes below are admitted against it
+extern HttpAdmission httpAdmission;
+
+// registers handler for uri on server, with request body collection, admitted within budget
+void serveHttp(AsyncWebServer *server, const char *uri, WebRequestMethodComposite method, HttpHandler handler,
+  const HttpBudget &budget=HTTPNORMAL);
+// registers a multipart upload handler for POST to uri, an upload is admitted at its first chunk or not at all
+void serveUpload(AsyncWebServer *server, const char *uri, HttpUploadHandler handler, const HttpBudget &budget=HTTPHEAVY);
+// runs or rejects the requests that wait for admission, from the loop
+void pollHttp();
+
+#endif
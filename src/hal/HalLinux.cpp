@@ -0,0 +1,652 @@
+#ifndef ARDUINO
+
+#include "HalLinux.h"
+#include <chrono>
+#include <filesystem>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+
+namespace fs=std::filesystem;
+
+static const std::chrono::steady_clock::time_point START=std::chrono::steady_clock::now();
+
+static uint32_t hostMillis()
+{
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now()-START).count();
+}
+
+// ip has the first octet in the low byte, which is network order on little endian hosts
+static in_addr toAddr(uint32_t ip)
+{
+  in_addr a;
+  uint8_t *b=(uint8_t *)&a.s_addr;
+  for (int i=0;i<4;i++) b[i]=ip>>(8*i);
+  return a;
+}
+
+HostClock::HostClock()
+{
+}
+
+uint32_t HostClock::millis()
+{
+  return hostMillis();
+}
+
+// 0 until set, then counts seconds from the time it was set
+uint32_t HostClock::now()
+{
+  return _epoch.now(millis());
+}
+
+uint16_t HostClock::subSecond()
+{
+  return _epoch.subSecond(millis());
+}
+
+void HostClock::setTime(uint32_t t, uint16_t ms)
+{
+  _epoch.set(t, ms, millis());
+}
+
+uint32_t HostTimeSync::getEpochTime(uint16_t &ms)
+{
+  if (!available) return 0;
+  timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  ms=ts.tv_nsec/1000000;
+  return (uint32_t)ts.tv_sec;
+}
+
+uint32_t HostTimeSync::updateInterval()
+{
+  return _interval;
+}
+
+//-----------------------------------------------  display and button ------------------------------------------------------------------------
+
+static char glyph(uint8_t seg)
+{
+  static const uint8_t DIGITS[]={0x3f, 0x06, 0x5b, 0x4f, 0x66, 0x6d, 0x7d, 0x07, 0x7f, 0x6f};
+  seg&=0x7f;
+  if (seg==0) return ' ';
+  for (int i=0;i<10;i++) if (DIGITS[i]==seg) return '0'+i;
+  if (seg==0x54) return 'n';
+  if (seg==0x71) return 'F';
+  return '?';
+}
+
+void TerminalDisplay::setSegments(const uint8_t segments[4])
+{
+  if (memcmp(segments, _last, 4)==0) return;
+  memcpy(_last, segments, 4);
+  fprintf(_out, "[%c%c%c%c%c]\n", glyph(segments[0]), glyph(segments[1]), (segments[1]&0x80)?':':' ',
+    glyph(segments[2]), glyph(segments[3]));
+  fflush(_out);
+}
+
+void TerminalDisplay::setBrightness(uint8_t brightness)
+{
+  fprintf(_out, "[brightness %u]\n", brightness);
+}
+
+void TerminalDisplay::clear()
+{
+  static const uint8_t blank[4]={0, 0, 0, 0};
+  setSegments(blank);
+}
+
+void TerminalBuzzer::play(const TonePattern &pattern)
+{
+  fprintf(_out, "[buzzer %s]\n", pattern.name);
+  fflush(_out);
+  _playing=true;
+}
+
+void TerminalBuzzer::stop()
+{
+  if (_playing) fprintf(_out, "[buzzer off]\n");
+  _playing=false;
+}
+
+bool TerminalBuzzer::playing()
+{
+  return _playing;
+}
+
+StdinButton::StdinButton(bool enabled) : _enabled(enabled)
+{
+  if (_enabled) fcntl(STDIN_FILENO, F_SETFL, fcntl(STDIN_FILENO, F_GETFL)|O_NONBLOCK);
+}
+
+ButtonEvent StdinButton::poll()
+{
+  char c;
+  while (_enabled && ::read(STDIN_FILENO, &c, 1)==1)
+  {
+    if (c=='c') return BUTTON_CLICK;
+    if (c=='l') return BUTTON_LONGPRESS;
+    if (c=='d') return BUTTON_DOUBLECLICK;
+  }
+  return BUTTON_NONE;
+}
+
+void MemoryGpio::pinMode(int pin, bool output)
+{
+}
+
+void MemoryGpio::write(int pin, bool high)
+{
+  if (pin<0 || pin>31) return;
+  if (high) _levels|=1u<<pin;
+  else _levels&=~(1u<<pin);
+  writes++;
+}
+
+bool MemoryGpio::read(int pin)
+{
+  return pin>=0 && pin<32 && (_levels&(1u<<pin));
+}
+
+//-----------------------------------------------  storage ------------------------------------------------------------------------
+
+void FileKeyValueStore::begin(size_t size)
+{
+  _data.assign(size, 0xff);
+  FILE *f=fopen(_path.c_str(), "rb");
+  if (!f) return;
+  size_t n=fread(_data.data(), 1, size, f);
+  (void)n;
+  fclose(f);
+}
+
+uint8_t FileKeyValueStore::read(int adr)
+{
+  return adr>=0 && (size_t)adr<_data.size()?_data[adr]:0;
+}
+
+void FileKeyValueStore::write(int adr, uint8_t val)
+{
+  if (adr>=0 && (size_t)adr<_data.size()) _data[adr]=val;
+}
+
+bool FileKeyValueStore::commit()
+{
+  FILE *f=fopen(_path.c_str(), "wb");
+  if (!f) return false;
+  bool ok=fwrite(_data.data(), 1, _data.size(), f)==_data.size();
+  fclose(f);
+  return ok;
+}
+
+//-----------------------------------------------  Update images ------------------------------------------------------------------------
+
+static const uint32_t MD5K[64]=
+{
+  0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+  0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+  0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+  0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+  0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+  0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+  0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+  0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+};
+static const uint8_t MD5R[16]={7, 12, 17, 22, 5, 9, 14, 20, 4, 11, 16, 23, 6, 10, 15, 21};
+
+// one 64 byte block of RFC 1321
+static void md5Block(uint32_t h[4], const uint8_t *p)
+{
+  uint32_t m[16];
+  for (int i=0;i<16;i++) m[i]=p[4*i]|p[4*i+1]<<8|p[4*i+2]<<16|(uint32_t)p[4*i+3]<<24;
+  uint32_t a=h[0], b=h[1], c=h[2], d=h[3];
+  for (int i=0;i<64;i++)
+  {
+    uint32_t f;
+    int g;
+    if (i<16) {f=(b&c)|(~b&d); g=i;}
+    else if (i<32) {f=(d&b)|(~d&c); g=(5*i+1)%16;}
+    else if (i<48) {f=b^c^d; g=(3*i+5)%16;}
+    else {f=c^(b|~d); g=(7*i)%16;}
+    uint32_t t=d;
+    d=c;
+    c=b;
+    uint32_t x=a+f+MD5K[i]+m[g];
+    int r=MD5R[(i/16)*4+i%4];
+    b+=(x<<r)|(x>>(32-r));
+    a=t;
+  }
+  h[0]+=a;
+  h[1]+=b;
+  h[2]+=c;
+  h[3]+=d;
+}
+
+FileFirmwareWriter::~FileFirmwareWriter()
+{
+  abort();
+}
+
+bool FileFirmwareWriter::begin(ImageTarget target)
+{
+  abort();
+  _target=target;
+  _path=_dir+(target==ImageTarget::Firmware?"/firmware.bin":"/filesystem.bin");
+  _f=fopen((_path+".new").c_str(), "wb");
+  if (!_f) return _fail("Flash Erase Failed");
+  _written=0;
+  _md5.clear();
+  _hash[0]=0x67452301;
+  _hash[1]=0xefcdab89;
+  _hash[2]=0x98badcfe;
+  _hash[3]=0x10325476;
+  _error.clear();
+  return true;
+}
+
+bool FileFirmwareWriter::setMd5(const char *hex)
+{
+  if (strlen(hex)!=32) return _fail("MD5 Failed");
+  _md5=hex;
+  return true;
+}
+
+// a firmware starts with the magic byte of the ESP8266 or is gzip, like the Updater checks
+size_t FileFirmwareWriter::write(const uint8_t *data, size_t len)
+{
+  if (!_f) return 0;
+  if (_written==0 && len>0 && _target==ImageTarget::Firmware && data[0]!=0xe9 && data[0]!=0x1f)
+  {
+    _fail("Magic byte is wrong, not 0xE9");
+    return 0;
+  }
+  if (_written+len>_space)
+  {
+    _fail("Not Enough Space");
+    return 0;
+  }
+  if (fwrite(data, 1, len, _f)!=len)
+  {
+    _fail("Flash Write Failed");
+    return 0;
+  }
+  for (size_t i=0;i<len;i++)
+  {
+    _block[_written%64]=data[i];
+    if (++_written%64==0) md5Block(_hash, _block);
+  }
+  return len;
+}
+
+bool FileFirmwareWriter::end()
+{
+  if (!_f) return false;
+  fclose(_f);
+  _f=nullptr;
+  uint64_t bits=(uint64_t)_written*8;
+  size_t n=_written%64;
+  _block[n++]=0x80;
+  if (n>56)
+  {
+    memset(_block+n, 0, 64-n);
+    md5Block(_hash, _block);
+    n=0;
+  }
+  memset(_block+n, 0, 56-n);
+  for (int i=0;i<8;i++) _block[56+i]=bits>>(8*i);
+  md5Block(_hash, _block);
+  char hex[33];
+  for (int i=0;i<16;i++) snprintf(hex+2*i, 3, "%02x", (_hash[i/4]>>(8*(i%4)))&0xff);
+  if (!_md5.empty() && strcasecmp(hex, _md5.c_str())!=0)
+  {
+    remove((_path+".new").c_str());
+    _error="MD5 Check Failed";
+    return false;
+  }
+  if (rename((_path+".new").c_str(), _path.c_str())!=0) return _fail("Flash Write Failed");
+  return true;
+}
+
+void FileFirmwareWriter::abort()
+{
+  if (!_f) return;
+  fclose(_f);
+  _f=nullptr;
+  remove((_path+".new").c_str());
+}
+
+bool FileFirmwareWriter::_fail(const char *error)
+{
+  _error=error;
+  abort();
+  return false;
+}
+
+DirFileStore::DirFileStore(const char *root) : _root(root)
+{
+  std::error_code ec;
+  fs::create_directories(_root, ec);
+}
+
+std::string DirFileStore::_full(const char *path)
+{
+  while (*path=='/') path++;
+  return _root+"/"+path;
+}
+
+bool DirFileStore::exists(const char *path)
+{
+  std::error_code ec;
+  return fs::is_regular_file(_full(path), ec);
+}
+
+int DirFileStore::size(const char *path)
+{
+  std::error_code ec;
+  uintmax_t n=fs::file_size(_full(path), ec);
+  return ec?-1:(int)n;
+}
+
+int DirFileStore::read(const char *path, uint32_t offset, char *buf, size_t len)
+{
+  FILE *f=fopen(_full(path).c_str(), "rb");
+  if (!f) return -1;
+  int n=0;
+  if (fseek(f, offset, SEEK_SET)==0) n=fread(buf, 1, len, f);
+  fclose(f);
+  return n;
+}
+
+bool DirFileStore::write(const char *path, const char *data, size_t len)
+{
+  FILE *f=fopen(_full(path).c_str(), "wb");
+  if (!f) return false;
+  bool ok=fwrite(data, 1, len, f)==len;
+  fclose(f);
+  return ok;
+}
+
+bool DirFileStore::append(const char *path, const char *data, size_t len)
+{
+  FILE *f=fopen(_full(path).c_str(), "ab");
+  if (!f) return false;
+  bool ok=fwrite(data, 1, len, f)==len;
+  fclose(f);
+  return ok;
+}
+
+bool DirFileStore::remove(const char *path)
+{
+  std::error_code ec;
+  return fs::remove(_full(path), ec);
+}
+
+void DirFileStore::list(void (*fn)(void *ctx, const char *name, uint32_t size, uint32_t mtime), void *ctx)
+{
+  std::error_code ec;
+  for (const auto &e : fs::directory_iterator(_root, ec))
+  {
+    struct stat st;
+    if (e.is_regular_file()) fn(ctx, e.path().filename().c_str(), e.file_size(),
+      stat(e.path().c_str(), &st)==0?st.st_mtime:0);
+  }
+}
+
+bool DirFileStore::usage(uint32_t &total, uint32_t &used)
+{
+  std::error_code ec;
+  used=0;
+  for (const auto &e : fs::directory_iterator(_root, ec)) if (e.is_regular_file()) used+=e.file_size();
+  total=1024*1024;     // a 1 MB LittleFS partition
+  return true;
+}
+
+//-----------------------------------------------  UDP ------------------------------------------------------------------------
+
+PosixUdpPort::~PosixUdpPort()
+{
+  if (_fd>=0) close(_fd);
+}
+
+bool PosixUdpPort::begin(uint16_t port)
+{
+  if (_fd>=0) close(_fd);
+  _fd=socket(AF_INET, SOCK_DGRAM, 0);
+  if (_fd<0) return false;
+  int on=1;
+  setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  fcntl(_fd, F_SETFL, fcntl(_fd, F_GETFL)|O_NONBLOCK);
+  sockaddr_in a={};
+  a.sin_family=AF_INET;
+  a.sin_port=htons(port);
+  a.sin_addr.s_addr=htonl(INADDR_ANY);
+  return bind(_fd, (sockaddr *)&a, sizeof(a))==0;
+}
+
+// the own packets to the group come back, also to the other instances on this host
+bool PosixUdpPort::joinGroup(uint32_t group)
+{
+  if (_fd<0) return false;
+  ip_mreq m={};
+  m.imr_multiaddr=toAddr(group);
+  m.imr_interface=toAddr(_iface);
+  if (_iface) setsockopt(_fd, IPPROTO_IP, IP_MULTICAST_IF, &m.imr_interface, sizeof(m.imr_interface));
+  return setsockopt(_fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &m, sizeof(m))==0;
+}
+
+bool PosixUdpPort::sendTo(uint32_t ip, uint16_t port, const uint8_t *data, size_t len)
+{
+  if (_fd<0) return false;
+  sockaddr_in a={};
+  a.sin_family=AF_INET;
+  a.sin_port=htons(port);
+  a.sin_addr=toAddr(ip);
+  return sendto(_fd, data, len, 0, (sockaddr *)&a, sizeof(a))==(ssize_t)len;
+}
+
+// the arrival is when it is read, the caller polls often enough
+int PosixUdpPort::receive(uint8_t *buf, size_t len, uint32_t *ip, uint16_t *port, uint32_t *at)
+{
+  if (_fd<0) return -1;
+  sockaddr_in a={};
+  socklen_t alen=sizeof(a);
+  ssize_t n=recvfrom(_fd, buf, len, 0, (sockaddr *)&a, &alen);
+  if (n<0) return -1;
+  if (at) *at=hostMillis();
+  const uint8_t *b=(const uint8_t *)&a.sin_addr.s_addr;
+  if (ip) *ip=b[0]|(b[1]<<8)|(b[2]<<16)|((uint32_t)b[3]<<24);
+  if (port) *port=ntohs(a.sin_port);
+  return n;
+}
+
+//-----------------------------------------------  TCP ------------------------------------------------------------------------
+
+PosixTcpStream::~PosixTcpStream()
+{
+  close();
+}
+
+// resolves host blocking, then connects in the background
+bool PosixTcpStream::connect(const char *host, uint16_t port)
+{
+  close();
+  addrinfo hints={};
+  hints.ai_family=AF_INET;
+  hints.ai_socktype=SOCK_STREAM;
+  addrinfo *ai=nullptr;
+  char service[8];
+  snprintf(service, sizeof(service), "%u", port);
+  if (getaddrinfo(host, service, &hints, &ai)!=0 || !ai) return false;
+
+  _fd=socket(AF_INET, SOCK_STREAM, 0);
+  if (_fd>=0)
+  {
+    fcntl(_fd, F_SETFL, fcntl(_fd, F_GETFL)|O_NONBLOCK);
+    if (::connect(_fd, ai->ai_addr, ai->ai_addrlen)==0) _state=TCP_CONNECTED;
+    else if (errno==EINPROGRESS) _state=TCP_CONNECTING;
+    else close();
+  }
+  freeaddrinfo(ai);
+  return _fd>=0;
+}
+
+TcpState PosixTcpStream::state()
+{
+  if (_state==TCP_CONNECTING)
+  {
+    pollfd p={_fd, POLLOUT, 0};
+    if (poll(&p, 1, 0)>0)
+    {
+      int err=0;
+      socklen_t len=sizeof(err);
+      getsockopt(_fd, SOL_SOCKET, SO_ERROR, &err, &len);
+      if (err==0) _state=TCP_CONNECTED;
+      else close();
+    }
+  }
+  return _state;
+}
+
+size_t PosixTcpStream::write(const uint8_t *data, size_t len)
+{
+  if (_state!=TCP_CONNECTED) return 0;
+  ssize_t n=send(_fd, data, len, MSG_NOSIGNAL|MSG_DONTWAIT);
+  if (n>=0) return n;
+  if (errno!=EAGAIN && errno!=EWOULDBLOCK) close();
+  return 0;
+}
+
+int PosixTcpStream::read(uint8_t *buf, size_t len)
+{
+  if (_state!=TCP_CONNECTED) return _state==TCP_CLOSED ? -1 : 0;
+  ssize_t n=recv(_fd, buf, len, MSG_DONTWAIT);
+  if (n>0) return n;
+  if (n<0 && (errno==EAGAIN || errno==EWOULDBLOCK)) return 0;
+  close();
+  return -1;
+}
+
+void PosixTcpStream::close()
+{
+  if (_fd>=0) ::close(_fd);
+  _fd=-1;
+  _state=TCP_CLOSED;
+}
+
+//-----------------------------------------------  HTTP ------------------------------------------------------------------------
+
+// head is the request line and the header lines, each ending with CRLF
+HostHttpRequest::HostHttpRequest(HttpMethod method, std::string_view target, std::string_view body,
+  std::string_view head)
+  : _method(method), _body(body), _head(head)
+{
+  size_t q=target.find('?');
+  _path=target.substr(0, q);
+  if (q!=std::string_view::npos) _query=target.substr(q+1);
+}
+
+HttpMethod HostHttpRequest::parseMethod(std::string_view m)
+{
+  if (m=="GET") return HttpMethod::Get;
+  if (m=="POST") return HttpMethod::Post;
+  if (m=="PUT") return HttpMethod::Put;
+  if (m=="DELETE") return HttpMethod::Delete;
+  return HttpMethod::Other;
+}
+
+// name=value pairs of the query, not url decoded
+bool HostHttpRequest::param(const char *name, std::string_view &value)
+{
+  std::string_view key(name);
+  size_t p=0;
+  while (p<=_query.size() && !_query.empty())
+  {
+    size_t e=_query.find('&', p);
+    if (e==std::string_view::npos) e=_query.size();
+    std::string_view pair=_query.substr(p, e-p);
+    size_t eq=pair.find('=');
+    if (pair.substr(0, eq)==key)
+    {
+      value=eq==std::string_view::npos?std::string_view():pair.substr(eq+1);
+      return true;
+    }
+    p=e+1;
+  }
+  return false;
+}
+
+// case insensitive name, the value without leading blanks
+bool HostHttpRequest::header(const char *name, std::string_view &value)
+{
+  size_t len=strlen(name);
+  size_t p=0;
+  while ((p=_head.find("\r\n", p))!=std::string_view::npos)
+  {
+    p+=2;
+    if (_head.size()-p>len && _head[p+len]==':' && strncasecmp(_head.data()+p, name, len)==0)
+    {
+      size_t e=_head.find("\r\n", p);
+      value=_head.substr(p+len+1, e-p-len-1);
+      while (!value.empty() && value.front()==' ') value.remove_prefix(1);
+      return true;
+    }
+  }
+  return false;
+}
+
+void StdioHttpResponse::begin(int code, const char *contentType)
+{
+  status=code;
+  fprintf(_out, "HTTP/1.1 %d\r\nContent-Type: %s\r\n", code, contentType);
+  _inHeaders=true;
+}
+
+void StdioHttpResponse::header(const char *name, const char *value)
+{
+  if (_inHeaders) fprintf(_out, "%s: %s\r\n", name, value);
+}
+
+void StdioHttpResponse::write(const char *s, size_t len)
+{
+  _endHeaders();
+  fwrite(s, 1, len, _out);
+}
+
+// the body follows at end(), after the headers
+void StdioHttpResponse::stream(int code, const char *contentType, HttpFiller fill)
+{
+  begin(code, contentType);
+  _fill=fill;
+}
+
+void StdioHttpResponse::end()
+{
+  _endHeaders();
+  uint8_t buf[1024];
+  size_t index=0;
+  size_t n;
+  while (_fill && (n=_fill(buf, sizeof(buf), index))>0)
+  {
+    fwrite(buf, 1, n, _out);
+    index+=n;
+  }
+  fflush(_out);
+}
+
+void StdioHttpResponse::_endHeaders()
+{
+  if (!_inHeaders) return;
+  fputs("\r\n", _out);
+  _inHeaders=false;
+}
+
+#endif
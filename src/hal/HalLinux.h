@@ -0,0 +1,231 @@
+/* Linux backend of the HAL
+ *
+ * Host clock with a settable epoch, time sync from the host clock, the display as text on stdout,
+ * button events from stdin ('c' click, 'l' long press), GPIO in memory, EEPROM in a file,
+ * the file system in a directory (native_fs) and POSIX UDP and TCP sockets; the host name of a TCP
+ * connection is resolved blocking, the rest of it does not block.
+ * HostHttpRequest and StdioHttpResponse run Http.h handlers without a server.
+ * FileFirmwareWriter writes update images into the directory and checks their MD5 like the Updater.
+ */
+
+#ifndef HalLinux_h
+#define HalLinux_h
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "../Http.h"
+#include "Hal.h"
+#include "EpochCounter.h"
+
+class HostClock : public ClockSource
+{
+  public:
+    HostClock();
+    uint32_t millis() override;
+    uint32_t now() override;
+    uint16_t subSecond() override;
+    void setTime(uint32_t t, uint16_t ms) override;
+
+  private:
+    EpochCounter _epoch;
+};
+
+// the time of the host, which keeps it with NTP; 0 while not available, like an SNTP client without reply
+class HostTimeSync : public TimeSync
+{
+  public:
+    HostTimeSync(uint32_t interval) : _interval(interval) {}
+    uint32_t getEpochTime(uint16_t &ms) override;
+    uint32_t updateInterval() override;
+
+    bool available=true;
+
+  private:
+    uint32_t _interval;
+};
+
+// prints "hh:mm" when the segments change, unknown patterns as '?'
+class TerminalDisplay : public DisplaySink
+{
+  public:
+    TerminalDisplay(FILE *out) : _out(out) {}
+    void setSegments(const uint8_t segments[4]) override;
+    void setBrightness(uint8_t brightness) override;
+    void clear() override;
+
+  private:
+    FILE *_out;
+    uint8_t _last[4]={0xff, 0xff, 0xff, 0xff};
+};
+
+class StdinButton : public ButtonSource
+{
+  public:
+    StdinButton(bool enabled);
+    ButtonEvent poll() override;
+
+  private:
+    bool _enabled;
+};
+
+// prints the pattern that starts and when it stops
+class TerminalBuzzer : public Buzzer
+{
+  public:
+    TerminalBuzzer(FILE *out) : _out(out) {}
+    void play(const TonePattern &pattern) override;
+    void stop() override;
+    bool playing() override;
+
+  private:
+    FILE *_out;
+    bool _playing=false;
+};
+
+class MemoryGpio : public Gpio
+{
+  public:
+    void pinMode(int pin, bool output) override;
+    void write(int pin, bool high) override;
+    bool read(int pin) override;
+    uint32_t writes=0;
+
+  private:
+    uint32_t _levels=0;
+};
+
+class FileKeyValueStore : public KeyValueStore
+{
+  public:
+    FileKeyValueStore(const char *path) : _path(path) {}
+    void begin(size_t size) override;
+    uint8_t read(int adr) override;
+    void write(int adr, uint8_t val) override;
+    bool commit() override;
+
+  private:
+    std::string _path;
+    std::vector<uint8_t> _data;
+};
+
+// <dir>/firmware.bin or filesystem.bin, replaced when end() accepts the image
+class FileFirmwareWriter : public FirmwareWriter
+{
+  public:
+    FileFirmwareWriter(const char *dir, uint32_t space=1024*1024) : _dir(dir), _space(space) {}
+    ~FileFirmwareWriter();
+    bool begin(ImageTarget target) override;
+    bool setMd5(const char *hex) override;
+    size_t write(const uint8_t *data, size_t len) override;
+    bool end() override;
+    void abort() override;
+    const char *error() override {return _error.c_str();}
+
+  private:
+    std::string _dir;
+    uint32_t _space;
+    std::string _path;
+    FILE *_f=nullptr;
+    ImageTarget _target=ImageTarget::Firmware;
+    uint32_t _written=0;
+    std::string _md5;
+    uint32_t _hash[4];
+    uint8_t _block[64];
+    std::string _error;
+
+    bool _fail(const char *error);
+};
+
+class DirFileStore : public FileStore
+{
+  public:
+    DirFileStore(const char *root);
+    bool exists(const char *path) override;
+    int size(const char *path) override;
+    int read(const char *path, uint32_t offset, char *buf, size_t len) override;
+    bool write(const char *path, const char *data, size_t len) override;
+    bool append(const char *path, const char *data, size_t len) override;
+    bool remove(const char *path) override;
+    void list(void (*fn)(void *ctx, const char *name, uint32_t size, uint32_t mtime), void *ctx) override;
+    bool usage(uint32_t &total, uint32_t &used) override;
+
+  private:
+    std::string _root;
+    std::string _full(const char *path);
+};
+
+// iface is the address of the interface of the multicast group, 0 for the default one (127.0.0.1 keeps
+// several instances on the loopback interface)
+class PosixUdpPort : public UdpPort
+{
+  public:
+    PosixUdpPort(uint32_t iface=0) : _iface(iface) {}
+    ~PosixUdpPort();
+    bool begin(uint16_t port) override;
+    bool joinGroup(uint32_t group) override;
+    bool sendTo(uint32_t ip, uint16_t port, const uint8_t *data, size_t len) override;
+    int receive(uint8_t *buf, size_t len, uint32_t *ip, uint16_t *port, uint32_t *at) override;
+
+  private:
+    int _fd=-1;
+    uint32_t _iface;
+};
+
+class PosixTcpStream : public TcpStream
+{
+  public:
+    ~PosixTcpStream();
+    bool connect(const char *host, uint16_t port) override;
+    TcpState state() override;
+    size_t write(const uint8_t *data, size_t len) override;
+    int read(uint8_t *buf, size_t len) override;
+    void close() override;
+
+  private:
+    int _fd=-1;
+    TcpState _state=TCP_CLOSED;
+};
+
+class HostHttpRequest : public HttpRequest
+{
+  public:
+    HostHttpRequest(HttpMethod method, std::string_view target, std::string_view body,
+      std::string_view head=std::string_view());
+    HttpMethod method() override {return _method;}
+    std::string_view path() override {return _path;}
+    bool param(const char *name, std::string_view &value) override;
+    bool header(const char *name, std::string_view &value) override;
+    std::string_view body() override {return _body;}
+    const void *id() override {return this;}
+
+    static HttpMethod parseMethod(std::string_view m);
+
+  private:
+    HttpMethod _method;
+    std::string_view _path;
+    std::string_view _query;
+    std::string_view _body;
+    std::string_view _head;
+};
+
+// writes status line, headers and body as they come
+class StdioHttpResponse : public HttpResponse
+{
+  public:
+    StdioHttpResponse(FILE *out) : _out(out) {}
+    void begin(int status, const char *contentType) override;
+    void header(const char *name, const char *value) override;
+    void write(const char *s, size_t len) override;
+    void stream(int status, const char *contentType, HttpFiller fill) override;
+    void end();
+    int status=0;
+
+  private:
+    void _endHeaders();
+    FILE *_out;
+    bool _inHeaders=false;
+    HttpFiller _fill;
+};
+
+#endif
@@ -0,0 +1,109 @@
+#include "LedSequencer.h"
+
+// false if the queue is full, queuing a pattern again replaces its entry
+bool LedSequencer::play(const LedPattern *pattern, uint8_t priority, uint8_t cycles)
+{
+  cancel(pattern);
+  if (_count>=LEDQUEUE || pattern->count==0) return false;
+  _queue[_count++]={pattern, priority, cycles};
+  return true;
+}
+
+bool LedSequencer::code(uint8_t n, uint8_t priority, uint8_t cycles)
+{
+  if (n<1) n=1;
+  if (n>LEDMAXCODE) n=LEDMAXCODE;
+  for (int i=0; i<n; i++)
+  {
+    _codeSteps[2*i]=LEDCODEON;
+    _codeSteps[2*i+1]=i<n-1?LEDCODEOFF:LEDCODEPAUSE;
+  }
+  _code.count=2*n;
+  if (_current==&_code) _current=nullptr;    // the steps changed, start over
+  return play(&_code, priority, cycles);
+}
+
+void LedSequencer::cancel(const LedPattern *pattern)
+{
+  for (int i=0; i<_count; i++)
+  {
+    if (_queue[i].pattern==pattern)
+    {
+      _remove(i);
+      return;
+    }
+  }
+}
+
+void LedSequencer::cancelCode()
+{
+  cancel(&_code);
+}
+
+void LedSequencer::clear()
+{
+  _count=0;
+}
+
+// the pattern to play is not the one playing, the driver has to restart with next()
+bool LedSequencer::changed() const
+{
+  int i=_top();
+  return (i<0?nullptr:_queue[i].pattern)!=_current;
+}
+
+// level of the LED and ms until the next call, 0 when there is nothing to play
+uint32_t LedSequencer::next(bool &level)
+{
+  for (;;)
+  {
+    level=false;
+    int i=_top();
+    if (i<0)
+    {
+      _current=nullptr;
+      return 0;
+    }
+
+    Entry &e=_queue[i];
+    if (e.pattern!=_current)
+    {
+      _current=e.pattern;
+      _step=0;
+      _lit=false;
+    }
+
+    while (_step<_current->count)
+    {
+      uint8_t d=_current->steps[_step];
+      level=(_step&1)==0;
+      _step++;
+      if (d>0)
+      {
+        _lit=true;
+        return d*LEDUNIT;
+      }
+    }
+
+    // end of a cycle, a pattern without any duration is dropped as well
+    _step=0;
+    if (!_lit || (e.cycles>0 && --e.cycles==0)) _remove(i);
+    _lit=false;
+  }
+}
+
+int LedSequencer::_top() const
+{
+  int top=-1;
+  for (int i=0; i<_count; i++)
+  {
+    if (top<0 || _queue[i].priority>=_queue[top].priority) top=i;
+  }
+  return top;
+}
+
+void LedSequencer::_remove(int i)
+{
+  for (; i<_count-1; i++) _queue[i]=_queue[i+1];
+  _count--;
+}
@@ -0,0 +1,63 @@
+/* LED signal sequencer
+ *
+ * A LedPattern is a list of durations in LEDUNIT ms, alternately on and off, starting with on. Up to LEDQUEUE
+ * patterns are queued, each with a priority and a number of cycles (0 = until cancelled). The one with the
+ * highest priority plays, among equal ones the latest queued; a preempted pattern starts over on its next turn.
+ * code() queues a blink code: n blinks and a pause.
+ * next() returns the level and how long it lasts, the driver sets the LED and arms a one-shot timer with that
+ * time. With an empty queue next() returns 0 and nothing is armed. Works on the host as well (bench).
+ */
+
+#ifndef LedSequencer_h
+#define LedSequencer_h
+
+#include <stdint.h>
+
+#define LEDUNIT 20          // ms per step
+#define LEDQUEUE 4
+#define LEDMAXCODE 9        // blinks of the longest code
+
+#define LEDCODEON 15        // steps of a code blink
+#define LEDCODEOFF 15
+#define LEDCODEPAUSE 75
+
+struct LedPattern
+{
+  const char *name;
+  const uint8_t *steps;     // on, off, on, ... in LEDUNIT
+  uint8_t count;
+};
+
+class LedSequencer
+{
+  public:
+    bool play(const LedPattern *pattern, uint8_t priority, uint8_t cycles=0);
+    bool code(uint8_t n, uint8_t priority, uint8_t cycles=0);
+    void cancel(const LedPattern *pattern);
+    void cancelCode();
+    void clear();
+    bool changed() const;
+    const LedPattern *current() const {return _current;}
+    uint32_t next(bool &level);
+
+  private:
+    struct Entry
+    {
+      const LedPattern *pattern;
+      uint8_t priority;
+      uint8_t cycles;       // left, 0 = until cancelled
+    };
+
+    int _top() const;
+    void _remove(int i);
+
+    Entry _queue[LEDQUEUE];
+    uint8_t _count=0;
+    const LedPattern *_current=nullptr;
+    uint8_t _step=0;
+    bool _lit=false;        // the cycle so far had a step of nonzero length
+    uint8_t _codeSteps[2*LEDMAXCODE];
+    LedPattern _code={"code", _codeSteps, 0};
+};
+
+#endif
@@ -0,0 +1,26 @@
+/* Platform shims
+ *
+ * Lets the host independent modules use the flash string and IRAM macros of the ESP8266 core.
+ * On the host flash and RAM are the same and the macros fall back to plain C.
+ */
+
+#ifndef Platform_h
+#define Platform_h
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <string.h>
+#include <stdint.h>
+#define PROGMEM
+#define IRAM_ATTR
+#define PSTR(s) (s)
+#define PGM_P const char *
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+#define pgm_read_dword(p) (*(const uint32_t *)(p))
+#define memcpy_P memcpy
+#define strlen_P strlen
+#define vsnprintf_P vsnprintf
+#endif
+
+#endif
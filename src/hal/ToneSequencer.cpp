@@ -0,0 +1,80 @@
+#include "ToneSequencer.h"
+
+// not while the timer runs
+void ToneSequencer::start(const TonePattern *pattern)
+{
+  _index=0xff;                // the first next() steps to 0
+  _stepLeft=0;
+  _low=0;
+  _pattern=pattern->count>0?pattern:nullptr;
+}
+
+void ToneSequencer::stop()
+{
+  _pattern=nullptr;
+}
+
+void IRAM_ATTR ToneSequencer::_load()
+{
+  const ToneStep &s=_pattern->steps[_index];
+  _stepLeft=s.ms*1000UL;
+  _low=0;
+  if (s.freq==0 || s.freq==TONE_DC)
+  {
+    _period=0;
+    return;
+  }
+  _period=1000000UL/s.freq;
+  _duty=(int32_t)s.duty*256/100*65536;
+  int32_t periods=_stepLeft/_period;
+  _slope=periods>0?((int32_t)s.dutyEnd-s.duty)*256/100*65536/periods:0;      // negative when it falls, so no shift
+}
+
+// level of the pin and us until the next call, 0 when the pattern has ended
+uint32_t IRAM_ATTR ToneSequencer::next(bool &level)
+{
+  level=false;
+  const TonePattern *pattern=_pattern;
+  if (!pattern) return 0;
+
+  if (_low)
+  {
+    uint32_t t=_low;
+    _low=0;
+    return t;
+  }
+
+  for (int n=0; _stepLeft==0; n++)
+  {
+    if (++_index>=pattern->count)
+    {
+      if (!pattern->repeat || n>pattern->count)
+      {
+        _pattern=nullptr;
+        return 0;
+      }
+      _index=0;
+    }
+    _load();
+  }
+
+  if (_period==0)
+  {
+    level=pattern->steps[_index].freq==TONE_DC;
+    uint32_t t=_stepLeft<TONEMAXSLICE?_stepLeft:TONEMAXSLICE;
+    _stepLeft-=t;
+    return t;
+  }
+
+  uint32_t period=_period<_stepLeft?_period:_stepLeft;
+  int32_t duty=_duty>>16;
+  uint32_t high=(period*(uint32_t)(duty>0?duty:0))>>8;
+  _duty+=_slope;
+  _stepLeft-=period;
+
+  if (high<TONEMINPHASE) return period;
+  level=true;
+  if (period-high<TONEMINPHASE) return period;
+  _low=period-high;
+  return high;
+}
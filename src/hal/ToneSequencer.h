@@ -0,0 +1,37 @@
+/* Tone sequencer
+ *
+ * Turns a TonePattern into the timing of the buzzer pin: next() returns the level and how long it lasts,
+ * the timer interrupt sets the pin and rearms itself with that time. All divisions happen once per step,
+ * a call per edge costs a few multiplications and shifts. Works on the host as well (bench, sim).
+ */
+
+#ifndef ToneSequencer_h
+#define ToneSequencer_h
+
+#include "Hal.h"
+#include "Platform.h"
+
+#define TONEMAXSLICE 1000000    // us, longest single interval (timer1 reaches 1.6 s)
+#define TONEMINPHASE 10         // us, shorter high or low phases are merged into the period
+
+class ToneSequencer
+{
+  public:
+    void start(const TonePattern *pattern);
+    void stop();
+    bool playing() const {return _pattern!=nullptr;}
+    uint32_t next(bool &level);
+
+  private:
+    void _load();
+
+    const TonePattern *volatile _pattern=nullptr;
+    uint8_t _index=0;
+    uint32_t _stepLeft=0;       // us
+    uint32_t _period=0;         // us, 0 for silence and TONE_DC
+    int32_t _duty=0;            // 0..256 << 16
+    int32_t _slope=0;           // duty change per period
+    uint32_t _low=0;            // us of the low phase still to come
+};
+
+#endif
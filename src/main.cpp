@@ -5,21 +5,22 @@
 #define CLK_PIN 0
 
 ESPClock *espclock;
-long previousMillis = 0;
-const long interval = 500;
 
 void setup() {
-  espclock = new ESPClock(true, DIO_PIN, CLK_PIN, BUTTON_PIN, BUZZER_PIN);
+  bootProfile.mark("setup");
+  espclock = new ESPClock(DIO_PIN, CLK_PIN, BUTTON_PIN, BUZZER_PIN);
+  bootProfile.setupDone();
 }
 
 void loop() {
+  stallWatch.loopStart();
   espclock->loop();
   espclock->button_tick();
+  espclock->timer_tick();
 
-  unsigned long currentMillis = millis();
-
-  if (currentMillis - previousMillis >= interval) {
-    previousMillis = currentMillis;
+  if (espclock->displayDue()) {
     espclock->doDisplay();
   }
+  stallWatch.loopEnd();
+  espclock->idle();
 }
@@ -0,0 +1,95 @@
+/* Host runner for the native environment
+ *
+ *   program                              runs the clock, display on stdout, 'c'/'l'/'d' + enter on stdin press the button
+ *   program -r METHOD PATH [BODY]        runs one request through the clock endpoints and prints the response
+ *   program -m HOST[:PORT] [TOPIC]       runs the clock with its MQTT interface on that broker (see ClockMqtt.h),
+ *                                        TOPIC defaults to espclock/native
+ *   program -p ID KEY [--no-ntp] [--iface ADDR]
+ *                                        runs the clock with peer time sync (see PeerSync.h) as clock ID (hex) with the
+ *                                        passphrase KEY; --no-ntp leaves it without a time of its own, --iface 127.0.0.1
+ *                                        keeps the multicast group on loopback. Run the instances in separate directories
+ *
+ * Files live in ./native_fs, the EEPROM in ./native_fs.eeprom
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include "../hal/HalLinux.h"
+#include "../ClockCore.h"
+#include "../ClockApi.h"
+#include "../ClockMqtt.h"
+#include "../PeerSync.h"
+
+// pio test builds the sources of this environment with the main() of each test
+#ifndef PIO_UNIT_TESTING
+
+int main(int argc, char **argv) {
+  bool request = argc >= 4 && strcmp(argv[1], "-r") == 0;
+  bool mqtt = argc >= 3 && strcmp(argv[1], "-m") == 0;
+  bool peer = argc >= 4 && strcmp(argv[1], "-p") == 0;
+  bool ntp = true;
+  uint32_t iface = 0;
+  for (int i = 4; peer && i < argc; i++) {
+    if (!strcmp(argv[i], "--no-ntp")) ntp = false;
+    else if (!strcmp(argv[i], "--iface") && i + 1 < argc) iface = inet_addr(argv[++i]);
+  }
+
+  HostClock clock;
+  HostTimeSync timeSync(1800000);
+  timeSync.available = ntp;
+  TerminalDisplay display(request ? stderr : stdout);
+  StdinButton button(!request);
+  TerminalBuzzer buzzer(request ? stderr : stdout);
+  MemoryGpio gpio;
+  FileKeyValueStore kv("native_fs.eeprom");
+  DirFileStore files("native_fs");
+  PosixUdpPort udp(iface);
+  PeerSync peerSync(clock, udp, timeSync);
+  Hal hal{clock, peerSync, display, button, buzzer, gpio, kv, files, udp};
+
+  ClockCore core(hal);
+  ClockApi api(core);
+  core.begin();
+
+  PosixTcpStream tcp;
+  MqttClient mqttClient(tcp);
+  ClockMqtt clockMqtt(core, mqttClient);
+  if (mqtt) {
+    char host[64];
+    snprintf(host, sizeof(host), "%s", argv[2]);
+    char *port = strchr(host, ':');
+    if (port) *port++ = 0;
+    clockMqtt.begin(host, port ? atoi(port) : 1883, argc > 3 ? argv[3] : "espclock/native", "espclock-native");
+  }
+
+  if (peer) {
+    peerSync.upstreamActive = [&timeSync, ntp](bool on) { timeSync.available = on && ntp; };
+    if (!peerSync.begin(strtoul(argv[2], nullptr, 16), argv[3])) return 1;
+  }
+
+  if (request) {
+    HostHttpRequest req(HostHttpRequest::parseMethod(argv[2]), argv[3], argc > 4 ? argv[4] : "");
+    StdioHttpResponse res(stdout);
+    if (!api.handle(req, res)) {
+      res.begin(404, "text/plain");
+      res.print("not found");
+    }
+    res.end();
+    printf("\n");
+    return res.status == 200 ? 0 : 1;
+  }
+
+  while (true) {
+    core.pollButton();
+    core.pollTimer();
+    if (core.tickDue()) core.tick();
+    if (mqtt) clockMqtt.loop();
+    peerSync.loop();
+    usleep(10000);
+  }
+}
+
+#endif
@@ -0,0 +1,133 @@
+#include "SimHal.h"
+#include <string.h>
+
+// device ms, drift applied to the true time
+uint32_t SimClock::millis()
+{
+  return (uint32_t)(_w.trueMs+(int64_t)_w.trueMs*_w.driftPpm/1000000);
+}
+
+uint32_t SimClock::now()
+{
+  return _epoch.now(millis());
+}
+
+uint16_t SimClock::subSecond()
+{
+  return _epoch.subSecond(millis());
+}
+
+void SimClock::setTime(uint32_t t, uint16_t ms)
+{
+  int64_t before=(int64_t)now()*1000+subSecond();
+  _w.record(SIM_STEP, (uint32_t)((int64_t)t*1000+ms-before));
+  _epoch.set(t, ms, millis());
+}
+
+uint32_t SimTimeSync::getEpochTime(uint16_t &ms)
+{
+  if (std::uniform_real_distribution<double>(0, 1)(_w.rng)<_w.ntpLoss)
+  {
+    _w.record(SIM_SYNCLOST, 0);
+    return 0;
+  }
+  uint32_t t=_w.trueEpoch()+_w.ntpOffset;
+  ms=_w.trueMs%1000;
+  _w.record(SIM_SYNC, t);
+  return t;
+}
+
+uint32_t SimTimeSync::updateInterval()
+{
+  return _interval;
+}
+
+void SimDisplay::setSegments(const uint8_t segments[4])
+{
+  uint32_t v=segments[0]|(segments[1]<<8)|(segments[2]<<16)|((uint32_t)segments[3]<<24);
+  if (v==_last) return;
+  _last=v;
+  _w.record(SIM_FRAME, v);
+}
+
+void SimDisplay::clear()
+{
+  static const uint8_t blank[4]={0, 0, 0, 0};
+  setSegments(blank);
+}
+
+void SimBuzzer::play(const TonePattern &pattern)
+{
+  if (!_playing) _w.record(SIM_BUZZER, 1);
+  _playing=true;
+}
+
+void SimBuzzer::stop()
+{
+  if (_playing) _w.record(SIM_BUZZER, 0);
+  _playing=false;
+}
+
+void SimGpio::write(int pin, bool high)
+{
+  uint32_t bit=1u<<(pin&31);
+  if (high) _levels|=bit;
+  else _levels&=~bit;
+}
+
+bool SimGpio::read(int pin)
+{
+  return _levels&(1u<<(pin&31));
+}
+
+bool MemFileStore::exists(const char *path)
+{
+  return _files.count(path)>0;
+}
+
+int MemFileStore::size(const char *path)
+{
+  auto it=_files.find(path);
+  return it==_files.end()?-1:(int)it->second.size();
+}
+
+int MemFileStore::read(const char *path, uint32_t offset, char *buf, size_t len)
+{
+  auto it=_files.find(path);
+  if (it==_files.end()) return -1;
+  if (offset>=it->second.size()) return 0;
+  size_t n=it->second.size()-offset;
+  if (n>len) n=len;
+  memcpy(buf, it->second.data()+offset, n);
+  return n;
+}
+
+bool MemFileStore::write(const char *path, const char *data, size_t len)
+{
+  _files[path].assign(data, len);
+  return true;
+}
+
+bool MemFileStore::append(const char *path, const char *data, size_t len)
+{
+  _files[path].append(data, len);
+  return true;
+}
+
+bool MemFileStore::remove(const char *path)
+{
+  return _files.erase(path)>0;
+}
+
+void MemFileStore::list(void (*fn)(void *ctx, const char *name, uint32_t size, uint32_t mtime), void *ctx)
+{
+  for (auto &f : _files) fn(ctx, f.first.c_str()+(f.first[0]=='/'), f.second.size(), 0);
+}
+
+bool MemFileStore::usage(uint32_t &total, uint32_t &used)
+{
+  used=0;
+  for (auto &f : _files) used+=f.second.size();
+  total=1024*1024;
+  return true;
+}
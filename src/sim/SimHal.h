@@ -0,0 +1,150 @@
+/* Virtual time backend of the HAL for the simulator
+ *
+ * SimWorld holds the true time in ms. The device clock runs drift ppm fast (or slow) against it
+ * and wraps at 2^32 ms like millis(), the epoch is counted on it like on the ESP8266 (EpochCounter).
+ * NTP replies are the true time to the ms plus a fixed offset, a share of them is lost.
+ * Display frames, buzzer starts and stops, sync events and clock steps are recorded with the true time,
+ * the runner consumes and clears SimWorld::events after every loop iteration.
+ */
+
+#ifndef SimHal_h
+#define SimHal_h
+
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#include "../hal/Hal.h"
+#include "../hal/EpochCounter.h"
+
+enum SimEventKind { SIM_FRAME, SIM_BUZZER, SIM_SYNC, SIM_SYNCLOST, SIM_STEP, SIM_ALARM, SIM_CLICK, SIM_TIMER };
+
+struct SimEvent
+{
+  uint64_t trueMs;
+  SimEventKind kind;
+  uint32_t value;      // frame: 4 segments, buzzer: playing, sync: reply, step: ms (signed), alarm: on, timer: ms late (signed)
+};
+
+struct SimWorld
+{
+  uint64_t trueMs=0;
+  uint32_t startEpoch=0;     // true UTC epoch at trueMs 0
+  int32_t driftPpm=0;
+  int32_t ntpOffset=0;       // s, error of the NTP replies
+  double ntpLoss=0;          // 0..1
+  std::mt19937 rng;
+  std::vector<SimEvent> events;
+
+  uint32_t trueEpoch() {return startEpoch+trueMs/1000;}
+  void record(SimEventKind kind, uint32_t value) {events.push_back({trueMs, kind, value});}
+};
+
+class SimClock : public ClockSource
+{
+  public:
+    SimClock(SimWorld &w) : _w(w) {}
+    uint32_t millis() override;
+    uint32_t now() override;
+    uint16_t subSecond() override;
+    void setTime(uint32_t t, uint16_t ms) override;
+
+  private:
+    SimWorld &_w;
+    EpochCounter _epoch;
+};
+
+class SimTimeSync : public TimeSync
+{
+  public:
+    SimTimeSync(SimWorld &w, uint32_t interval) : _w(w), _interval(interval) {}
+    uint32_t getEpochTime(uint16_t &ms) override;
+    uint32_t updateInterval() override;
+
+  private:
+    SimWorld &_w;
+    uint32_t _interval;
+};
+
+class SimDisplay : public DisplaySink
+{
+  public:
+    SimDisplay(SimWorld &w) : _w(w) {}
+    void setSegments(const uint8_t segments[4]) override;
+    void setBrightness(uint8_t brightness) override {}
+    void clear() override;
+
+  private:
+    SimWorld &_w;
+    uint32_t _last=0xffffffff;
+};
+
+// clicks are injected by the runner through ClockCore
+class SimButton : public ButtonSource
+{
+  public:
+    ButtonEvent poll() override {return BUTTON_NONE;}
+};
+
+class SimBuzzer : public Buzzer
+{
+  public:
+    SimBuzzer(SimWorld &w) : _w(w) {}
+    void play(const TonePattern &pattern) override;
+    void stop() override;
+    bool playing() override {return _playing;}
+
+  private:
+    SimWorld &_w;
+    bool _playing=false;
+};
+
+class SimGpio : public Gpio
+{
+  public:
+    void pinMode(int pin, bool output) override {}
+    void write(int pin, bool high) override;
+    bool read(int pin) override;
+
+  private:
+    uint32_t _levels=0;
+};
+
+class MemKeyValueStore : public KeyValueStore
+{
+  public:
+    void begin(size_t size) override {_data.assign(size, 0xff);}
+    uint8_t read(int adr) override {return (size_t)adr<_data.size()?_data[adr]:0;}
+    void write(int adr, uint8_t val) override {if ((size_t)adr<_data.size()) _data[adr]=val;}
+    bool commit() override {return true;}
+
+  private:
+    std::vector<uint8_t> _data;
+};
+
+class MemFileStore : public FileStore
+{
+  public:
+    bool exists(const char *path) override;
+    int size(const char *path) override;
+    int read(const char *path, uint32_t offset, char *buf, size_t len) override;
+    bool write(const char *path, const char *data, size_t len) override;
+    bool append(const char *path, const char *data, size_t len) override;
+    bool remove(const char *path) override;
+    void list(void (*fn)(void *ctx, const char *name, uint32_t size, uint32_t mtime), void *ctx) override;
+    bool usage(uint32_t &total, uint32_t &used) override;
+
+  private:
+    std::map<std::string, std::string> _files;
+};
+
+class NullUdpPort : public UdpPort
+{
+  public:
+    bool begin(uint16_t port) override {return true;}
+    bool joinGroup(uint32_t group) override {return true;}
+    bool sendTo(uint32_t ip, uint16_t port, const uint8_t *data, size_t len) override {return true;}
+    int receive(uint8_t *buf, size_t len, uint32_t *ip, uint16_t *port, uint32_t *at) override {return -1;}
+};
+
+#endif
@@ -0,0 +1,291 @@
+/* Virtual time simulator for the clock and alarm logic
+ *
+ * Runs ClockCore like src/main.cpp does (tick at the start and in the middle of every second of the clock) on a
+ * virtual clock, weeks of operation take seconds. Prints key=value results, --trace writes every event as CSV.
+ *
+ *   --days n         simulated days (7)
+ *   --loop ms        loop() period (10)
+ *   --drift ppm      device clock error (0)
+ *   --offset s       error of the NTP replies (0)
+ *   --loss p         share of lost NTP replies, 0..1 (0)
+ *   --interval ms    NTP update interval (1800000)
+ *   --start epoch    true UTC at the start (2026-01-01 00:00), the clock runs in the zone UTC
+ *   --alarm hhmm     daily alarm, -1 for none (700)
+ *   --dismiss s      button click after the alarm went on (30)
+ *   --stall s        loop() blocked for s seconds from 30 s before every alarm (0)
+ *   --idle 1         sleep between deadlines like ESPClock::idle(), ticks the core does not need are left out
+ *   --timer s        countdown of s seconds, run in the background while the clock is shown, again a minute
+ *                    after each expiry (0)
+ *   --seed n         random seed (1)
+ *   --trace file     CSV true_ms,event,value
+ *
+ * display lateness: true time when a new minute is shown minus the true start of that minute
+ * refresh lateness: the core's own measure, device ms from the boundary of its second to the tick
+ * timer lateness: true time when the countdown rings minus the true start plus its length, drift included
+ * alarm lateness: true time when the alarm goes on minus the true alarm time
+ * An alarm counts as missed if it does not go on within 2 minutes (plus the stall) of its time.
+ * core_alarms_* are the counters of the AlarmScheduler itself, ticks counts the calls of tick().
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "SimHal.h"
+#include "../ClockCore.h"
+
+struct Stats {
+  uint32_t n = 0;
+  int64_t sum = 0;
+  int64_t min = 0;
+  int64_t max = 0;
+
+  void add(int64_t v) {
+    if (n == 0 || v < min) min = v;
+    if (n == 0 || v > max) max = v;
+    sum += v;
+    n++;
+  }
+  void print(const char *name) {
+    printf("%s.n=%u\n%s.min=%lld\n%s.max=%lld\n%s.mean=%.1f\n", name, n, name, (long long)min, name, (long long)max,
+      name, n ? (double)sum / n : 0.0);
+  }
+};
+
+static const char *EVENTNAMES[] = { "frame", "buzzer", "sync", "synclost", "step", "alarm", "click", "timer" };
+
+// minute of the day shown by a clock frame, -1 for anything else
+static int shownMinute(uint32_t v) {
+  int d[4];
+  for (int i = 0; i < 4; i++) {
+    uint8_t seg = (v >> (8 * i)) & 0x7f;
+    d[i] = -1;
+    if (i == 0 && seg == 0) d[i] = 0;
+    for (int k = 0; k < 10; k++) if (ClockCore::encodeDigit(k) == seg) d[i] = k;
+    if (d[i] < 0) return -1;
+  }
+  int hours = d[0] * 10 + d[1];
+  int minutes = d[2] * 10 + d[3];
+  if (hours > 23 || minutes > 59) return -1;
+  return hours * 60 + minutes;
+}
+
+int main(int argc, char **argv) {
+  uint32_t days = 7;
+  uint32_t loopMs = 10;
+  uint32_t interval = 1800000;
+  int alarm = 700;
+  uint32_t dismiss = 30;
+  uint32_t stall = 0;
+  bool idle = false;
+  uint32_t timerS = 0;
+  uint32_t seed = 1;
+  const char *traceName = nullptr;
+
+  SimWorld world;
+  world.startEpoch = 1767225600;
+
+  for (int i = 1; i + 1 < argc; i += 2) {
+    const char *o = argv[i];
+    const char *v = argv[i + 1];
+    if (!strcmp(o, "--days")) days = atoi(v);
+    else if (!strcmp(o, "--loop")) loopMs = atoi(v);
+    else if (!strcmp(o, "--drift")) world.driftPpm = atoi(v);
+    else if (!strcmp(o, "--offset")) world.ntpOffset = atoi(v);
+    else if (!strcmp(o, "--loss")) world.ntpLoss = atof(v);
+    else if (!strcmp(o, "--interval")) interval = atoi(v);
+    else if (!strcmp(o, "--start")) world.startEpoch = strtoul(v, nullptr, 10);
+    else if (!strcmp(o, "--alarm")) alarm = atoi(v);
+    else if (!strcmp(o, "--dismiss")) dismiss = atoi(v);
+    else if (!strcmp(o, "--stall")) stall = atoi(v);
+    else if (!strcmp(o, "--idle")) idle = atoi(v) != 0;
+    else if (!strcmp(o, "--timer")) timerS = atoi(v);
+    else if (!strcmp(o, "--seed")) seed = atoi(v);
+    else if (!strcmp(o, "--trace")) traceName = v;
+    else {
+      fprintf(stderr, "unknown option %s\n", o);
+      return 2;
+    }
+  }
+  if (loopMs == 0) loopMs = 1;
+  world.rng.seed(seed);
+
+  FILE *trace = nullptr;
+  if (traceName) {
+    trace = fopen(traceName, "w");
+    if (!trace) {
+      perror(traceName);
+      return 2;
+    }
+    fprintf(trace, "true_ms,event,value\n");
+  }
+
+  SimClock clock(world);
+  SimTimeSync timeSync(world, interval);
+  SimDisplay display(world);
+  SimButton button;
+  SimBuzzer buzzer(world);
+  SimGpio gpio;
+  MemKeyValueStore kv;
+  MemFileStore files;
+  NullUdpPort udp;
+  Hal hal{clock, timeSync, display, button, buzzer, gpio, kv, files, udp};
+
+  ClockCore core(hal);
+  core.begin();
+  JsonDocument cfg;
+  cfg["timezone"] = "UTC";
+  if (alarm >= 0) {
+    JsonObject a = cfg["alarms"].add<JsonObject>();
+    a["time"] = alarm;
+  }
+  core.updateConfig(cfg.as<JsonObjectConst>());
+
+  const uint64_t dayMs = 86400000ULL;
+  const uint64_t endMs = days * dayMs;
+  const uint64_t startMs = (uint64_t)world.startEpoch * 1000;
+  const uint64_t alarmOfDay = alarm >= 0 ? (uint64_t)((alarm / 100) * 60 + alarm % 100) * 60000 : 0;
+
+  Stats displayLate, alarmLate, steps, timerLate;
+  uint32_t frames = 0, minuteChanges = 0, minuteJumps = 0, syncs = 0, syncsLost = 0, buzzerStarts = 0;
+  uint32_t alarmsExpected = 0, alarmsFired = 0, alarmsMissed = 0, alarmsExtra = 0;
+  int lastMinute = -1;
+  bool clockSet = false;
+  bool alarmWasOn = false;
+  uint64_t alarmOnAt = 0;
+  uint64_t nextAlarm = 0;        // true ms of the next expected alarm, 0 if none
+  bool nextAlarmFired = false;
+  uint32_t sleepUntil = clock.millis();
+  uint32_t ticks = 0;
+  uint64_t timerStart = 3600000;    // true ms of the next countdown
+  uint64_t timerDue = 0;            // true ms it should ring, 0 while none runs
+  uint32_t timersStarted = 0, timersExpired = 0;
+
+  if (alarm >= 0) {
+    uint64_t t = ((startMs / dayMs) * dayMs + alarmOfDay);
+    while (t < startMs + 2000) t += dayMs;   // the clock needs its first sync
+    nextAlarm = t - startMs;
+  }
+
+  const uint64_t stallMs = stall * 1000ULL;
+  const uint64_t window = 120000 + stallMs;
+
+  for (world.trueMs = 0; world.trueMs < endMs; world.trueMs += loopMs) {
+    bool stalled = nextAlarm && world.trueMs + 30000 >= nextAlarm && world.trueMs + 30000 < nextAlarm + stallMs;
+
+    if (!stalled && (int32_t)(clock.millis() - sleepUntil) >= 0) {
+      core.pollButton();
+      core.pollTimer();
+
+      if (core.timerStats().expired != timersExpired) {
+        timersExpired = core.timerStats().expired;
+        world.record(SIM_TIMER, (int32_t)(world.trueMs - timerDue));
+        timerLate.add((int64_t)world.trueMs - (int64_t)timerDue);
+        core.click();       // silences it
+        core.longPress();   // back to the clock
+        timerStart = world.trueMs + 60000;
+        timerDue = 0;
+      }
+      if (timerS && !timerDue && world.trueMs >= timerStart && !core.alarmOn()) {
+        core.countdown(timerS * 1000);
+        core.longPress();
+        timerDue = world.trueMs + timerS * 1000ULL;
+        timersStarted++;
+      }
+
+      uint32_t currentMillis = clock.millis();
+      if (core.tickDue()) {
+        core.tick();
+        ticks++;
+      }
+
+      if (idle) {
+        uint32_t wait = core.tickIn();
+        uint32_t skip = core.idleTime();
+        sleepUntil = currentMillis + (skip > wait ? skip : wait);
+      }
+    }
+
+    bool alarmOn = core.alarmOn();
+    if (alarmOn && !alarmWasOn) {
+      world.record(SIM_ALARM, 1);
+      alarmOnAt = world.trueMs;
+    }
+    if (alarmOn && world.trueMs - alarmOnAt >= dismiss * 1000ULL) {
+      world.record(SIM_CLICK, 0);
+      core.click();
+      alarmOn = core.alarmOn();
+      sleepUntil = clock.millis();     // the button interrupt wakes the loop
+    }
+    alarmWasOn = alarmOn;
+
+    if (nextAlarm && world.trueMs >= nextAlarm + window) {
+      alarmsExpected++;
+      if (!nextAlarmFired) alarmsMissed++;
+      nextAlarm += dayMs;
+      nextAlarmFired = false;
+    }
+
+    for (const SimEvent &e : world.events) {
+      if (trace) fprintf(trace, "%llu,%s,%d\n", (unsigned long long)e.trueMs, EVENTNAMES[e.kind], (int32_t)e.value);
+
+      switch (e.kind) {
+        case SIM_FRAME: {
+          frames++;
+          int m = shownMinute(e.value);
+          if (m < 0 || m == lastMinute) break;
+          if (lastMinute >= 0) {
+            minuteChanges++;
+            if (m != (lastMinute + 1) % 1440) minuteJumps++;
+            int64_t late = (int64_t)((startMs + e.trueMs) % dayMs) - (int64_t)m * 60000;
+            if (late > (int64_t)dayMs / 2) late -= dayMs;
+            if (late <= -(int64_t)dayMs / 2) late += dayMs;
+            displayLate.add(late);
+          }
+          lastMinute = m;
+        } break;
+
+        case SIM_BUZZER: if (e.value) buzzerStarts++; break;
+        case SIM_SYNC: syncs++; break;
+        case SIM_SYNCLOST: syncsLost++; break;
+        case SIM_STEP: {
+          if (clockSet) steps.add((int32_t)e.value);    // not the first set from 1970
+          clockSet = true;
+        } break;
+
+        case SIM_ALARM: {
+          if (nextAlarm && !nextAlarmFired && e.trueMs + 120000 >= nextAlarm && e.trueMs < nextAlarm + window) {
+            alarmsFired++;
+            nextAlarmFired = true;
+            alarmLate.add((int64_t)e.trueMs - (int64_t)nextAlarm);
+          } else
+            alarmsExtra++;
+        } break;
+
+        default: break;
+      }
+    }
+    world.events.clear();
+  }
+
+  if (trace) fclose(trace);
+
+  printf("days=%u\nloop_ms=%u\ndrift_ppm=%d\nntp_offset_s=%d\nntp_loss=%.3f\n", days, loopMs, world.driftPpm,
+    world.ntpOffset, world.ntpLoss);
+  printf("ticks=%u\nframes=%u\nminute_changes=%u\nminute_jumps=%u\n", ticks, frames, minuteChanges, minuteJumps);
+  displayLate.print("display_late_ms");
+  const RefreshStats &refresh = core.refreshStats();
+  printf("refresh_late=%u\nrefresh_maxlate_ms=%u\nrefresh_meanlate_ms=%.1f\n", refresh.late, refresh.maxLate,
+    refresh.count ? (double)refresh.sumLate / refresh.count : 0.0);
+  printf("syncs=%u\nsyncs_lost=%u\n", syncs, syncsLost);
+  steps.print("step_ms");
+  printf("buzzer_starts=%u\nalarms_expected=%u\nalarms_fired=%u\nalarms_missed=%u\nalarms_extra=%u\n", buzzerStarts,
+    alarmsExpected, alarmsFired, alarmsMissed, alarmsExtra);
+  alarmLate.print("alarm_late_ms");
+  printf("timers_started=%u\ntimers_expired=%u\n", timersStarted, timersExpired);
+  timerLate.print("timer_late_ms");
+  printf("core_timer_maxlate_ms=%u\n", core.timerStats().maxLate);
+  const AlarmStats &coreStats = core.alarms().stats();
+  printf("core_alarms_fired=%u\ncore_alarms_late=%u\ncore_alarms_missed=%u\ncore_alarms_maxlate_s=%u\ncore_backsteps=%u\n",
+    coreStats.fired, coreStats.late, coreStats.missed, coreStats.maxLate, coreStats.backSteps);
+  return alarmsMissed == 0 && alarmsExtra == 0 ? 0 : 1;
+}
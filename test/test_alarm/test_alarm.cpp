@@ -0,0 +1,107 @@
+/* AlarmScheduler: catch-up, missed alarms, clock steps and one-shot alarms
+ *
+ *   pio test -e native
+ */
+
+#include <unity.h>
+#include "../../src/AlarmScheduler.h"
+
+static const uint32_t MONDAY = 1704067200;         // 1.1.2024 00:00
+static const uint32_t DEADLINE = MONDAY + 7 * 3600L; // 07:00
+
+static AlarmScheduler scheduler;
+
+void setUp() {
+    scheduler = AlarmScheduler();
+    Alarm alarm;
+    alarm.time = 700;
+    alarm.active = true;
+    scheduler.add(alarm);
+    scheduler.replan(DEADLINE - 10);
+}
+
+void tearDown() {
+}
+
+void test_rings_on_time() {
+    bool ring;
+    TEST_ASSERT_FALSE(scheduler.due(DEADLINE - 1));
+    TEST_ASSERT_TRUE(scheduler.due(DEADLINE));
+    TEST_ASSERT_EQUAL(0, scheduler.fire(DEADLINE, ring));
+    TEST_ASSERT_TRUE(ring);
+    TEST_ASSERT_EQUAL_UINT32(DEADLINE + 86400L, scheduler.next());
+}
+
+void test_catches_up_within_catchup() {
+    bool ring;
+    TEST_ASSERT_TRUE(scheduler.due(DEADLINE + ALARMCATCHUP));
+    scheduler.fire(DEADLINE + ALARMCATCHUP, ring);
+    TEST_ASSERT_TRUE(ring);
+    TEST_ASSERT_EQUAL_UINT32(1, scheduler.stats().fired);
+    TEST_ASSERT_EQUAL_UINT32(1, scheduler.stats().late);
+    TEST_ASSERT_EQUAL_UINT32(ALARMCATCHUP, scheduler.stats().maxLate);
+    TEST_ASSERT_EQUAL_UINT32(0, scheduler.stats().missed);
+}
+
+void test_missed_beyond_catchup() {
+    bool ring;
+    scheduler.fire(DEADLINE + ALARMCATCHUP + 1, ring);
+    TEST_ASSERT_FALSE(ring);
+    TEST_ASSERT_EQUAL_UINT32(0, scheduler.stats().fired);
+    TEST_ASSERT_EQUAL_UINT32(1, scheduler.stats().missed);
+    TEST_ASSERT_EQUAL_UINT32(DEADLINE + 86400L, scheduler.next());
+}
+
+void test_no_second_fire_after_backward_step() {
+    bool ring;
+    scheduler.fire(DEADLINE + 5, ring);
+    scheduler.timeStep(DEADLINE - 3, -8000);
+    TEST_ASSERT_EQUAL_UINT32(1, scheduler.stats().backSteps);
+    TEST_ASSERT_FALSE(scheduler.due(DEADLINE));
+    TEST_ASSERT_EQUAL_UINT32(DEADLINE + 86400L, scheduler.next());
+}
+
+void test_subsecond_step_back_is_no_step() {
+    bool ring;
+    scheduler.fire(DEADLINE, ring);
+    scheduler.timeStep(DEADLINE - 1, -20);
+    TEST_ASSERT_EQUAL_UINT32(0, scheduler.stats().backSteps);
+    TEST_ASSERT_EQUAL_UINT32(DEADLINE + 86400L, scheduler.next());
+}
+
+void test_forward_step_keeps_crossed_deadline_due() {
+    scheduler.timeStep(DEADLINE + 100, 110000);
+    TEST_ASSERT_TRUE(scheduler.due(DEADLINE + 100));
+}
+
+void test_forward_step_beyond_maxstep_replans() {
+    uint32_t to = DEADLINE + 2 * 86400L + 10;
+    scheduler.timeStep(to, ((int64_t)ALARMMAXSTEP * 2 + 20) * 1000);
+    TEST_ASSERT_FALSE(scheduler.due(to));
+    TEST_ASSERT_EQUAL_UINT32(DEADLINE + 3 * 86400L, scheduler.next());
+    TEST_ASSERT_EQUAL_UINT32(0, scheduler.stats().missed);
+}
+
+void test_once_alarm_is_deactivated() {
+    bool ring;
+    scheduler.alarm(0).once = true;
+    scheduler.replan(DEADLINE - 10);
+    scheduler.fire(DEADLINE, ring);
+    TEST_ASSERT_TRUE(ring);
+    TEST_ASSERT_FALSE(scheduler.alarm(0).active);
+    TEST_ASSERT_EQUAL_UINT32(0, scheduler.next());
+    TEST_ASSERT_FALSE(scheduler.due(DEADLINE + 86400L));
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_rings_on_time);
+    RUN_TEST(test_catches_up_within_catchup);
+    RUN_TEST(test_missed_beyond_catchup);
+    RUN_TEST(test_no_second_fire_after_backward_step);
+    RUN_TEST(test_subsecond_step_back_is_no_step);
+    RUN_TEST(test_forward_step_keeps_crossed_deadline_due);
+    RUN_TEST(test_forward_step_beyond_maxstep_replans);
+    RUN_TEST(test_once_alarm_is_deactivated);
+    return UNITY_END();
+}
@@ -0,0 +1,75 @@
+/* ButtonDecoder: a click is held back until it can no longer become a double click
+ *
+ *   pio test -e native
+ */
+
+#include <unity.h>
+#include "../../src/hal/ButtonDecoder.h"
+
+static ButtonDecoder button;
+
+void setUp() {
+    button = ButtonDecoder();
+}
+
+void tearDown() {
+}
+
+void test_click_after_double_window() {
+    button.edge(1000, true);
+    button.edge(1100, false);
+    TEST_ASSERT_EQUAL(BUTTON_NONE, button.poll(1100));
+    TEST_ASSERT_EQUAL(BUTTON_NONE, button.poll(1100 + BUTTONDOUBLE - 1));
+    TEST_ASSERT_EQUAL(BUTTON_CLICK, button.poll(1100 + BUTTONDOUBLE));
+    TEST_ASSERT_EQUAL(BUTTON_NONE, button.poll(2000));
+}
+
+void test_double_click_replaces_click() {
+    button.edge(1000, true);
+    button.edge(1100, false);
+    button.edge(1300, true);
+    button.edge(1400, false);
+    TEST_ASSERT_EQUAL(BUTTON_DOUBLECLICK, button.poll(1400));
+    TEST_ASSERT_EQUAL(BUTTON_NONE, button.poll(3000));
+}
+
+void test_click_held_while_second_press_is_down() {
+    button.edge(1000, true);
+    button.edge(1100, false);
+    button.edge(1400, true);
+    // past the window, but the press began within it
+    TEST_ASSERT_EQUAL(BUTTON_NONE, button.poll(1600));
+    button.edge(1650, false);
+    TEST_ASSERT_EQUAL(BUTTON_DOUBLECLICK, button.poll(1650));
+}
+
+void test_late_second_press_is_a_new_click() {
+    button.edge(1000, true);
+    button.edge(1100, false);
+    button.edge(1100 + BUTTONDOUBLE + 1, true);
+    TEST_ASSERT_EQUAL(BUTTON_CLICK, button.poll(1100 + BUTTONDOUBLE + 1));
+}
+
+void test_long_press() {
+    button.edge(1000, true);
+    button.edge(1000 + BUTTONLONG, false);
+    TEST_ASSERT_EQUAL(BUTTON_LONGPRESS, button.poll(1000 + BUTTONLONG));
+}
+
+void test_bounce_is_ignored() {
+    button.edge(1000, true);
+    button.edge(1000 + BUTTONDEBOUNCE - 1, false);
+    TEST_ASSERT_TRUE(button.pressed());
+    TEST_ASSERT_FALSE(button.pending());
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_click_after_double_window);
+    RUN_TEST(test_double_click_replaces_click);
+    RUN_TEST(test_click_held_while_second_press_is_down);
+    RUN_TEST(test_late_second_press_is_a_new_click);
+    RUN_TEST(test_long_press);
+    RUN_TEST(test_bounce_is_ignored);
+    return UNITY_END();
+}
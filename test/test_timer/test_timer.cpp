@@ -0,0 +1,75 @@
+/* ClockTimer: the switches of the shown unit and the ms until the display changes
+ *
+ *   pio test -e native
+ */
+
+#include <unity.h>
+#include "../../src/ClockTimer.h"
+
+static ClockTimer timer;
+
+void setUp() {
+    timer = ClockTimer();
+}
+
+void tearDown() {
+}
+
+void test_countdown_minute_switches_to_centiseconds() {
+    uint32_t unit;
+    timer.countdown(60000, 0);
+    TEST_ASSERT_EQUAL_UINT32(60, timer.shown(0, unit));
+    TEST_ASSERT_EQUAL_UINT32(1000, unit);
+    // 59990 ms left is the largest ss.cc value, reached 10 ms in
+    TEST_ASSERT_EQUAL_UINT32(10, timer.untilChange(0));
+    TEST_ASSERT_EQUAL_UINT32(5999, timer.shown(10, unit));
+    TEST_ASSERT_EQUAL_UINT32(10, unit);
+    TEST_ASSERT_EQUAL_UINT32(10, timer.untilChange(10));
+}
+
+void test_countdown_hours_switch_to_seconds() {
+    uint32_t unit;
+    timer.countdown(6000000, 0);
+    TEST_ASSERT_EQUAL_UINT32(100, timer.shown(0, unit));
+    TEST_ASSERT_EQUAL_UINT32(60000, unit);
+    TEST_ASSERT_EQUAL_UINT32(1000, timer.untilChange(0));
+    TEST_ASSERT_EQUAL_UINT32(5999, timer.shown(1000, unit));
+    TEST_ASSERT_EQUAL_UINT32(1000, unit);
+}
+
+void test_countdown_reads_zero_at_expiry() {
+    uint32_t unit;
+    timer.countdown(1000, 0);
+    TEST_ASSERT_EQUAL_UINT32(1, timer.shown(999, unit));
+    TEST_ASSERT_FALSE(timer.expired(999));
+    TEST_ASSERT_EQUAL_UINT32(0, timer.shown(1000, unit));
+    TEST_ASSERT_TRUE(timer.expired(1000));
+    TEST_ASSERT_EQUAL_UINT32(0, timer.untilExpiry(1000));
+}
+
+void test_stopwatch_switches_to_seconds() {
+    uint32_t unit;
+    timer.stopwatch(0);
+    TEST_ASSERT_EQUAL_UINT32(5999, timer.shown(59999, unit));
+    TEST_ASSERT_EQUAL_UINT32(10, unit);
+    TEST_ASSERT_EQUAL_UINT32(1, timer.untilChange(59999));
+    TEST_ASSERT_EQUAL_UINT32(60, timer.shown(60000, unit));
+    TEST_ASSERT_EQUAL_UINT32(1000, unit);
+}
+
+void test_paused_does_not_change() {
+    timer.stopwatch(0);
+    timer.pause(500);
+    TEST_ASSERT_EQUAL_UINT32(0xffffffff, timer.untilChange(800));
+    TEST_ASSERT_EQUAL_UINT32(500, timer.elapsed(800));
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_countdown_minute_switches_to_centiseconds);
+    RUN_TEST(test_countdown_hours_switch_to_seconds);
+    RUN_TEST(test_countdown_reads_zero_at_expiry);
+    RUN_TEST(test_stopwatch_switches_to_seconds);
+    RUN_TEST(test_paused_does_not_change);
+    return UNITY_END();
+}
@@ -0,0 +1,67 @@
+#!/usr/bin/env python3
+"""Precompresses a page for GzipTemplate (src/GzipTemplate.h).
+
+Splits the page at its <!--##name--> marker and writes a header with the head (gzip header and
+deflate blocks up to a sync flush) and the tail (deflate blocks up to the final one) as PROGMEM
+arrays, with their sizes and CRC-32s. Run it again whenever the page changes:
+
+    python3 tools/gzippage.py data/index.html src/ClockPage.h --marker state --prefix CLOCKPAGE
+"""
+
+import argparse
+import gzip
+import os
+import struct
+import zlib
+
+
+def deflate(data, final):
+    z = zlib.compressobj(9, zlib.DEFLATED, -15, 9)
+    return z.compress(data) + z.flush(zlib.Z_FINISH if final else zlib.Z_SYNC_FLUSH)
+
+
+def array(name, data):
+    rows = [", ".join("0x%02x" % b for b in data[i:i + 16]) for i in range(0, len(data), 16)]
+    return "static const uint8_t %s[] PROGMEM={\n  %s\n};\n" % (name, ",\n  ".join(rows))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("page")
+    parser.add_argument("header")
+    parser.add_argument("--marker", default="state")
+    parser.add_argument("--prefix", default="CLOCKPAGE")
+    args = parser.parse_args()
+
+    page = open(args.page, "rb").read()
+    marker = ("<!--##%s-->" % args.marker).encode()
+    if page.count(marker) != 1:
+        raise SystemExit("%s: needs exactly one %s" % (args.page, marker.decode()))
+    head, tail = page.split(marker)
+
+    # gzip header: no name, no time, so the output only changes with the page
+    headGz = bytes([0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 2, 3]) + deflate(head, False)
+    tailGz = deflate(tail, True)
+
+    # the whole must inflate to the page with an empty fragment
+    crc = zlib.crc32(head + tail)
+    check = headGz + tailGz + struct.pack("<II", crc, len(head) + len(tail))
+    assert gzip.decompress(check) == head + tail
+
+    p = args.prefix
+    guard = os.path.splitext(os.path.basename(args.header))[0] + "_h"
+    with open(args.header, "w") as out:
+        out.write("// generated by tools/gzippage.py from %s, do not edit\n\n" % args.page)
+        out.write("#ifndef %s\n#define %s\n\n#include \"GzipTemplate.h\"\n\n" % (guard, guard))
+        out.write(array(p + "HEADGZ", headGz) + "\n")
+        out.write(array(p + "TAILGZ", tailGz) + "\n")
+        out.write("static const GzipPart %sHEAD={%sHEADGZ, %d, %d, 0x%08x};\n"
+                  % (p, p, len(headGz), len(head), zlib.crc32(head)))
+        out.write("static const GzipPart %sTAIL={%sTAILGZ, %d, %d, 0x%08x};\n"
+                  % (p, p, len(tailGz), len(tail), zlib.crc32(tail)))
+        out.write("\n#endif\n")
+    print("%s: %d bytes, %d+%d gzipped" % (args.header, len(page), len(headGz), len(tailGz)))
+
+
+if __name__ == "__main__":
+    main()